@@ -296,6 +296,9 @@ template<int channel>
 class Adc0Channel : public AdcBase_T<Adc0Info>, CheckSignal<Adc0Info, channel> {
 
 public:
+   /** SC1 value selecting this channel (e.g. for a conversion sequence) */
+   static constexpr uint32_t sc1Value = ADC_SC1_ADCH(channel)&~ADC_SC1_DIFF_MASK;
+
    /**
     * Initiates a conversion but does not wait for it to complete\n
     * Intended for use with interrupts
@@ -335,6 +338,9 @@ template<int channel>
 class Adc0DiffChannel : public AdcBase_T<Adc0Info>, CheckSignal<Adc0Info::InfoDP, channel>, CheckSignal<Adc0Info::InfoDM, channel> {
 
 public:
+   /** SC1 value selecting this channel (e.g. for a conversion sequence) */
+   static constexpr uint32_t sc1Value = ADC_SC1_ADCH(channel)|ADC_SC1_DIFF_MASK;
+
    /**
     * Initiates a conversion but does not wait for it to complete\n
     * Intended for use with interrupts
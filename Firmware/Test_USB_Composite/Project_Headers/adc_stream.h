@@ -0,0 +1,320 @@
+/**
+ * @file     adc_stream.h
+ * @brief    Continuous ADC acquisition
+ *
+ * Conversions are triggered by the PDB at a fixed rate.\n
+ * Each conversion complete requests a DMA transfer of the result into a double-buffered ring.
+ * This channel is linked to a second DMA channel that writes the next entry of the channel
+ * sequence to ADC.SC1[0] ready for the next trigger.\n
+ * No CPU is used per sample - a callback is made as each half of the buffer is filled.
+ *
+ * @version  V4.12.1.80
+ * @date     13 April 2016
+ */
+#ifndef HEADER_ADC_STREAM_H
+#define HEADER_ADC_STREAM_H
+
+#include <stdint.h>
+#include "derivative.h"
+#include "system.h"
+#include "hardware.h"
+#include "pdb.h"
+#include "dma.h"
+
+namespace USBDM {
+
+/**
+ * @addtogroup AnalogueIO_Group Analogue Input
+ * @{
+ */
+
+/**
+ * Type definition for ADC stream block call back
+ *
+ * @param block      Block of results (interleaved in channel sequence order)
+ * @param blockSize  Number of results in block
+ *
+ * @note Called from DMA interrupt. The block is overwritten after a further blockSize conversions.
+ */
+typedef void (*AdcStreamCallbackFunction)(const uint16_t *block, unsigned blockSize);
+
+/** Maximum number of channels in a conversion sequence */
+static constexpr unsigned ADC_STREAM_MAX_CHANNELS = 8;
+
+/** Maximum block size (2 blocks must fit in the linked DMA major loop count) */
+static constexpr unsigned ADC_STREAM_MAX_BLOCK    = 255;
+
+/**
+ * Template class providing continuous PDB triggered, DMA transferred ADC acquisition
+ *
+ * Example
+ * @code
+ *  static const uint32_t sequence[] = {Adc0Channel<19>::sc1Value, Adc0Channel<8>::sc1Value};
+ *  static uint16_t buffer[2*64];
+ *
+ *  void process(const uint16_t *block, unsigned blockSize) {
+ *     // Use block[0..blockSize-1] before it is overwritten
+ *  }
+ *
+ *  Adc0::enable();
+ *  Adc0Stream::configure(sequence, 2, buffer, 64, 0, 1, process);
+ *  Adc0Stream::start(10000);
+ * @endcode
+ *
+ * @tparam AdcInfo  Class describing ADC hardware
+ * @tparam PdbInfo  Class describing PDB hardware
+ * @tparam Dma      Class representing eDMA controller
+ */
+template<class AdcInfo, class PdbInfo, class Dma>
+class AdcStream_T {
+
+protected:
+   static constexpr volatile ADC_Type *adc = AdcInfo::adc;
+   static constexpr volatile PDB_Type *pdb = PdbInfo::pdb;
+
+   /** SC1 values written after each conversion (sequence rotated by one) */
+   static uint32_t sequence[ADC_STREAM_MAX_CHANNELS];
+
+   /** SC1 value for first conversion */
+   static uint32_t firstSc1;
+
+   /** Number of channels in sequence */
+   static unsigned numChannels;
+
+   /** Result buffer (2 blocks) */
+   static uint16_t *buffer;
+
+   /** Number of results in each half of buffer */
+   static unsigned blockSize;
+
+   /** DMA channel moving results */
+   static unsigned resultChannel;
+
+   /** DMA channel updating ADC channel */
+   static unsigned sequenceChannel;
+
+   /** Half of buffer to be completed next */
+   static volatile bool secondHalf;
+
+   /** Callback for completed blocks */
+   static AdcStreamCallbackFunction callback;
+
+   /**
+    * Result DMA half and major loop complete handler
+    */
+   static void dmaHandler() {
+      const uint16_t *block = secondHalf?(buffer+blockSize):buffer;
+      secondHalf = !secondHalf;
+      if (callback != 0) {
+         callback(block, blockSize);
+      }
+   }
+
+public:
+   /**
+    * Configure acquisition
+    *
+    * @param sc1Values        SC1 values for each channel in conversion sequence e.g. Adc0Channel<19>::sc1Value
+    * @param numChannels      Number of channels in sequence (1..ADC_STREAM_MAX_CHANNELS)
+    * @param buffer           Buffer for results - must be 2*blockSize entries
+    * @param blockSize        Number of results passed to each callback (multiple of numChannels, <= ADC_STREAM_MAX_BLOCK)
+    * @param resultChannel    DMA channel used to move results
+    * @param sequenceChannel  DMA channel used to update ADC channel (not used if numChannels == 1)
+    * @param callback         Called as each half of the buffer is filled
+    *
+    * @return E_NO_ERROR on success
+    *
+    * @note The ADC should be enabled (e.g. Adc0::enable()) and the resolution set beforehand.\n
+    *       The DMA channel interrupt handler (Dma0::irqNHandler) for resultChannel must be installed.
+    */
+   static ErrorCode configure(
+         const uint32_t             sc1Values[],
+         unsigned                   numChannels,
+         uint16_t                  *buffer,
+         unsigned                   blockSize,
+         unsigned                   resultChannel,
+         unsigned                   sequenceChannel,
+         AdcStreamCallbackFunction  callback) {
+
+      if ((numChannels == 0) || (numChannels > ADC_STREAM_MAX_CHANNELS) ||
+          (blockSize == 0) || ((blockSize%numChannels) != 0) || (resultChannel == sequenceChannel)) {
+         return setErrorCode(E_ILLEGAL_PARAM);
+      }
+      if (blockSize > ADC_STREAM_MAX_BLOCK) {
+         return setErrorCode(E_TOO_LARGE);
+      }
+      stop();
+
+      AdcStream_T::numChannels     = numChannels;
+      AdcStream_T::buffer          = buffer;
+      AdcStream_T::blockSize       = blockSize;
+      AdcStream_T::resultChannel   = resultChannel;
+      AdcStream_T::sequenceChannel = sequenceChannel;
+      AdcStream_T::callback        = callback;
+
+      firstSc1 = sc1Values[0]&(ADC_SC1_ADCH_MASK|ADC_SC1_DIFF_MASK);
+      for (unsigned index=0; index<numChannels; index++) {
+         sequence[index] = sc1Values[(index+1)%numChannels]&(ADC_SC1_ADCH_MASK|ADC_SC1_DIFF_MASK);
+      }
+      Dma::enable();
+      Dma::configureMux(resultChannel, AdcInfo::dmaSlot);
+      Dma::setCallback(resultChannel, dmaHandler);
+
+      const bool     linked = (numChannels > 1);
+      const uint32_t total  = 2*blockSize;
+
+      // Result channel - ADC.R[0] => buffer (circular)
+      auto &result = Dma::dma->TCD[resultChannel];
+      result.SADDR       = (uint32_t)&adc->R[0];
+      result.SOFF        = 0;
+      result.ATTR        = Dma::attr(DmaSize_16bit, DmaSize_16bit);
+      result.NBYTES_MLNO = sizeof(uint16_t);
+      result.SLAST       = 0;
+      result.DADDR       = (uint32_t)buffer;
+      result.DOFF        = sizeof(uint16_t);
+      result.DLASTSGA    = -(int32_t)(total*sizeof(uint16_t));
+      if (linked) {
+         // Link to sequence channel after each result (minor loop and major loop)
+         result.CITER_ELINKYES = DMA_CITER_ELINKYES_ELINK_MASK|DMA_CITER_ELINKYES_LINKCH(sequenceChannel)|DMA_CITER_ELINKYES_CITER(total);
+         result.BITER_ELINKYES = DMA_BITER_ELINKYES_ELINK_MASK|DMA_BITER_ELINKYES_LINKCH(sequenceChannel)|DMA_BITER_ELINKYES_BITER(total);
+         result.CSR            = DMA_CSR_INTHALF_MASK|DMA_CSR_INTMAJOR_MASK|
+                                 DMA_CSR_MAJORELINK_MASK|DMA_CSR_MAJORLINKCH(sequenceChannel);
+      }
+      else {
+         result.CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(total);
+         result.BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(total);
+         result.CSR           = DMA_CSR_INTHALF_MASK|DMA_CSR_INTMAJOR_MASK;
+      }
+      if (linked) {
+         // Sequence channel - sequence[] => ADC.SC1[0] (circular, only started by link)
+         Dma::dmamux->CHCFG[sequenceChannel] = 0;
+         auto &next = Dma::dma->TCD[sequenceChannel];
+         next.SADDR         = (uint32_t)sequence;
+         next.SOFF          = sizeof(uint32_t);
+         next.ATTR          = Dma::attr(DmaSize_32bit, DmaSize_32bit);
+         next.NBYTES_MLNO   = sizeof(uint32_t);
+         next.SLAST         = -(int32_t)(numChannels*sizeof(uint32_t));
+         next.DADDR         = (uint32_t)&adc->SC1[0];
+         next.DOFF          = 0;
+         next.CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(numChannels);
+         next.BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(numChannels);
+         next.DLASTSGA      = 0;
+         next.CSR           = 0;
+      }
+      return E_NO_ERROR;
+   }
+
+   /**
+    * Start acquisition
+    *
+    * @param sampleRate Conversions per second (each channel is sampled at sampleRate/numChannels)
+    *
+    * @return E_NO_ERROR on success
+    *
+    * @note The sample period must not be shorter than the ADC conversion time (see checkSequenceError())
+    */
+   static ErrorCode start(uint32_t sampleRate) {
+      if (sampleRate == 0) {
+         return setErrorCode(E_TOO_SMALL);
+      }
+      // Find smallest PDB prescaler giving a modulus that fits
+      static const uint8_t multFactors[] = {1, 10, 20, 40};
+      uint32_t ticks = SystemBusClock/sampleRate;
+      uint32_t sc    = 0;
+      bool     found = false;
+      for (unsigned mult=0; (mult<4) && !found; mult++) {
+         for (unsigned prescaler=0; prescaler<8; prescaler++) {
+            uint32_t divider = multFactors[mult]<<prescaler;
+            if ((ticks/divider) <= 0x10000) {
+               ticks = ticks/divider;
+               sc    = PDB_SC_MULT(mult)|PDB_SC_PRESCALER(prescaler);
+               found = true;
+               break;
+            }
+         }
+      }
+      if (!found) {
+         return setErrorCode(E_TOO_SMALL);
+      }
+      if (ticks == 0) {
+         return setErrorCode(E_TOO_LARGE);
+      }
+      secondHalf = false;
+
+      // Hardware trigger from PDB (default SIM_SOPT7 trigger selection), DMA request on completion
+      SIM->SOPT7 &= ~(SIM_SOPT7_ADC0ALTTRGEN_MASK|SIM_SOPT7_ADC0PRETRGSEL_MASK);
+      adc->SC3    &= ~ADC_SC3_ADCO_MASK;
+      adc->SC2    |= ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK;
+      adc->SC1[0]  = firstSc1;
+
+      Dma::enableRequests(resultChannel);
+
+      // PDB continuous, software triggered, pre-trigger 0 at start of each period
+      *PdbInfo::clockReg |= PdbInfo::clockMask;
+      __DMB();
+      pdb->SC           = PDB_SC_PDBEN_MASK|PDB_SC_TRGSEL(15)|PDB_SC_CONT_MASK|sc;
+      pdb->MOD          = PDB_MOD_MOD(ticks-1);
+      pdb->IDLY         = 0;
+      pdb->CH[0].DLY[0] = 0;
+      pdb->CH[0].C1     = PDB_C1_EN(1)|PDB_C1_TOS(1);
+      pdb->SC          |= PDB_SC_LDOK_MASK;
+      pdb->SC          |= PDB_SC_SWTRIG_MASK;
+
+      return E_NO_ERROR;
+   }
+
+   /**
+    * Stop acquisition
+    */
+   static void stop() {
+      if (*PdbInfo::clockReg & PdbInfo::clockMask) {
+         pdb->SC &= ~(PDB_SC_PDBEN_MASK|PDB_SC_CONT_MASK);
+      }
+      if (buffer != 0) {
+         Dma::disableRequests(resultChannel);
+      }
+      if (*AdcInfo::clockReg & AdcInfo::clockMask) {
+         adc->SC2   &= ~(ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);
+         adc->SC1[0] = ADC_SC1_ADCH(0x1F);
+      }
+   }
+
+   /**
+    * Check for (and clear) PDB sequence error\n
+    * This indicates a trigger occurred before the previous conversion completed
+    *
+    * @return true if an error occurred
+    */
+   static bool checkSequenceError() {
+      bool error = (pdb->CH[0].S & PDB_S_ERR(1)) != 0;
+      if (error) {
+         pdb->CH[0].S = ~(uint32_t)PDB_S_ERR(1);
+      }
+      return error;
+   }
+};
+
+template<class AdcInfo, class PdbInfo, class Dma> uint32_t                  AdcStream_T<AdcInfo, PdbInfo, Dma>::sequence[ADC_STREAM_MAX_CHANNELS];
+template<class AdcInfo, class PdbInfo, class Dma> uint32_t                  AdcStream_T<AdcInfo, PdbInfo, Dma>::firstSc1        = 0;
+template<class AdcInfo, class PdbInfo, class Dma> unsigned                  AdcStream_T<AdcInfo, PdbInfo, Dma>::numChannels     = 0;
+template<class AdcInfo, class PdbInfo, class Dma> uint16_t                 *AdcStream_T<AdcInfo, PdbInfo, Dma>::buffer          = 0;
+template<class AdcInfo, class PdbInfo, class Dma> unsigned                  AdcStream_T<AdcInfo, PdbInfo, Dma>::blockSize       = 0;
+template<class AdcInfo, class PdbInfo, class Dma> unsigned                  AdcStream_T<AdcInfo, PdbInfo, Dma>::resultChannel   = 0;
+template<class AdcInfo, class PdbInfo, class Dma> unsigned                  AdcStream_T<AdcInfo, PdbInfo, Dma>::sequenceChannel = 0;
+template<class AdcInfo, class PdbInfo, class Dma> volatile bool             AdcStream_T<AdcInfo, PdbInfo, Dma>::secondHalf      = false;
+template<class AdcInfo, class PdbInfo, class Dma> AdcStreamCallbackFunction AdcStream_T<AdcInfo, PdbInfo, Dma>::callback        = 0;
+
+#if defined(USBDM_ADC0_IS_DEFINED) && defined(USBDM_PDB0_IS_DEFINED) && defined(USBDM_DMA0_IS_DEFINED)
+/**
+ * Class representing continuous acquisition on ADC0
+ */
+using Adc0Stream = AdcStream_T<Adc0Info, Pdb0Info, Dma0>;
+#endif
+
+/**
+ * @}
+ */
+
+} // End namespace USBDM
+
+#endif /* HEADER_ADC_STREAM_H */
@@ -0,0 +1,179 @@
+/**
+ * @file     dma.h
+ *
+ * @brief    Abstraction layer for eDMA and DMAMUX
+ *
+ * @version  V4.12.1.80
+ * @date     13 April 2016
+ */
+
+#ifndef INCLUDE_USBDM_DMA_H_
+#define INCLUDE_USBDM_DMA_H_
+
+#include <stdint.h>
+#include "derivative.h"
+#include "hardware.h"
+
+namespace USBDM {
+
+/**
+ * @addtogroup DMA_Group DMA, Enhanced Direct Memory Access
+ * @brief Abstraction for eDMA controller and channel multiplexor
+ * @{
+ */
+
+/**
+ * Type definition for DMA channel major-loop complete call back
+ */
+typedef void (*DMACallbackFunction)(void);
+
+/** DMA transfer size codes for TCD.ATTR SSIZE/DSIZE fields */
+enum DmaSize {
+   DmaSize_8bit  = 0, //!< 8-bit transfer
+   DmaSize_16bit = 1, //!< 16-bit transfer
+   DmaSize_32bit = 2, //!< 32-bit transfer
+};
+
+/**
+ * @brief Class representing the eDMA controller
+ *
+ * Channel interrupts call a callback set by setCallback().\n
+ * The DMAMUX is used to route peripheral requests to channels.
+ *
+ * @tparam Info      Class describing DMA hardware
+ * @tparam MuxInfo   Class describing DMAMUX hardware
+ */
+template<class Info, class MuxInfo>
+class Dma_T {
+protected:
+   /** Callback functions for ISRs */
+   static DMACallbackFunction callback[Info::numChannels];
+
+   /**
+    * Common channel interrupt handler
+    *
+    * @param channel Channel that completed
+    */
+   static void irqHandler(unsigned channel) {
+      // Clear interrupt flag
+      dma->CINT = DMA_CINT_CINT(channel);
+
+      if (callback[channel] != 0) {
+         callback[channel]();
+      }
+      else {
+         setAndCheckErrorCode(E_NO_HANDLER);
+      }
+   }
+
+public:
+   /** Pointer to hardware (TCDs are accessed directly as dma->TCD[channel]) */
+   static constexpr volatile DMA_Type    *dma    = Info::dma;
+
+   /** Pointer to channel multiplexor hardware */
+   static constexpr volatile DMAMUX_Type *dmamux = MuxInfo::dmamux;
+
+   /** DMA channel 0 interrupt handler -  Calls channel 0 callback */
+   static void irq0Handler() {
+      irqHandler(0);
+   }
+   /** DMA channel 1 interrupt handler -  Calls channel 1 callback */
+   static void irq1Handler() {
+      irqHandler(1);
+   }
+   /** DMA channel 2 interrupt handler -  Calls channel 2 callback */
+   static void irq2Handler() {
+      irqHandler(2);
+   }
+   /** DMA channel 3 interrupt handler -  Calls channel 3 callback */
+   static void irq3Handler() {
+      irqHandler(3);
+   }
+
+   /**
+    * Enable clocks to eDMA and DMAMUX
+    */
+   static void enable() {
+      *Info::clockReg    |= Info::clockMask;
+      *MuxInfo::clockReg |= MuxInfo::clockMask;
+      __DMB();
+   }
+
+   /**
+    * Set callback for ISR and enable channel interrupt in NVIC
+    *
+    * @param channel  The DMA channel to modify
+    * @param callback The function to call from stub ISR (0 => disable interrupt)
+    */
+   static void setCallback(unsigned channel, DMACallbackFunction callback) {
+      Dma_T::callback[channel] = callback;
+      IRQn_Type irqNum = (IRQn_Type)(Info::irqNums[0]+channel);
+      if (callback != 0) {
+         NVIC_EnableIRQ(irqNum);
+      }
+      else {
+         NVIC_DisableIRQ(irqNum);
+      }
+   }
+
+   /**
+    * Route a peripheral DMA request to a channel
+    *
+    * @param channel  The DMA channel to modify
+    * @param slot     DMAMUX slot (request source) e.g. Dmamux0Info::DMA0_SLOT_SPI0_Receive
+    */
+   static void configureMux(unsigned channel, uint8_t slot) {
+      dmamux->CHCFG[channel] = 0;
+      dmamux->CHCFG[channel] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(slot);
+   }
+
+   /**
+    * Enable hardware requests for a channel
+    *
+    * @param channel  The DMA channel to modify
+    */
+   static void enableRequests(unsigned channel) {
+      dma->SERQ = DMA_SERQ_SERQ(channel);
+   }
+
+   /**
+    * Disable hardware requests for a channel
+    *
+    * @param channel  The DMA channel to modify
+    */
+   static void disableRequests(unsigned channel) {
+      dma->CERQ = DMA_CERQ_CERQ(channel);
+   }
+
+   /**
+    * Get TCD.ATTR value for given source and destination sizes
+    *
+    * @param sourceSize       Source transfer size
+    * @param destinationSize  Destination transfer size
+    *
+    * @return ATTR value
+    */
+   static constexpr uint16_t attr(DmaSize sourceSize, DmaSize destinationSize) {
+      return DMA_ATTR_SSIZE(sourceSize)|DMA_ATTR_DSIZE(destinationSize);
+   }
+};
+
+/**
+ * Callback table for programmatically set handlers
+ */
+template<class Info, class MuxInfo> DMACallbackFunction Dma_T<Info, MuxInfo>::callback[] = {0};
+
+#if defined(USBDM_DMA0_IS_DEFINED) && defined(USBDM_DMAMUX0_IS_DEFINED)
+/**
+ * @brief Class representing the eDMA controller
+ */
+using Dma0 = Dma_T<Dma0Info, Dmamux0Info>;
+#endif
+
+/**
+ * @}
+ */
+
+} // End namespace USBDM
+
+#endif /* INCLUDE_USBDM_DMA_H_ */
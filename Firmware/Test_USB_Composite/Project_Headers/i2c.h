@@ -33,6 +33,42 @@ enum I2c_Mode {
    i2c_interrupt = I2C_C1_IICIE_MASK,   //!< Operate in i2c_interrupt mode
 };
 
+struct I2cTransaction;
+
+/**
+ * Call-back on completion of a queued I2C transaction
+ *
+ * @param transaction Transaction that has completed (errorCode is valid)
+ *
+ * @note Called from the I2C interrupt handler
+ */
+typedef void (*I2cCallback)(I2cTransaction &transaction);
+
+/** Flags for I2cTransaction */
+enum I2c_TransactionFlags {
+   i2c_stop     = 0,      //!< Generate STOP after transaction
+   i2c_holdBus  = (1<<0), //!< Use REPEATED-START to the following transaction if already queued
+};
+
+/**
+ * Descriptor for a queued I2C transaction
+ *
+ * A transmission (if txSize>0) is followed by a reception (if rxSize>0) using REPEATED-START.\n
+ * The descriptor and data buffers must remain valid until the call-back is executed.
+ */
+struct I2cTransaction {
+   uint8_t           address;    //!< Address of slave (write address i.e. bit 0 clear)
+   uint8_t           flags;      //!< I2c_TransactionFlags
+   uint16_t          txSize;     //!< Size of transmission data (may be zero)
+   const uint8_t    *txData;     //!< Data to transmit
+   uint16_t          rxSize;     //!< Size of reception data (may be zero)
+   uint8_t          *rxData;     //!< Buffer for reception data
+   I2cCallback       callback;   //!< Executed on completion (may be nullptr)
+   void             *context;    //!< User data for call-back
+   volatile uint8_t  errorCode;  //!< Error code on completion (0 => success)
+   volatile bool     complete;   //!< Set on completion
+};
+
 /**
  * Virtual Base class for I2C interface
  */
@@ -53,6 +89,14 @@ protected:
    uint8_t             addressedDevice;     //!< Address of device being communicated with
    uint8_t             errorCode;           //!< Error code from last transaction
 
+   /** Size of transaction queue (power of 2) */
+   static constexpr unsigned QUEUE_SIZE = 8;
+
+   I2cTransaction * volatile current;       //!< Queued transaction in progress (nullptr if none or synchronous)
+   I2cTransaction     *queue[QUEUE_SIZE];   //!< Queued transactions waiting to start
+   volatile unsigned   queueHead;           //!< Count of transactions added to queue (by submit())
+   volatile unsigned   queueTail;           //!< Count of transactions removed from queue (by ISR)
+
    /** I2C baud rate divisor table */
    static const uint16_t I2C_DIVISORS[4*16];
 
@@ -64,7 +108,8 @@ protected:
     *
     */
    I2c(volatile I2C_Type *i2c, I2c_Mode mode) :
-      i2c(i2c), state(i2c_idle), mode(mode), rxBytesRemaining(0), txBytesRemaining(0), rxDataPtr(0), txDataPtr(0), addressedDevice(0), errorCode(0) {
+      i2c(i2c), state(i2c_idle), mode(mode), rxBytesRemaining(0), txBytesRemaining(0), rxDataPtr(0), txDataPtr(0), addressedDevice(0), errorCode(0),
+      current(nullptr), queue{}, queueHead(0), queueTail(0) {
    }
 
    /**
@@ -89,6 +134,33 @@ protected:
     */
    void sendAddress(uint8_t address);
 
+   /**
+    * Generate REPEATED-START
+    */
+   void generateRepeatedStart();
+
+   /**
+    * Start a queued transaction
+    *
+    * @param transaction Transaction to start
+    * @param busHeld     REPEATED-START has already been generated
+    */
+   void startTransaction(I2cTransaction &transaction, bool busHeld);
+
+   /**
+    * Generate STOP or REPEATED-START at end of transaction
+    *
+    * @return true if REPEATED-START was generated to hold the bus for the next queued transaction
+    */
+   bool endTransaction();
+
+   /**
+    * Report completion of current queued transaction and start the next one (if any)
+    *
+    * @param busHeld REPEATED-START has already been generated by endTransaction()
+    */
+   void nextTransaction(bool busHeld);
+
    /**
     * Set baud factor value for interface
     *
@@ -112,10 +184,10 @@ public:
    virtual void busHangReset() = 0;
 
    /**
-    * Wait for current sequence to complete
+    * Wait for current sequence (including queued transactions) to complete
     */
    void waitWhileBusy(void) {
-      while (state != i2c_idle) {
+      while ((state != i2c_idle) || (current != nullptr)) {
          if ((i2c->C1&I2C_C1_IICIE_MASK) == 0) {
             poll();
          }
@@ -173,6 +245,37 @@ public:
     */
    int txRx(uint8_t address, uint16_t txSize, uint16_t rxSize, uint8_t data[] );
 
+   /**
+    * Queue transaction for asynchronous execution\n
+    * Queued transactions are chained back-to-back by the interrupt handler
+    *
+    * @param transaction Transaction to queue. This must remain valid until complete.
+    *
+    * @return true  => Transaction queued\n
+    *         false => Queue full or empty transaction
+    *
+    * @note The queue is lock-free for a single producer - submit() should only be called from one priority level.\n
+    *       Requires i2c_interrupt mode (or poll() to be called regularly)
+    */
+   bool submit(I2cTransaction &transaction);
+
+   /**
+    * Get number of transactions that submit() will currently accept
+    *
+    * @return Free entries in queue (may increase but not decrease until the next submit())
+    */
+   unsigned queueSpace() const {
+      return QUEUE_SIZE-(queueHead-queueTail);
+   }
+
+   /**
+    * Check if all queued transactions are complete
+    *
+    * @return true if idle
+    */
+   bool isIdle() {
+      return (state == i2c_idle) && (current == nullptr);
+   }
 };
 
 /**
@@ -201,6 +304,10 @@ public:
  *     // Note rxDataBuffer may be the same as txDataBuffer
  *     i2c->txRx(0x1D<<1, sizeof(txDataBuffer), txDataBuffer, sizeof(rxDataBuffer), rxDataBuffer);
  *  }
+ *
+ *  // Asynchronous operation (i2c_interrupt mode)
+ *  static I2cTransaction transaction = {0x1D<<1, i2c_stop, 1, txDataBuffer, sizeof(rxDataBuffer), rxDataBuffer, callback};
+ *  i2c->submit(transaction);
  *  @endcode
  *
  * @tparam Info            Class describing I2C hardware
@@ -524,6 +524,9 @@ public:
 
    // Template:adc0_diff_a
 
+   //! DMAMUX slot for conversion complete DMA requests
+   static constexpr uint8_t dmaSlot = 40; // Dmamux0Info::DMA0_SLOT_ADC0
+
    //! Callback handler has been installed in vector table
    static constexpr bool irqHandlerInstalled = false;
 
@@ -1058,7 +1061,13 @@ public:
    static constexpr volatile uint32_t *clockReg  = (volatile uint32_t *)(SIM_BasePtr+offsetof(SIM_Type,SCGC7));
 
    //! Number of IRQs for hardware
-   static constexpr uint32_t irqCount  = 0;
+   static constexpr uint32_t irqCount  = 4;
+
+   //! IRQ numbers for hardware
+   static constexpr IRQn_Type irqNums[]  = {DMA0_IRQn, DMA1_IRQn, DMA2_IRQn, DMA3_IRQn};
+
+   //! Number of DMA channels
+   static constexpr uint32_t numChannels  = 4;
 
 };
 
@@ -2473,6 +2482,12 @@ public:
 
    // Template:spi0_mk_pcsis6
 
+   //! DMAMUX slot for receive DMA requests
+   static constexpr uint8_t dmaRxSlot = Dmamux0Info::DMA0_SLOT_SPI0_Receive;
+
+   //! DMAMUX slot for transmit DMA requests
+   static constexpr uint8_t dmaTxSlot = Dmamux0Info::DMA0_SLOT_SPI0_Transmit;
+
    //! Callback handler has been installed in vector table
    static constexpr bool irqHandlerInstalled = false;
 
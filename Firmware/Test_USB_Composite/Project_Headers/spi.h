@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include "derivative.h"
 #include "hardware.h"
+#include "dma.h"
 
 namespace USBDM {
 
@@ -32,6 +33,17 @@ static constexpr uint32_t SPI_MODE1 (0       |SPI_CPHA);
 static constexpr uint32_t SPI_MODE2 (SPI_CPOL|0);
 static constexpr uint32_t SPI_MODE3 (SPI_CPOL|SPI_CPHA);
 
+/** Depth of the DSPI transmit and receive FIFOs */
+static constexpr unsigned SPI_FIFO_DEPTH = 4;
+
+/** Bulk transfers of at least this many frames use DMA (if enabled by enableDma()) */
+static constexpr uint32_t SPI_DMA_THRESHOLD = 16;
+
+/**
+ * Type definition for SPI bulk transfer complete call back
+ */
+typedef void (*SPICallbackFunction)(void);
+
 /**
  * @addtogroup SPI_Group SPI, Serial Peripheral Interface
  * @brief C++ Class allowing access to SPI interface
@@ -49,6 +61,12 @@ protected:
    volatile  SPI_Type * const spi; //!< SPI hardware
    uint32_t  pushrMask;            //!< Value to combine with data
 
+   int                  dmaTxChannel;  //!< DMA channel for transmit (-1 => DMA not used)
+   int                  dmaRxChannel;  //!< DMA channel for receive  (-1 => DMA not used)
+   uint32_t             dmaLastPushr;  //!< Final PUSHR value written when transmit DMA completes
+   SPICallbackFunction  dmaCallback;   //!< Called when DMA transfer completes
+   volatile bool        dmaBusy;       //!< DMA transfer in progress
+
 protected:
    /**
     * Constructor
@@ -56,9 +74,47 @@ protected:
     * @param baseAddress    Base address of SPI
     */
    Spi(volatile SPI_Type *baseAddress) :
-      spi(baseAddress), pushrMask(SPI_PUSHR_PCS_MASK) {
+      spi(baseAddress), pushrMask(SPI_PUSHR_PCS_MASK),
+      dmaTxChannel(-1), dmaRxChannel(-1), dmaLastPushr(0), dmaCallback(0), dmaBusy(false) {
    }
 
+   /**
+    * Configure DMA channels used for bulk transfers
+    *
+    * @param txChannel  DMA channel for transmit
+    * @param rxChannel  DMA channel for receive
+    * @param txSlot     DMAMUX slot for SPI transmit requests
+    * @param rxSlot     DMAMUX slot for SPI receive requests
+    * @param txHandler  Handler for transmit channel major-loop complete
+    * @param rxHandler  Handler for receive channel major-loop complete
+    */
+   void configureDma(
+         unsigned txChannel,         unsigned rxChannel,
+         uint8_t txSlot,             uint8_t rxSlot,
+         DMACallbackFunction txHandler, DMACallbackFunction rxHandler);
+
+   /**
+    * Start DMA bulk transfer
+    *
+    * @param command    PUSHR command bits (CTAS, PCS)
+    * @param dataSize   Number of frames to transfer (>= 3)
+    * @param dataOut    Transmit values (may be NULL for Rx only)
+    * @param dataIn     Receive buffer (may be NULL for Tx only)
+    * @param size       Size of each value in buffers
+    * @param callback   Called when transfer completes
+    */
+   void startDma(uint32_t command, uint32_t dataSize, const void *dataOut, void *dataIn, DmaSize size, SPICallbackFunction callback);
+
+   /**
+    * Transmit DMA complete - writes final PUSHR value (without CONT, with EOQ)
+    */
+   void dmaTxComplete();
+
+   /**
+    * Receive DMA complete - stops SPI and notifies user
+    */
+   void dmaRxComplete();
+
 public:
    /**
     * Calculate communication speed factors for SPI
@@ -265,6 +321,14 @@ public:
    void setPushrValue(uint32_t pushrMask) {
       this->pushrMask = pushrMask;
    }
+   /**
+    * Get value that is combined with data for PUSHR register
+    *
+    * @return Value set by setPushrValue()
+    */
+   uint32_t getPushrValue() const {
+      return pushrMask;
+   }
    /**
     *  Transmit and receive a series of bytes
     *
@@ -285,6 +349,58 @@ public:
     */
    void txRxWords(uint32_t dataSize, const uint16_t *dataOut, uint16_t *dataIn=0);
 
+   /**
+    *  Bulk transmit and receive a series of 4 to 8-bit values
+    *
+    *  The TX FIFO is kept full and RX is drained in lockstep so frames are sent back-to-back.\n
+    *  Transfers of SPI_DMA_THRESHOLD or more frames use DMA if enabled by enableDma().\n
+    *  In this case the function returns immediately and the callback is called from the DMA
+    *  interrupt on completion. Otherwise the callback is called before returning.
+    *
+    *  @param command   PUSHR command bits (CTAS, PCS) computed once by the caller e.g. getPushrValue().\n
+    *                   CONT and EOQ are added as needed
+    *  @param dataSize  Number of values to transfer
+    *  @param dataOut   Transmit bytes (may be NULL for Rx only)
+    *  @param dataIn    Receive byte buffer (may be NULL for Tx only)
+    *  @param callback  Called when transfer completes (may be NULL)
+    *
+    *  @note Buffers must remain valid until the transfer completes (see isBusy())
+    *  @note dataIn may use same buffer as dataOut
+    */
+   void bulkTxRxBytes(uint32_t command, uint32_t dataSize, const uint8_t *dataOut, uint8_t *dataIn=0, SPICallbackFunction callback=0);
+
+   /**
+    *  Bulk transmit and receive a series of 9 to 16-bit values
+    *
+    *  @param command   PUSHR command bits (CTAS, PCS) computed once by the caller e.g. getPushrValue().\n
+    *                   CONT and EOQ are added as needed
+    *  @param dataSize  Number of values to transfer
+    *  @param dataOut   Transmit values (may be NULL for Rx only)
+    *  @param dataIn    Receive buffer (may be NULL for Tx only)
+    *  @param callback  Called when transfer completes (may be NULL)
+    *
+    *  @note See bulkTxRxBytes()
+    */
+   void bulkTxRxWords(uint32_t command, uint32_t dataSize, const uint16_t *dataOut, uint16_t *dataIn=0, SPICallbackFunction callback=0);
+
+   /**
+    * Check if a DMA bulk transfer is in progress
+    *
+    * @return true if busy
+    */
+   bool isBusy() const {
+      return dmaBusy;
+   }
+
+   /**
+    * Wait until any DMA bulk transfer is complete
+    */
+   void waitWhileBusy() const {
+      while (dmaBusy) {
+         __asm__("nop");
+      }
+   }
+
    /**
     * Transmit and receive a value over SPI
     *
@@ -351,9 +467,36 @@ public:
 template<class Info>
 class Spi_T : public Spi {
 
+protected:
+   /** Used by DMA handlers to obtain handle of object */
+   static Spi_T *thisPtr;
+
+   /** Transmit DMA channel complete handler */
+   static void dmaTxHandler() {
+      thisPtr->dmaTxComplete();
+   }
+
+   /** Receive DMA channel complete handler */
+   static void dmaRxHandler() {
+      thisPtr->dmaRxComplete();
+   }
+
 public:
    virtual ~Spi_T() {}
 
+   /**
+    * Enable DMA for bulk transfers
+    *
+    * @param txChannel  DMA channel for transmit
+    * @param rxChannel  DMA channel for receive
+    *
+    * @note The DMA channel interrupt handlers (Dma0::irqNHandler) must be installed
+    */
+   void enableDma(unsigned txChannel, unsigned rxChannel) {
+      thisPtr = this;
+      configureDma(txChannel, rxChannel, Info::dmaTxSlot, Info::dmaRxSlot, dmaTxHandler, dmaRxHandler);
+   }
+
    virtual void enablePins() {
       // Configure SPI pins
       Info::initPCRs(PORT_PCR_DSE(1)|PORT_PCR_SRE(1)|PORT_PCR_PE(1)|PORT_PCR_PS(1));
@@ -422,6 +565,9 @@ public:
 
 };
 
+/** Used by DMA handlers to obtain handle of object */
+template<class Info> Spi_T<Info> *Spi_T<Info>::thisPtr = 0;
+
 #if defined(USBDM_SPI0_IS_DEFINED)
 /**
  * @brief Template class representing a SPI0 interface
@@ -140,6 +140,16 @@ public:
    static constexpr uint8_t MS_VENDOR_CODE = 0x30;
    static const     uint8_t ms_osStringDescriptor[];
 
+   /**
+    * USB interrupt statistics
+    */
+   struct IrqStatistics {
+      uint32_t interrupts;  //!< Number of interrupt handler entries
+      uint32_t tokens;      //!< Number of tokens processed
+      uint32_t coalesced;   //!< Number of interrupt sources serviced without a separate handler entry
+      uint32_t sofs;        //!< Number of SOF tokens passed to deferred handler
+   };
+
 protected:
    /** Mask for all USB interrupts */
    static constexpr uint8_t USB_INTMASKS =
@@ -171,7 +181,74 @@ protected:
    /** Function to call when SETUP transaction is complete */
    static void (*setupCompleteCallback)();
 
+   /** SOF processing requested by interrupt handler */
+   static volatile bool sofPending;
+
+   /** Interrupt statistics */
+   static IrqStatistics irqStatistics;
+
 public:
+   /**
+    * Handler for USB interrupt
+    *
+    * Services all pending interrupt sources before returning.\n
+    * The token FIFO is drained completely and SOF processing is deferred to handleDeferredSOF()
+    */
+   static void irqHandler();
+
+   /**
+    * Disable USB interrupt in NVIC
+    *
+    * @return Previous enable state to pass to restoreUsbIrq()
+    */
+   static bool disableUsbIrq() {
+      uint32_t irqNum  = (uint32_t)Info::irqNums[0];
+      bool     enabled = (NVIC->ISER[irqNum>>5] & (1U<<(irqNum&0x1F))) != 0;
+      NVIC_DisableIRQ(Info::irqNums[0]);
+      return enabled;
+   }
+
+   /**
+    * Restore USB interrupt enable state saved by disableUsbIrq()
+    *
+    * @param enabled Previous enable state
+    */
+   static void restoreUsbIrq(bool enabled) {
+      if (enabled) {
+         NVIC_EnableIRQ(Info::irqNums[0]);
+      }
+   }
+
+   /**
+    * Carry out SOF processing deferred by the interrupt handler\n
+    * Called from the lowest priority interrupt (PendSV_Handler())
+    */
+   static void handleDeferredSOF() {
+      if (!sofPending) {
+         return;
+      }
+      sofPending = false;
+      // SOF call-back shares end-point state with the USB interrupt handler
+      bool enabled = disableUsbIrq();
+      handleSOFToken();
+      restoreUsbIrq(enabled);
+   }
+
+   /**
+    * Get USB interrupt statistics
+    *
+    * @param statistics Statistics returned
+    * @param clear      Clear statistics after reading
+    */
+   static void getIrqStatistics(IrqStatistics &statistics, bool clear=false) {
+      bool enabled = disableUsbIrq();
+      statistics = irqStatistics;
+      if (clear) {
+         irqStatistics = {0, 0, 0, 0};
+      }
+      restoreUsbIrq(enabled);
+   }
+
    /**
     * Initialise USB to default settings\n
     * Configures all USB pins
@@ -198,6 +275,9 @@ public:
 
          // Set priority level
          NVIC_SetPriority(Info::irqNums[0], Info::irqLevel);
+
+         // Deferred SOF processing at lowest priority
+         NVIC_SetPriority(PendSV_IRQn, (1<<__NVIC_PRIO_BITS)-1);
       }
       else {
          // Disable interrupts
@@ -533,6 +613,14 @@ SetupPacket UsbBase_T<Info, EP0_SIZE>::ep0SetupBuffer;   //!< Buffer for EP0 Set
 template<class Info, int EP0_SIZE>
 bool UsbBase_T<Info, EP0_SIZE>::activityFlag = false;
 
+/** SOF processing requested by interrupt handler */
+template<class Info, int EP0_SIZE>
+volatile bool UsbBase_T<Info, EP0_SIZE>::sofPending = false;
+
+/** Interrupt statistics */
+template<class Info, int EP0_SIZE>
+typename UsbBase_T<Info, EP0_SIZE>::IrqStatistics UsbBase_T<Info, EP0_SIZE>::irqStatistics = {0, 0, 0, 0};
+
 /** USB Control endpoint EP0 */
 template <class Info, int EP0_SIZE>
 const ControlEndpoint<Info, EP0_SIZE> UsbBase_T<Info, EP0_SIZE>::ep0;
@@ -680,6 +768,12 @@ void UsbBase_T<Info, EP0_SIZE>::handleTokenComplete() {
    // Endpoint number
    uint8_t   endPoint = ((uint8_t)usbStat)>>4;
 
+   usbTrace(UsbTrace_Token, endPoint,
+         ((usbStat&USB_STAT_TX_MASK)?UsbTrace_TxMask:0)|
+         ((usbStat&USB_STAT_ODD_MASK)?UsbTrace_OddMask:0)|
+         (bdt->u.result.data0_1?UsbTrace_Data1Mask:0),
+         bdt->u.result.tok_pid);
+
    if (endPoint != CONTROL_ENDPOINT) {
       // Other end-points handled by derived class
       UsbImplementation::handleTokenComplete();
@@ -716,6 +810,91 @@ void UsbBase_T<Info, EP0_SIZE>::handleTokenComplete() {
    }
 }
 
+/**
+ * Handler for USB interrupt
+ *
+ * Services all pending interrupt sources before returning.\n
+ * Clearing TOKDNE advances the USB STAT FIFO (up to 4 tokens) so tokens are
+ * drained in a loop rather than taking an exception entry for each one.\n
+ * SOF processing (LED, CDC notification etc.) is deferred to PendSV so it doesn't delay token handling.
+ */
+template<class Info, int EP0_SIZE>
+void UsbBase_T<Info, EP0_SIZE>::irqHandler() {
+   irqStatistics.interrupts++;
+
+   unsigned serviced = 0;
+   for(;;) {
+      // All active flags
+      uint8_t interruptFlags = usb->ISTAT;
+
+      // Get active and enabled interrupt flags
+      uint8_t enabledInterruptFlags = interruptFlags & usb->INTEN;
+
+      if (enabledInterruptFlags == 0) {
+         break;
+      }
+      serviced++;
+      if ((enabledInterruptFlags&USB_ISTAT_USBRST_MASK) != 0) {
+         // Reset signaled on Bus - everything else is discarded
+         handleUSBReset();
+         usb->ISTAT = USB_ISTAT_USBRST_MASK; // Clear source
+         break;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_TOKDNE_MASK) != 0) {
+         // Token complete interrupt
+         handleTokenComplete();
+         irqStatistics.tokens++;
+         // Clear source - exposes next token in STAT FIFO
+         usb->ISTAT = USB_ISTAT_TOKDNE_MASK;
+         // Drain tokens before other sources
+         continue;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_SOFTOK_MASK) != 0) {
+         // SOF Token - processed at low priority
+         usb->ISTAT = USB_ISTAT_SOFTOK_MASK; // Clear source
+         irqStatistics.sofs++;
+         sofPending = true;
+         SCB->ICSR  = SCB_ICSR_PENDSVSET_Msk;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_RESUME_MASK) != 0) {
+         // Resume signaled on Bus
+         handleUSBResume();
+         // Clear source
+         usb->ISTAT = USB_ISTAT_RESUME_MASK;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_STALL_MASK) != 0) {
+         // Stall sent
+         handleStallComplete();
+         // Clear source
+         usb->ISTAT = USB_ISTAT_STALL_MASK;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_SLEEP_MASK) != 0) {
+         // Bus Idle 3ms => sleep
+         handleUSBSuspend();
+         // Clear source
+         usb->ISTAT = USB_ISTAT_SLEEP_MASK;
+      }
+      if ((enabledInterruptFlags&USB_ISTAT_ERROR_MASK) != 0) {
+         // Any Error
+         PRINTF("Error s=0x%02X\n", usb->ERRSTAT);
+         usb->ERRSTAT = 0xFF;
+         // Clear source
+         usb->ISTAT = USB_ISTAT_ERROR_MASK;
+      }
+      uint8_t unexpectedFlags = enabledInterruptFlags &
+            ~(USB_ISTAT_SOFTOK_MASK|USB_ISTAT_RESUME_MASK|USB_ISTAT_STALL_MASK|USB_ISTAT_SLEEP_MASK|USB_ISTAT_ERROR_MASK);
+      if (unexpectedFlags != 0) {
+         // Unexpected interrupt
+         PRINTF("Unexpected interrupt, flags=0x%02X\n", interruptFlags);
+         // Clear & ignore
+         usb->ISTAT = unexpectedFlags;
+      }
+   }
+   if (serviced > 1) {
+      irqStatistics.coalesced += serviced-1;
+   }
+}
+
 /**
  * Handler for USB Bus reset\n
  * Re-initialises the interface
@@ -723,7 +902,7 @@ void UsbBase_T<Info, EP0_SIZE>::handleTokenComplete() {
 template<class Info, int EP0_SIZE>
 void UsbBase_T<Info, EP0_SIZE>::handleUSBReset() {
 //   PUTS("\nReset");
-   //   pushState('R');
+   usbTrace(UsbTrace_Reset, 0, 0, 0);
 
    // Disable all interrupts
    usb->INTEN = 0x00;
@@ -872,6 +1051,11 @@ template<class Info, int EP0_SIZE>
 void UsbBase_T<Info, EP0_SIZE>::initialise() {
    enable();
 
+#ifdef USB_TRACE
+   // Time-stamps for event trace
+   UsbTrace::initialise();
+#endif
+
    sofCallbackFunction = nullptr;
 
    // Make sure no interrupt during setup
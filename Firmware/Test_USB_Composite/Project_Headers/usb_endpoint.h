@@ -17,6 +17,7 @@
  */
 #include "usb_defs.h"
 #include "derivative.h"
+#include "usb_trace.h"
 
 namespace USBDM {
 
@@ -121,12 +122,15 @@ public:
       // Odd/even buffer
       bool isOdd = usbStat&USB_STAT_ODD_MASK;
 
+      usbTrace(UsbTrace_FlipOddEven, ENDPOINT_NUM,
+            (isTx?UsbTrace_TxMask:0)|(isOdd?UsbTrace_OddMask:0), fHardwareState.state);
+
       if (isTx) {
          // Flip Transmit buffer
          fHardwareState.txOdd = !isOdd;
          if ((endPointBdts[ENDPOINT_NUM].txEven.u.bits&BDTEntry_OWN_MASK) ||
              (endPointBdts[ENDPOINT_NUM].txOdd.u.bits&BDTEntry_OWN_MASK)) {
-            printf("Opps-Tx\n");
+            usbTrace(UsbTrace_BdtBusyTx, ENDPOINT_NUM, getTxFlags(), fHardwareState.state);
          }
       }
       else {
@@ -135,6 +139,27 @@ public:
       }
    }
 
+   /**
+    * Get trace flags for transmit side
+    *
+    * @return UsbTrace_TxMask etc.
+    */
+   static uint8_t getTxFlags() {
+      return UsbTrace_TxMask|
+            (fHardwareState.txOdd?UsbTrace_OddMask:0)|
+            (fHardwareState.txData1?UsbTrace_Data1Mask:0);
+   }
+
+   /**
+    * Get trace flags for receive side
+    *
+    * @return UsbTrace_OddMask etc.
+    */
+   static uint8_t getRxFlags() {
+      return (fHardwareState.rxOdd?UsbTrace_OddMask:0)|
+            (fHardwareState.rxData1?UsbTrace_Data1Mask:0);
+   }
+
    /**
     * Return hardware state
     */
@@ -172,6 +197,7 @@ public:
     * Stall endpoint
     */
    static void stall() {
+      usbTrace(UsbTrace_Stall, ENDPOINT_NUM, 0, fHardwareState.state);
       fHardwareState.state               = EPStall;
       usb->ENDPOINT[ENDPOINT_NUM].ENDPT |= USB_ENDPT_EPSTALL_MASK;
    }
@@ -232,6 +258,7 @@ public:
          }
       }
       fHardwareState.state = state;
+      usbTrace(UsbTrace_StartTx, ENDPOINT_NUM, getTxFlags(), state);
       // Configure the BDT for transfer
       initialiseBdtTx();
    }
@@ -245,14 +272,14 @@ public:
 
       if ((endPointBdts[ENDPOINT_NUM].txEven.u.bits&BDTEntry_OWN_MASK) ||
           (endPointBdts[ENDPOINT_NUM].txOdd.u.bits&BDTEntry_OWN_MASK)) {
-         printf("Opps-Tx\n");
+         usbTrace(UsbTrace_BdtBusyTx, ENDPOINT_NUM, getTxFlags(), fHardwareState.state);
       }
       uint16_t size = fDataRemaining;
       if (size > EP_MAXSIZE) {
          size = EP_MAXSIZE;
       }
-      // fDataBuffer may be nullptr to indicate using fDataBuffer directly
-      if (fDataBuffer != nullptr) {
+      // fDataPtr may be nullptr to indicate using fDataBuffer directly
+      if (fDataPtr != nullptr) {
          // Copy the Tx data to EP buffer
          (void) memcpy(fDataBuffer, fDataPtr, size);
          // Pointer to _next_ data
@@ -284,6 +311,7 @@ public:
       fDataRemaining       = bufSize; // Total bytes to Rx
       fDataPtr             = bufPtr;  // Where to (eventually) place data
       fHardwareState.state = state;   // State to adopt
+      usbTrace(UsbTrace_StartRx, ENDPOINT_NUM, getRxFlags(), state);
       initialiseBdtRx(); // Configure the BDT for transfer
    }
 
@@ -303,7 +331,7 @@ public:
       }
       if ((endPointBdts[ENDPOINT_NUM].rxEven.u.bits&BDTEntry_OWN_MASK) ||
           (endPointBdts[ENDPOINT_NUM].rxOdd.u.bits&BDTEntry_OWN_MASK)) {
-         printf("Opps-Rx\n");
+         usbTrace(UsbTrace_BdtBusyRx, ENDPOINT_NUM, getRxFlags(), fHardwareState.state);
       }
       // Set up to Rx packet
       // Always used maximum size even if expecting less data
@@ -348,7 +376,7 @@ public:
     */
    static void handleOutToken() {
       uint8_t transferSize = 0;
-//      pushState('O');
+      usbTrace(UsbTrace_OutToken, ENDPOINT_NUM, getRxFlags(), fHardwareState.state);
 
       switch (fHardwareState.state) {
          case EPDataOut:        // Receiving a sequence of OUT packets
@@ -387,6 +415,7 @@ public:
     * Handle IN token [Tx, device -> host]
     */
    static void handleInToken() {
+      usbTrace(UsbTrace_InToken, ENDPOINT_NUM, getTxFlags(), fHardwareState.state);
       fHardwareState.txData1 = !fHardwareState.txData1;   // Toggle DATA0/1 for next packet
       //   PUTS(fHardwareState[BDM_OUT_ENDPOINT].data0_1?"ep2HandleInToken-T-1\n":"ep2HandleInToken-T-0\n");
 
@@ -0,0 +1,189 @@
+/*
+ * usb_trace.h
+ *
+ *  USB event trace for end-point state-machine profiling
+ *
+ *  Events are recorded by the USB interrupt handler (single producer) into a ring buffer.
+ *  The buffer may be read at any time without stopping the producer - the reader
+ *  detects entries overwritten during the read by re-checking the head index.
+ *
+ *  Tracing is enabled at compile time by defining USB_TRACE (e.g. -DUSB_TRACE).
+ *  When disabled usbTrace() is empty and no storage is allocated.
+ */
+
+#ifndef PROJECT_HEADERS_USB_TRACE_H_
+#define PROJECT_HEADERS_USB_TRACE_H_
+
+#include <stdint.h>
+#include "derivative.h"
+
+namespace USBDM {
+
+/**
+ * Trace event types
+ */
+enum UsbTraceEvent : uint8_t {
+   UsbTrace_Token,        //!< Token complete interrupt (state = token PID)
+   UsbTrace_FlipOddEven,  //!< Odd/even buffer flipped
+   UsbTrace_InToken,      //!< IN token handled by end-point (state = state before)
+   UsbTrace_OutToken,     //!< OUT token handled by end-point (state = state before)
+   UsbTrace_StartTx,      //!< IN transaction started (state = new state)
+   UsbTrace_StartRx,      //!< OUT transaction started (state = new state)
+   UsbTrace_BdtBusyTx,    //!< IN BDT already owned by USB when configuring
+   UsbTrace_BdtBusyRx,    //!< OUT BDT already owned by USB when configuring
+   UsbTrace_Stall,        //!< End-point stalled
+   UsbTrace_Reset,        //!< USB bus reset
+};
+
+/** Flag values for UsbTraceEntry.flags */
+static constexpr uint8_t UsbTrace_OddMask   = (1<<0);  //!< Odd BDT
+static constexpr uint8_t UsbTrace_Data1Mask = (1<<1);  //!< DATA1 (else DATA0)
+static constexpr uint8_t UsbTrace_TxMask    = (1<<2);  //!< Transmit (IN) direction
+
+/**
+ * Trace entry (8 bytes, little-endian)
+ */
+struct UsbTraceEntry {
+   uint32_t timestamp;   //!< Probe DWT cycle count
+   uint8_t  event;       //!< UsbTraceEvent
+   uint8_t  endpoint;    //!< End-point number
+   uint8_t  flags;       //!< UsbTrace_OddMask etc.
+   uint8_t  state;       //!< Event specific (EndpointState, token PID)
+};
+
+/** Number of trace entries - must be a power of 2 */
+static constexpr unsigned USB_TRACE_SIZE = 128;
+
+/**
+ * Lock-free single-producer trace ring buffer
+ *
+ * @tparam size Number of entries (power of 2)
+ */
+template<unsigned size>
+class UsbTrace_T {
+
+   static_assert((size&(size-1)) == 0, "Trace size must be a power of 2");
+
+   /** Trace entries */
+   static UsbTraceEntry entries[size];
+
+   /** Total number of entries written (index of next entry) */
+   static volatile uint32_t head;
+
+public:
+   /**
+    * Enable probe cycle counter used for time-stamps
+    */
+   static void initialise() {
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+   }
+
+   /**
+    * Record event
+    *
+    * @param event    Event type
+    * @param endpoint End-point number
+    * @param flags    UsbTrace_OddMask etc.
+    * @param state    Event specific value
+    *
+    * @note Must only be called from a single interrupt level (USB handler)
+    */
+   static void record(UsbTraceEvent event, uint8_t endpoint, uint8_t flags, uint8_t state) {
+      uint32_t index = head;
+      UsbTraceEntry &entry = entries[index&(size-1)];
+      entry.timestamp = DWT->CYCCNT;
+      entry.event     = event;
+      entry.endpoint  = endpoint;
+      entry.flags     = flags;
+      entry.state     = state;
+      // Publish entry
+      head = index+1;
+   }
+
+   /**
+    * Get total number of events recorded
+    *
+    * @return Event count (index of next entry)
+    */
+   static uint32_t getHead() {
+      return head;
+   }
+
+   /**
+    * Read trace entries
+    *
+    * @param [inout] from     Index of first entry wanted.
+    *                         Updated to index of first entry returned (older entries may have been overwritten)
+    * @param [out]   buffer   Buffer for entries
+    * @param [in]    maxCount Maximum number of entries to read
+    *
+    * @return Number of entries read
+    */
+   static unsigned read(uint32_t &from, UsbTraceEntry *buffer, unsigned maxCount) {
+      uint32_t end = head;
+      if ((int32_t)(end-from) > (int32_t)size) {
+         // Oldest entries already overwritten
+         from = end-size;
+      }
+      if ((int32_t)(end-from) < 0) {
+         // Start is in the future
+         from = end;
+      }
+      unsigned count = end-from;
+      if (count > maxCount) {
+         count = maxCount;
+      }
+      for (unsigned sub=0; sub<count; sub++) {
+         buffer[sub] = entries[(from+sub)&(size-1)];
+      }
+      // Discard entries overwritten by the producer during the copy
+      uint32_t overwritten = head-size;
+      if ((int32_t)(overwritten-from) > 0) {
+         unsigned discard = overwritten-from;
+         if (discard > count) {
+            discard = count;
+         }
+         count -= discard;
+         from  += discard;
+         for (unsigned sub=0; sub<count; sub++) {
+            buffer[sub] = buffer[sub+discard];
+         }
+      }
+      return count;
+   }
+};
+
+#ifdef USB_TRACE
+template<unsigned size>
+UsbTraceEntry UsbTrace_T<size>::entries[size];
+
+template<unsigned size>
+volatile uint32_t UsbTrace_T<size>::head = 0;
+#endif
+
+/** USB event trace */
+using UsbTrace = UsbTrace_T<USB_TRACE_SIZE>;
+
+/**
+ * Record USB trace event (no code generated unless USB_TRACE is defined)
+ *
+ * @param event    Event type
+ * @param endpoint End-point number
+ * @param flags    UsbTrace_OddMask etc.
+ * @param state    Event specific value
+ */
+static inline void usbTrace(UsbTraceEvent event, uint8_t endpoint, uint8_t flags, uint8_t state) {
+#ifdef USB_TRACE
+   UsbTrace::record(event, endpoint, flags, state);
+#else
+   (void)event;
+   (void)endpoint;
+   (void)flags;
+   (void)state;
+#endif
+}
+
+}; // end namespace USBDM
+
+#endif /* PROJECT_HEADERS_USB_TRACE_H_ */
@@ -0,0 +1,93 @@
+/**
+ * @file analogue-stream-example.cpp
+ */
+#include <stdio.h>
+#include "system.h"
+#include "derivative.h"
+#include "hardware.h"
+#include "adc_stream.h"
+
+using namespace USBDM;
+
+/*
+ * Demonstrates continuous conversion of a channel sequence using PDB + DMA
+ */
+
+// Connection mapping - change as required
+// (ch(19) = light sensor on FRDM-K20)
+using adc    = Adc0;
+using stream = Adc0Stream;
+
+/** Channels converted in turn */
+static const uint32_t sequence[] = {
+      Adc0Channel<19>::sc1Value,
+      Adc0Channel<8>::sc1Value,
+};
+
+/** Number of channels in sequence */
+static constexpr unsigned NUM_CHANNELS = sizeof(sequence)/sizeof(sequence[0]);
+
+/** Results per callback */
+static constexpr unsigned BLOCK_SIZE = 64*NUM_CHANNELS;
+
+/** Double buffer for results */
+static uint16_t buffer[2*BLOCK_SIZE];
+
+/** Running sums for each channel (updated from DMA interrupt) */
+static volatile uint32_t sums[NUM_CHANNELS];
+
+/** Number of blocks processed */
+static volatile uint32_t blocks;
+
+/*
+ * Called as each half of buffer is filled
+ */
+void handler(const uint16_t *block, unsigned blockSize) {
+   uint32_t totals[NUM_CHANNELS] = {0};
+   for (unsigned index=0; index<blockSize; index++) {
+      totals[index%NUM_CHANNELS] += block[index];
+   }
+   for (unsigned channel=0; channel<NUM_CHANNELS; channel++) {
+      sums[channel] = totals[channel];
+   }
+   blocks++;
+}
+
+/*
+ * DMA channel 0 handler - moves results
+ */
+extern "C" void DMA0_IRQHandler() {
+   Dma0::irq0Handler();
+}
+
+int main(void) {
+   // Do not delete this banner - otherwise putchar() macro breaks.
+   printf("Starting\n");
+
+   // Enable ADC
+   adc::enable();
+   adc::setResolution(resolution_12bit_se);
+
+   // DMA channel 0 moves results, channel 1 updates ADC channel
+   stream::configure(sequence, NUM_CHANNELS, buffer, BLOCK_SIZE, 0, 1, handler);
+
+   // 20k conversions/s => 10k samples/s per channel
+   stream::start(20000);
+
+   // Check for error so far
+   checkError();
+
+   for(;;) {
+      uint32_t lastBlocks = blocks;
+      while (blocks == lastBlocks) {
+         __WFI();
+      }
+      if (stream::checkSequenceError()) {
+         printf("Sample rate too high\n");
+      }
+      for (unsigned channel=0; channel<NUM_CHANNELS; channel++) {
+         printf("%6lu ", (unsigned long)(sums[channel]/(BLOCK_SIZE/NUM_CHANNELS)));
+      }
+      printf("\n");
+   }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file fxos8700cq-stream-example.cpp
+ */
+#include <stdio.h>
+#include "system.h"
+#include "derivative.h"
+#include "hardware.h"
+#include "i2c.h"
+#include "fxos8700cq.h"
+#include "usb.h"
+
+using namespace USBDM;
+
+/*
+ * Demonstrates streaming of FXOS8700CQ Accelerometer and Magnetometer data over USB bulk IN end-point
+ *
+ * Each FIFO watermark interrupt triggers a single I2C burst read of the FIFO.
+ * The decoded samples are packed into records and queued for the bulk IN end-point.
+ *
+ * Record format (little-endian):
+ *    uint16_t sequence, uint8_t count, uint8_t fifoStatus, uint8_t magnetometerStatus,
+ *    int16_t magnetometer[3], int16_t accelerometer[count][3]
+ *
+ * You may need to change the pin-mapping of the I2C interface
+ */
+
+// Connection mapping - change as required
+// FXOS8700CQ INT1 (open-drain, active low)
+using Int1 = GpioD<0>;
+
+/** Samples per watermark interrupt */
+static constexpr unsigned WATERMARK = 16;
+
+/** Accelerometer/Magnetometer */
+static FXOS8700CQ *accelmag;
+
+/** Number of records dropped due to USB not keeping up */
+static volatile uint32_t dropped;
+
+/*
+ * Called from I2C interrupt as each block is read
+ */
+void handler(const FXOS8700CQ::StreamBlock &block) {
+   uint8_t record[9+6*FXOS8700CQ::FIFO_SIZE];
+   uint8_t *p = record;
+
+   *p++ = (uint8_t)block.sequence;
+   *p++ = (uint8_t)(block.sequence>>8);
+   *p++ = block.count;
+   *p++ = block.fifoStatus;
+   *p++ = block.magnetometerStatus;
+   for (unsigned axis=0; axis<3; axis++) {
+      *p++ = (uint8_t)block.magnetometer[axis];
+      *p++ = (uint8_t)(block.magnetometer[axis]>>8);
+   }
+   for (unsigned sample=0; sample<block.count; sample++) {
+      for (unsigned axis=0; axis<3; axis++) {
+         *p++ = (uint8_t)block.accelerometer[sample][axis];
+         *p++ = (uint8_t)(block.accelerometer[sample][axis]>>8);
+      }
+   }
+   if (!Usb0::queueBulkInData(p-record, record)) {
+      dropped++;
+   }
+}
+
+/*
+ * I2C0 handler - drives queued transactions
+ */
+extern "C" void I2C0_IRQHandler() {
+   I2c0::irqHandler();
+}
+
+/*
+ * Port D handler - FXOS8700CQ FIFO watermark (INT1)
+ */
+extern "C" void PORTD_IRQHandler() {
+   // Clear all port flags
+   PORTD->ISFR = PORTD->ISFR;
+   accelmag->fifoInterrupt();
+}
+
+int main() {
+   printf("Starting\n");
+
+   Usb0::initialise();
+
+   // Instantiate interface
+   I2c *i2c = new I2c0(400000, i2c_interrupt);
+   accelmag = new FXOS8700CQ(i2c, FXOS8700CQ::ACCEL_2Gmode);
+
+   uint8_t id = accelmag->readID();
+   printf("Device ID = 0x%02X (should be 0xC7)\n", id);
+
+   // INT1 interrupt on falling edge
+   Int1::setInput(PORT_PCR_IRQC(10)|PORT_PCR_PE_MASK|PORT_PCR_PS_MASK);
+   NVIC_EnableIRQ(PORTD_IRQn);
+
+   // Hybrid mode - 400 samples/s each of accelerometer and magnetometer
+   if (!accelmag->startStreaming(FXOS8700CQ::ACCEL_MAG, WATERMARK, handler)) {
+      printf("Failed to start streaming\n");
+   }
+
+   for(;;) {
+      __WFI();
+   }
+}
@@ -153,7 +153,11 @@ enum {
  * @param mode - Mode of operation (gain and filtering)
  */
 FXOS8700CQ::FXOS8700CQ(USBDM::I2c *i2c, AccelerometerMode mode) : i2c(i2c) {
-   failedInit = false;
+   failedInit     = false;
+   streamCallback = nullptr;
+   streamBusy     = false;
+   streamPending  = false;
+   watermark      = 0;
    if (readReg(WHO_AM_I) != WHO_AM_I_VALUE) {
       failedInit = true;
       return;
@@ -432,3 +436,188 @@ void FXOS8700CQ::calibrateMagnetometer(int time) {
    writeReg(M_CTRL_REG1, originalMControlReg1Value);
    writeReg(CTRL_REG1, originalControlReg1Value);
 }
+
+/**
+ * Start streaming mode
+ *
+ * @param mode      ACCEL_ONLY (800 Hz) or ACCEL_MAG (hybrid, 400 Hz each)
+ * @param watermark Samples per block (1..FIFO_SIZE-1)
+ * @param callback  Call-back for each block
+ *
+ * @return false if parameters are invalid
+ */
+bool FXOS8700CQ::startStreaming(Mode mode, unsigned watermark, StreamCallback callback) {
+   if (failedInit || (mode == MAG_ONLY) || (watermark == 0) || (watermark >= FIFO_SIZE) || (callback == nullptr)) {
+      return false;
+   }
+   stopStreaming();
+
+   this->watermark      = watermark;
+   streamBlock.sequence = 0;
+
+   // Transactions are re-used for every burst
+   fifoRegister                 = F_STATUS;
+   fifoTransaction.address      = DEVICE_ADDRESS;
+   fifoTransaction.flags        = i2c_holdBus;  // REPEATED-START into magnetometer read
+   fifoTransaction.txSize       = 1;
+   fifoTransaction.txData       = &fifoRegister;
+   fifoTransaction.rxSize       = 1+6*watermark;
+   fifoTransaction.rxData       = fifoData;
+   fifoTransaction.callback     = nullptr;
+   fifoTransaction.context      = this;
+
+   magRegister                  = M_DR_STATUS;
+   magTransaction.address       = DEVICE_ADDRESS;
+   magTransaction.flags         = i2c_stop;
+   magTransaction.txSize        = 1;
+   magTransaction.txData        = &magRegister;
+   magTransaction.rxSize        = sizeof(magData);
+   magTransaction.rxData        = magData;
+   magTransaction.callback      = burstComplete;
+   magTransaction.context       = this;
+
+   // Make inactive so setting can be changed
+   writeReg(CTRL_REG1, 0x00);
+
+   // Burst reads of the FIFO must wrap within OUT_X_MSB..OUT_Z_LSB rather than continue to the magnetometer
+   savedMCtrlReg2 = readReg(M_CTRL_REG2);
+   writeReg(M_CTRL_REG2, savedMCtrlReg2&~FXOS8700CQ_M_CTRL_REG2_M_HYB_AUTOINC_MODE_MASK);
+   enable(mode);
+
+   // Circular FIFO with watermark interrupt on INT1 (replaces DRDY)
+   writeReg(F_SETUP,   FXOS8700CQ_F_SETUP_F_MODE(1)|FXOS8700CQ_F_SETUP_F_WMRK(watermark));
+   writeReg(CTRL_REG4, FXOS8700CQ_CTRL_REG4_INT_EN_FIFO_MASK);
+   writeReg(CTRL_REG5, FXOS8700CQ_CTRL_REG5_INT_CFG_FIFO_MASK);
+
+   streamCallback = callback;
+
+   writeReg(CTRL_REG1,
+         FXOS8700CQ_CTRL_REG1_ASLP_RATE(0) | /* 50 Hz auto-sleep rate               */
+         FXOS8700CQ_CTRL_REG1_DR(0) |        /* 800 Hz update rate (400 Hz hybrid)   */
+         FXOS8700CQ_CTRL_REG1_ACTIVE_MASK);  /* Active     */
+   return true;
+}
+
+/**
+ * Stop streaming mode and restore polled operation
+ *
+ * @note Must not be called from an interrupt handler
+ */
+void FXOS8700CQ::stopStreaming() {
+   if (streamCallback == nullptr) {
+      return;
+   }
+   streamCallback = nullptr;
+
+   // Wait for burst in progress
+   while (streamBusy) {
+      __asm__("nop");
+   }
+   // Make inactive so setting can be changed
+   writeReg(CTRL_REG1, 0x00);
+
+   // Restore DRDY operation
+   writeReg(F_SETUP,     FXOS8700CQ_F_SETUP_F_MODE(0));
+   writeReg(CTRL_REG4,   FXOS8700CQ_CTRL_REG4_INT_EN_DRDY_MASK);
+   writeReg(CTRL_REG5,   FXOS8700CQ_CTRL_REG5_INT_CFG_DRDY_MASK);
+   writeReg(M_CTRL_REG2, savedMCtrlReg2);
+
+   writeReg(CTRL_REG1,
+         FXOS8700CQ_CTRL_REG1_ASLP_RATE(0) | /* 50 Hz auto-sleep rate */
+         FXOS8700CQ_CTRL_REG1_DR(2) |        /* 200 Hz update rate    */
+         FXOS8700CQ_CTRL_REG1_ACTIVE_MASK);  /* Active     */
+}
+
+/**
+ * Queue burst read of FIFO and magnetometer
+ *
+ * @note Only one burst is outstanding (streamBusy) so the transactions may be re-used
+ * @note Called with interrupts disabled
+ */
+void FXOS8700CQ::startBurst() {
+   // Queue both or neither - a lone FIFO transaction would still be pending when re-used
+   if (i2c->queueSpace() < 2) {
+      // I2C queue full - wait for next watermark
+      streamBusy = false;
+      return;
+   }
+   (void)i2c->submit(fifoTransaction);
+   (void)i2c->submit(magTransaction);
+}
+
+/**
+ * Handle FIFO watermark interrupt (INT1 pin falling edge)
+ */
+void FXOS8700CQ::fifoInterrupt() {
+   if (streamCallback == nullptr) {
+      return;
+   }
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   if (streamBusy) {
+      // Handled when current burst completes
+      streamPending = true;
+   }
+   else {
+      streamBusy = true;
+      startBurst();
+   }
+   __set_PRIMASK(primask);
+}
+
+/**
+ * I2C call-back on completion of burst
+ *
+ * @param transaction Magnetometer transaction (context is FXOS8700CQ)
+ */
+void FXOS8700CQ::burstComplete(I2cTransaction &transaction) {
+   FXOS8700CQ  *me    = static_cast<FXOS8700CQ*>(transaction.context);
+   StreamBlock &block = me->streamBlock;
+
+   unsigned available = 0;
+   if ((me->fifoTransaction.errorCode == 0) && (transaction.errorCode == 0)) {
+      uint8_t  fifoStatus = me->fifoData[0];
+      unsigned count      = me->watermark;
+
+      available = fifoStatus&FXOS8700CQ_F_STATUS_F_CNT_MASK;
+      if (count > available) {
+         // Don't report entries read from an empty FIFO
+         count = available;
+      }
+      available -= count;
+
+      block.count              = count;
+      block.fifoStatus         = fifoStatus;
+      block.magnetometerStatus = me->magData[0];
+      block.magnetometer[0]    = (int16_t)((me->magData[1]<<8)+me->magData[2]);
+      block.magnetometer[1]    = (int16_t)((me->magData[3]<<8)+me->magData[4]);
+      block.magnetometer[2]    = (int16_t)((me->magData[5]<<8)+me->magData[6]);
+
+      const uint8_t *data = me->fifoData+1;
+      for (unsigned sample=0; sample<count; sample++) {
+         block.accelerometer[sample][0] = ((int16_t)((data[0]<<8)+data[1]))>>2;
+         block.accelerometer[sample][1] = ((int16_t)((data[2]<<8)+data[3]))>>2;
+         block.accelerometer[sample][2] = ((int16_t)((data[4]<<8)+data[5]))>>2;
+         data += 6;
+      }
+      StreamCallback callback = me->streamCallback;
+      if (callback != nullptr) {
+         callback(block);
+      }
+   }
+   // Sequence advances on error so the consumer can detect the lost block
+   block.sequence++;
+
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   if ((me->streamCallback != nullptr) && (me->streamPending || (available >= me->watermark))) {
+      // FIFO still above watermark (no new INT1 edge) or interrupt occurred during burst
+      me->streamPending = false;
+      me->startBurst();
+   }
+   else {
+      me->streamPending = false;
+      me->streamBusy    = false;
+   }
+   __set_PRIMASK(primask);
+}
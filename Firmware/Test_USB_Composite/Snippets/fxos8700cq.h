@@ -81,6 +81,17 @@ namespace USBDM {
 
 #define FXOS8700CQ_STATUS_XYZDR_MASK 	(1<<3)
 
+#define FXOS8700CQ_F_STATUS_F_CNT_MASK          (0x3F<<0)
+#define FXOS8700CQ_F_STATUS_F_WMKF_MASK         (1<<6)
+#define FXOS8700CQ_F_STATUS_F_OVF_MASK          (1<<7)
+
+#define FXOS8700CQ_F_SETUP_F_WMRK_OFF           (0)
+#define FXOS8700CQ_F_SETUP_F_WMRK_MASK          (0x3F<<FXOS8700CQ_F_SETUP_F_WMRK_OFF)
+#define FXOS8700CQ_F_SETUP_F_WMRK(x)            (((x)<<FXOS8700CQ_F_SETUP_F_WMRK_OFF)&FXOS8700CQ_F_SETUP_F_WMRK_MASK)
+#define FXOS8700CQ_F_SETUP_F_MODE_OFF           (6)
+#define FXOS8700CQ_F_SETUP_F_MODE_MASK          (0x3<<FXOS8700CQ_F_SETUP_F_MODE_OFF)
+#define FXOS8700CQ_F_SETUP_F_MODE(x)            (((x)<<FXOS8700CQ_F_SETUP_F_MODE_OFF)&FXOS8700CQ_F_SETUP_F_MODE_MASK)
+
 #define FXOS8700CQ_M_CTRL_REG1_M_HMS_OFF         (0)
 #define FXOS8700CQ_M_CTRL_REG1_M_HMS_MASK        (0x3<<FXOS8700CQ_M_CTRL_REG1_M_HMS_OFF)
 #define FXOS8700CQ_M_CTRL_REG1_M_HMS(x)          (((x)<<FXOS8700CQ_M_CTRL_REG1_M_HMS_OFF)&FXOS8700CQ_M_CTRL_REG1_M_HMS_MASK)
@@ -170,6 +181,60 @@ private:
    void    reset(void);
    bool    failedInit;
 
+public:
+   /** Depth of accelerometer FIFO (samples) */
+   static constexpr unsigned FIFO_SIZE = 32;
+
+   /**
+    * Block of samples produced by streaming mode
+    *
+    * The FIFO only holds accelerometer samples. The magnetometer has no FIFO so
+    * the most recent magnetometer sample is read with each block.
+    */
+   struct StreamBlock {
+      uint16_t sequence;               //!< Incremented for each block (detects lost blocks)
+      uint8_t  count;                  //!< Number of accelerometer samples in block
+      uint8_t  fifoStatus;             //!< F_STATUS at start of burst (F_OVF => samples were lost)
+      uint8_t  magnetometerStatus;     //!< M_DR_STATUS
+      int16_t  magnetometer[3];        //!< Latest magnetometer X, Y, Z
+      int16_t  accelerometer[FIFO_SIZE][3]; //!< Accelerometer X, Y, Z (14-bit sign extended), oldest first
+   };
+
+   /**
+    * Call-back for streaming mode
+    *
+    * @param block Block of samples (only valid during call-back)
+    *
+    * @note Called from the I2C interrupt handler
+    */
+   typedef void (*StreamCallback)(const StreamBlock &block);
+
+private:
+   I2cTransaction    fifoTransaction;               //!< Burst read of F_STATUS + FIFO
+   I2cTransaction    magTransaction;                //!< Read of magnetometer
+   uint8_t           fifoRegister;                  //!< Register address for FIFO burst
+   uint8_t           magRegister;                   //!< Register address for magnetometer read
+   uint8_t           fifoData[1+6*FIFO_SIZE];       //!< F_STATUS followed by FIFO samples
+   uint8_t           magData[7];                    //!< M_DR_STATUS followed by X, Y, Z
+   StreamBlock       streamBlock;                   //!< Decoded block
+   StreamCallback    streamCallback;                //!< User call-back
+   unsigned          watermark;                     //!< FIFO watermark (samples per burst)
+   volatile bool     streamBusy;                    //!< Burst in progress
+   volatile bool     streamPending;                 //!< Watermark interrupt while burst in progress
+   uint8_t           savedMCtrlReg2;                //!< M_CTRL_REG2 before streaming
+
+   /**
+    * Queue burst read of FIFO and magnetometer
+    */
+   void startBurst();
+
+   /**
+    * I2C call-back on completion of burst
+    *
+    * @param transaction Magnetometer transaction (context is FXOS8700CQ)
+    */
+   static void burstComplete(I2cTransaction &transaction);
+
 public:
 
    enum AccelerometerMode {
@@ -289,6 +354,33 @@ public:
     * @param time How long to run calibration for in seconds
     */
    void calibrateMagnetometer(int time);
+
+   /**
+    * Start streaming mode\n
+    * The accelerometer FIFO is enabled (circular) with a watermark interrupt routed to INT1.\n
+    * Each watermark interrupt (see fifoInterrupt()) queues a single I2C burst read of the FIFO
+    * followed by a read of the magnetometer. Decoded blocks are passed to the call-back.
+    *
+    * @param mode      ACCEL_ONLY (800 Hz) or ACCEL_MAG (hybrid, 400 Hz each)
+    * @param watermark Samples per block (1..FIFO_SIZE-1)
+    * @param callback  Call-back for each block
+    *
+    * @return false if parameters are invalid
+    *
+    * @note The I2C interface must be in i2c_interrupt mode.
+    */
+   bool startStreaming(Mode mode, unsigned watermark, StreamCallback callback);
+
+   /**
+    * Stop streaming mode and restore polled operation
+    */
+   void stopStreaming();
+
+   /**
+    * Handle FIFO watermark interrupt (INT1 pin falling edge)\n
+    * Should be called from the port interrupt handler. Does not block.
+    */
+   void fifoInterrupt();
 };
 
 /**
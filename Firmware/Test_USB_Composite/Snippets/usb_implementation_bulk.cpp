@@ -202,71 +202,13 @@ void Usb0::initialise() {
 }
 
 /**
- * Handler for USB0 interrupt
+ * Handler for deferred USB SOF processing (lowest priority)
  *
- * Determines source and dispatches to appropriate routine.
+ * The USB interrupt is handled by UsbBase_T::irqHandler()
  */
-void Usb0::irqHandler() {
-   // All active flags
-   uint8_t interruptFlags = usb->ISTAT;
-
-   //   if (interruptFlags&~USB_ISTAT_SOFTOK_MASK) {
-   //      PRINTF("ISTAT=%2X\n", interruptFlags);
-   //   }
-
-   // Get active and enabled interrupt flags
-   uint8_t enabledInterruptFlags = interruptFlags & usb->INTEN;
-
-   if ((enabledInterruptFlags&USB_ISTAT_USBRST_MASK) != 0) {
-      // Reset signaled on Bus
-      handleUSBReset();
-      usb->ISTAT = USB_ISTAT_USBRST_MASK; // Clear source
-      return;
-   }
-   if ((enabledInterruptFlags&USB_ISTAT_TOKDNE_MASK) != 0) {
-      // Token complete interrupt
-      UsbBase_T::handleTokenComplete();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_TOKDNE_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_RESUME_MASK) != 0) {
-      // Resume signaled on Bus
-      handleUSBResume();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_RESUME_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_STALL_MASK) != 0) {
-      // Stall sent
-      handleStallComplete();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_STALL_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_SOFTOK_MASK) != 0) {
-      // SOF Token?
-      handleSOFToken();
-      usb->ISTAT = USB_ISTAT_SOFTOK_MASK; // Clear source
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_SLEEP_MASK) != 0) {
-      // Bus Idle 3ms => sleep
-      //      PUTS("Suspend");
-      handleUSBSuspend();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_SLEEP_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_ERROR_MASK) != 0) {
-      // Any Error
-      PRINTF("Error s=0x%02X\n", usb->ERRSTAT);
-      usb->ERRSTAT = 0xFF;
-      // Clear source
-      usb->ISTAT = USB_ISTAT_ERROR_MASK;
-   }
-   else  {
-      // Unexpected interrupt
-      // Clear & ignore
-      PRINTF("Unexpected interrupt, flags=0x%02X\n", interruptFlags);
-      // Clear & ignore
-      usb->ISTAT = interruptFlags;
-   }
+extern "C"
+void PendSV_Handler() {
+   Usb0::handleDeferredSOF();
 }
 
 /**
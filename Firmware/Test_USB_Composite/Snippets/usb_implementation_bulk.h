@@ -153,13 +153,6 @@ public:
       epBulkIn.setCallback(bulkInCallback);
    }
 
-   /**
-    * Handler for USB interrupt
-    *
-    * Determines source and dispatches to appropriate routine.
-    */
-   static void irqHandler(void);
-
    /**
     * Callback for SOF tokens
     */
@@ -168,13 +168,6 @@ public:
       epCdcDataIn.setCallback(cdcInCallback);
    }
 
-   /**
-    * Handler for USB interrupt
-    *
-    * Determines source and dispatches to appropriate routine.
-    */
-   static void irqHandler(void);
-
    /**
     * Callback for SOF tokens
     */
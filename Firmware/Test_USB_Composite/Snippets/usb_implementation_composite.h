@@ -204,13 +204,6 @@ public:
        */
    }
 
-   /**
-    * Handler for USB interrupt
-    *
-    * Determines source and dispatches to appropriate routine.
-    */
-   static void irqHandler(void);
-
    /**
     * Callback for SOF tokens
     */
@@ -83,6 +83,147 @@ void I2c::sendAddress(uint8_t address) {
    i2c->D  = I2C_D_DATA(address);
 }
 
+/**
+ * Generate REPEATED-START
+ */
+void I2c::generateRepeatedStart() {
+#if defined(MCU_MKL25Z4)
+   {
+      // Temporarily clear MULT - see KL25 errata e6070
+      uint8_t temp = i2c->F;
+      i2c->F&=~I2C_F_MULT(3);
+#endif
+      // Generate REPEATED-START
+      i2c->C1 = mode|I2C_C1_IICEN_MASK|I2C_C1_MST_MASK|I2C_C1_TX_MASK|I2C_C1_RSTA_MASK;
+#if defined(MCU_MKL25Z4)
+      // Restore MULT
+      i2c->F = temp;
+   }
+#endif
+#if defined(MCU_MKL27Z4) || defined(MCU_MKL27Z644) || defined(MCU_MKL43Z4)
+   // This is a nasty hack
+   // It seems these chips need a delay after asserting repeated start
+   for (int i=0; i<20; i++) {
+      __asm__ volatile("nop");
+   }
+#endif
+}
+
+/**
+ * Start a queued transaction
+ *
+ * @param transaction Transaction to start
+ * @param busHeld     REPEATED-START has already been generated
+ */
+void I2c::startTransaction(I2cTransaction &transaction, bool busHeld) {
+   errorCode = 0;
+
+   // Set up transmit and receive data
+   txDataPtr        = transaction.txData;
+   txBytesRemaining = transaction.txSize;
+   rxDataPtr        = transaction.rxData;
+   rxBytesRemaining = transaction.rxSize;
+
+   uint8_t address = transaction.address;
+   if (txBytesRemaining > 0) {
+      // Send address byte at start and move to data transmission
+      state = i2c_txData;
+   }
+   else {
+      // Send address byte at start and move to data reception
+      state    = i2c_rxAddress;
+      address |= 1;
+   }
+   if (busHeld) {
+      // Bus already held by REPEATED-START
+      addressedDevice = address;
+      i2c->D          = I2C_D_DATA(address);
+   }
+   else {
+      sendAddress(address);
+   }
+}
+
+/**
+ * Generate STOP or REPEATED-START at end of transaction
+ *
+ * @return true if REPEATED-START was generated to hold the bus for the next queued transaction
+ */
+bool I2c::endTransaction() {
+   state = i2c_idle;
+   if ((current != nullptr) && (current->flags&i2c_holdBus) &&
+       (errorCode == 0) && (queueTail != queueHead)) {
+      // Another transaction is waiting - hold bus
+      generateRepeatedStart();
+      return true;
+   }
+   // Generate STOP
+   i2c->C1 = mode|I2C_C1_IICEN_MASK|I2C_C1_TXAK_MASK;
+   return false;
+}
+
+/**
+ * Report completion of current queued transaction and start the next one (if any)
+ *
+ * @param busHeld REPEATED-START has already been generated by endTransaction()
+ */
+void I2c::nextTransaction(bool busHeld) {
+   I2cTransaction *done = current;
+   if (done == nullptr) {
+      // Synchronous transfer
+      return;
+   }
+   current = nullptr;
+   if (queueTail != queueHead) {
+      I2cTransaction *next = queue[queueTail&(QUEUE_SIZE-1)];
+      queueTail = queueTail+1;
+      current   = next;
+      startTransaction(*next, busHeld);
+   }
+   done->errorCode = errorCode;
+   done->complete  = true;
+   if (done->callback != nullptr) {
+      done->callback(*done);
+   }
+}
+
+/**
+ * Queue transaction for asynchronous execution\n
+ * Queued transactions are chained back-to-back by the interrupt handler
+ *
+ * @param transaction Transaction to queue. This must remain valid until complete.
+ *
+ * @return true  => Transaction queued\n
+ *         false => Queue full or empty transaction
+ */
+bool I2c::submit(I2cTransaction &transaction) {
+   unsigned head = queueHead;
+   if ((transaction.txSize == 0) && (transaction.rxSize == 0)) {
+      // Empty transactions are not supported by the hardware state machine
+      return false;
+   }
+   if ((head-queueTail) >= QUEUE_SIZE) {
+      return false;
+   }
+   transaction.errorCode = 0;
+   transaction.complete  = false;
+   queue[head&(QUEUE_SIZE-1)] = &transaction;
+   // Publish transaction
+   queueHead = head+1;
+
+   // Start engine if idle - the interrupt handler restarts it otherwise
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   if ((current == nullptr) && (state == i2c_idle) && (queueTail != queueHead)) {
+      I2cTransaction *next = queue[queueTail&(QUEUE_SIZE-1)];
+      queueTail = queueTail+1;
+      current   = next;
+      startTransaction(*next, false);
+   }
+   __set_PRIMASK(primask);
+   return true;
+}
+
 /**
  * I2C state-machine based interrupt handler
  */
@@ -92,6 +233,8 @@ void I2c::poll(void) {
       i2c->S = I2C_S_ARBL_MASK|I2C_S_IICIF_MASK;
       errorCode = 1;
       state = i2c_idle;
+      // Bus has been lost so any following transaction starts afresh
+      nextTransaction(false);
       return;
    }
    if ((i2c->S & I2C_S_IICIF_MASK) == 0) {
@@ -117,35 +260,14 @@ void I2c::poll(void) {
             // Reception after transmission
             state = i2c_rxAddress;
 
-#if defined(MCU_MKL25Z4)
-            {
-               // Temporarily clear MULT - see KL25 errata e6070
-               uint8_t temp = i2c->F;
-               i2c->F&=~I2C_F_MULT(3);
-#endif
-               // Generate REPEATED-START
-               i2c->C1 = mode|I2C_C1_IICEN_MASK|I2C_C1_MST_MASK|I2C_C1_TX_MASK|I2C_C1_RSTA_MASK;
-#if defined(MCU_MKL25Z4)
-               // Restore MULT
-               i2c->F = temp;
-            }
-#endif
-#if defined(MCU_MKL27Z4) || defined(MCU_MKL27Z644) || defined(MCU_MKL43Z4)
-            // This is a nasty hack
-            // It seems these chips need a delay after asserting repeated start
-            for (int i=0; i<20; i++) {
-               __asm__ volatile("nop");
-            }
-#endif
+            generateRepeatedStart();
+
             // Send device address again with READ bit set
             i2c->D = addressedDevice|1;
          }
          else {
-            // Complete
-            state = i2c_idle;
-
-            // Generate stop signal
-            i2c->C1 = mode|I2C_C1_IICEN_MASK|I2C_C1_TXAK_MASK;
+            // Complete - generate STOP (or REPEATED-START for next transaction)
+            nextTransaction(endTransaction());
             return;
          }
       }
@@ -176,9 +298,12 @@ void I2c::poll(void) {
       // Just receive data bytes until complete
       if (--rxBytesRemaining == 0) {
          // Received last byte - complete
-         state = i2c_idle;
-         // Generate STOP
-         i2c->C1 = mode|I2C_C1_IICEN_MASK;
+         // Generate STOP (or REPEATED-START for next transaction)
+         // Both leave Rx mode so reading the data doesn't start another reception
+         bool busHeld = endTransaction();
+         *rxDataPtr++ = i2c->D;
+         nextTransaction(busHeld);
+         break;
       }
       else if (rxBytesRemaining == 1) {
          // Received 2nd last byte (don't acknowledge the last byte to follow)
@@ -201,6 +326,9 @@ void I2c::poll(void) {
  * @param data     Data to transmit, 0th byte is often register address
  */
 int I2c::transmit(uint8_t address, uint16_t size, const uint8_t data[]) {
+   // Wait for queued transactions
+   waitWhileBusy();
+
    errorCode = 0;
 
    rxBytesRemaining = 0;
@@ -226,6 +354,9 @@ int I2c::transmit(uint8_t address, uint16_t size, const uint8_t data[]) {
  * @param data     Data buffer for reception
  */
 int I2c::receive(uint8_t address, uint16_t size,  uint8_t data[]) {
+   // Wait for queued transactions
+   waitWhileBusy();
+
    errorCode = 0;
 
    txBytesRemaining = 0;
@@ -254,6 +385,9 @@ int I2c::receive(uint8_t address, uint16_t size,  uint8_t data[]) {
  * @param rxData   Date buffer for reception
  */
 int I2c::txRx(uint8_t address, uint16_t txSize, const uint8_t txData[], uint16_t rxSize, uint8_t rxData[] ) {
+   // Wait for queued transactions
+   waitWhileBusy();
+
    errorCode = 0;
 
    // Send address byte at start and move to data transmission
@@ -133,33 +133,67 @@ uint32_t Spi::txRx(uint32_t data) {
 }
 
 /**
- *  Transmit and receive a series of 4 to 8-bit values
+ * Transmit and receive a series of values keeping the TX FIFO full
  *
- *  @param dataSize  Number of values to transfer
- *  @param dataOut   Transmit bytes (may be NULL for Rx only)
- *  @param dataIn    Receive byte buffer (may be NULL for Tx only)
+ * Up to SPI_FIFO_DEPTH frames are kept in flight so that the bus does not idle between
+ * frames and the RX FIFO cannot overflow.
+ *
+ * @param spi        SPI hardware
+ * @param command    PUSHR command bits (CTAS, PCS)
+ * @param dataSize   Number of values to transfer
+ * @param dataOut    Transmit values (may be NULL for Rx only)
+ * @param dataIn     Receive buffer (may be NULL for Tx only)
+ * @param dummy      Value transmitted when dataOut is NULL
  */
-void Spi::txRxBytes(uint32_t dataSize, const uint8_t *dataOut, uint8_t *dataIn) {
-   while(dataSize-->0) {
-      uint32_t sendData = 0xFF;
-      if (dataOut != 0) {
-         sendData = *dataOut++;
-      }
-      if (dataSize == 0) {
-         sendData |= SPI_PUSHR_EOQ_MASK;
-      }
-      else {
-         sendData |= SPI_PUSHR_CONT_MASK;
+template<typename T>
+static void fifoTxRx(volatile SPI_Type *spi, uint32_t command, uint32_t dataSize, const T *dataOut, T *dataIn, uint32_t dummy) {
+   if (dataSize == 0) {
+      return;
+   }
+   // Command words calculated once rather than per frame
+   const uint32_t continueCommand = command|SPI_PUSHR_CONT_MASK;
+   const uint32_t lastCommand     = command|SPI_PUSHR_EOQ_MASK;
+
+   uint32_t txRemaining = dataSize;
+   uint32_t rxRemaining = dataSize;
+
+   spi->SR   = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_RFOF_MASK|SPI_SR_TFUF_MASK;
+   spi->MCR &= ~SPI_MCR_HALT_MASK;
+   while (rxRemaining > 0) {
+      // Frames in flight never exceed FIFO depth so TX FIFO has space and RX FIFO cannot overflow
+      while ((txRemaining > 0) && ((rxRemaining-txRemaining) < SPI_FIFO_DEPTH)) {
+         uint32_t sendData = dummy;
+         if (dataOut != 0) {
+            sendData = *dataOut++;
+         }
+         txRemaining--;
+         spi->PUSHR = sendData|((txRemaining == 0)?lastCommand:continueCommand);
       }
-      uint32_t data = txRx(sendData|pushrMask);
-      if (dataIn != 0) {
-         *dataIn++ = data;
+      if ((spi->SR&SPI_SR_RXCTR_MASK) != 0) {
+         uint32_t data = spi->POPR;
+         rxRemaining--;
+         if (dataIn != 0) {
+            *dataIn++ = data;
+         }
       }
    }
    spi->MCR |= SPI_MCR_HALT_MASK;
    while ((spi->SR&SPI_SR_TXRXS_MASK)) {
       __asm__("nop");
    }
+   spi->SR = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_RFDF_MASK;
+}
+
+/**
+ *  Transmit and receive a series of 4 to 8-bit values
+ *
+ *  @param dataSize  Number of values to transfer
+ *  @param dataOut   Transmit bytes (may be NULL for Rx only)
+ *  @param dataIn    Receive byte buffer (may be NULL for Tx only)
+ */
+void Spi::txRxBytes(uint32_t dataSize, const uint8_t *dataOut, uint8_t *dataIn) {
+   waitWhileBusy();
+   fifoTxRx(spi, pushrMask, dataSize, dataOut, dataIn, 0xFF);
 }
 
 /**
@@ -170,26 +204,198 @@ void Spi::txRxBytes(uint32_t dataSize, const uint8_t *dataOut, uint8_t *dataIn)
  *  @param dataIn    Receive buffer (may be NULL for Tx only)
  */
 void Spi::txRxWords(uint32_t dataSize, const uint16_t *dataOut, uint16_t *dataIn) {
-   while(dataSize-->0) {
-      uint32_t sendData = 0xFFFF;
-      if (dataOut != 0) {
-         sendData = *dataOut++;
-      }
-      if (dataSize == 0) {
-         sendData |= SPI_PUSHR_EOQ_MASK;
+   waitWhileBusy();
+   fifoTxRx(spi, pushrMask, dataSize, dataOut, dataIn, 0xFFFF);
+}
+
+/**
+ *  Bulk transmit and receive a series of 4 to 8-bit values
+ *
+ *  @param command   PUSHR command bits (CTAS, PCS)
+ *  @param dataSize  Number of values to transfer
+ *  @param dataOut   Transmit bytes (may be NULL for Rx only)
+ *  @param dataIn    Receive byte buffer (may be NULL for Tx only)
+ *  @param callback  Called when transfer completes (may be NULL)
+ */
+void Spi::bulkTxRxBytes(uint32_t command, uint32_t dataSize, const uint8_t *dataOut, uint8_t *dataIn, SPICallbackFunction callback) {
+   waitWhileBusy();
+#if defined(USBDM_DMA0_IS_DEFINED)
+   if ((dmaRxChannel >= 0) && (dataSize >= SPI_DMA_THRESHOLD)) {
+      startDma(command, dataSize, dataOut, dataIn, DmaSize_8bit, callback);
+      return;
+   }
+#endif
+   fifoTxRx(spi, command, dataSize, dataOut, dataIn, 0xFF);
+   if (callback != 0) {
+      callback();
+   }
+}
+
+/**
+ *  Bulk transmit and receive a series of 9 to 16-bit values
+ *
+ *  @param command   PUSHR command bits (CTAS, PCS)
+ *  @param dataSize  Number of values to transfer
+ *  @param dataOut   Transmit values (may be NULL for Rx only)
+ *  @param dataIn    Receive buffer (may be NULL for Tx only)
+ *  @param callback  Called when transfer completes (may be NULL)
+ */
+void Spi::bulkTxRxWords(uint32_t command, uint32_t dataSize, const uint16_t *dataOut, uint16_t *dataIn, SPICallbackFunction callback) {
+   waitWhileBusy();
+#if defined(USBDM_DMA0_IS_DEFINED)
+   if ((dmaRxChannel >= 0) && (dataSize >= SPI_DMA_THRESHOLD)) {
+      startDma(command, dataSize, dataOut, dataIn, DmaSize_16bit, callback);
+      return;
+   }
+#endif
+   fifoTxRx(spi, command, dataSize, dataOut, dataIn, 0xFFFF);
+   if (callback != 0) {
+      callback();
+   }
+}
+
+#if defined(USBDM_DMA0_IS_DEFINED)
+
+static_assert(SPI_DMA_THRESHOLD >= 3, "DMA transfers need a first, middle and last frame");
+
+/** Source for transmit DMA when there is no transmit data */
+static const uint16_t dmaDummyTx = 0xFFFF;
+
+/** Destination for receive DMA when there is no receive buffer */
+static uint16_t dmaDummyRx;
+
+/**
+ * Configure DMA channels used for bulk transfers
+ *
+ * @param txChannel  DMA channel for transmit
+ * @param rxChannel  DMA channel for receive
+ * @param txSlot     DMAMUX slot for SPI transmit requests
+ * @param rxSlot     DMAMUX slot for SPI receive requests
+ * @param txHandler  Handler for transmit channel major-loop complete
+ * @param rxHandler  Handler for receive channel major-loop complete
+ */
+void Spi::configureDma(
+      unsigned txChannel,         unsigned rxChannel,
+      uint8_t txSlot,             uint8_t rxSlot,
+      DMACallbackFunction txHandler, DMACallbackFunction rxHandler) {
+
+   Dma0::enable();
+   Dma0::disableRequests(txChannel);
+   Dma0::disableRequests(rxChannel);
+   Dma0::configureMux(txChannel, txSlot);
+   Dma0::configureMux(rxChannel, rxSlot);
+   Dma0::setCallback(txChannel, txHandler);
+   Dma0::setCallback(rxChannel, rxHandler);
+   dmaTxChannel = txChannel;
+   dmaRxChannel = rxChannel;
+}
+
+/**
+ * Start DMA bulk transfer
+ *
+ * The first frame is written by the CPU as a full 32-bit PUSHR value.  This leaves the command
+ * bits (CONT, CTAS, PCS) in PUSHR so the transmit channel only needs to write the data half
+ * for the middle frames (8/16-bit writes to PUSHR push the entire register).
+ * The last frame (EOQ, no CONT) is written by dmaTxComplete().
+ *
+ * @param command    PUSHR command bits (CTAS, PCS)
+ * @param dataSize   Number of frames to transfer (>= 3)
+ * @param dataOut    Transmit values (may be NULL for Rx only)
+ * @param dataIn     Receive buffer (may be NULL for Tx only)
+ * @param size       Size of each value in buffers
+ * @param callback   Called when transfer completes
+ */
+void Spi::startDma(uint32_t command, uint32_t dataSize, const void *dataOut, void *dataIn, DmaSize size, SPICallbackFunction callback) {
+   const unsigned elementSize = 1U<<size;
+   const uint8_t *txData      = (const uint8_t *)dataOut;
+
+   uint32_t firstData = dmaDummyTx;
+   uint32_t lastData  = dmaDummyTx;
+   if (txData != 0) {
+      if (size == DmaSize_8bit) {
+         firstData = txData[0];
+         lastData  = txData[dataSize-1];
       }
       else {
-         sendData |= SPI_PUSHR_CONT_MASK;
-      }
-      uint32_t data = txRx(sendData|pushrMask);
-      if (dataIn != 0) {
-         *dataIn++ = data;
+         firstData = ((const uint16_t *)txData)[0];
+         lastData  = ((const uint16_t *)txData)[dataSize-1];
       }
    }
+   if (size == DmaSize_8bit) {
+      firstData &= 0xFF;
+      lastData  &= 0xFF;
+   }
+   dmaLastPushr = command|SPI_PUSHR_EOQ_MASK|lastData;
+   dmaCallback  = callback;
+   dmaBusy      = true;
+
+   spi->SR = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_RFOF_MASK|SPI_SR_TFUF_MASK|SPI_SR_RFDF_MASK|SPI_SR_TFFF_MASK;
+
+   // Receive channel - all frames POPR => dataIn
+   auto &rx = Dma0::dma->TCD[dmaRxChannel];
+   rx.SADDR         = (uint32_t)&spi->POPR;
+   rx.SOFF          = 0;
+   rx.ATTR          = Dma0::attr(size, size);
+   rx.NBYTES_MLNO   = elementSize;
+   rx.SLAST         = 0;
+   rx.DADDR         = (uint32_t)((dataIn != 0)?dataIn:&dmaDummyRx);
+   rx.DOFF          = (dataIn != 0)?elementSize:0;
+   rx.CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(dataSize);
+   rx.BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(dataSize);
+   rx.DLASTSGA      = 0;
+   rx.CSR           = DMA_CSR_INTMAJOR_MASK|DMA_CSR_DREQ_MASK;
+
+   // Transmit channel - middle frames dataOut => PUSHR data half
+   auto &tx = Dma0::dma->TCD[dmaTxChannel];
+   tx.SADDR         = (uint32_t)((txData != 0)?(txData+elementSize):(const uint8_t *)&dmaDummyTx);
+   tx.SOFF          = (txData != 0)?elementSize:0;
+   tx.ATTR          = Dma0::attr(size, size);
+   tx.NBYTES_MLNO   = elementSize;
+   tx.SLAST         = 0;
+   tx.DADDR         = (uint32_t)&spi->PUSHR;
+   tx.DOFF          = 0;
+   tx.CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(dataSize-2);
+   tx.BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(dataSize-2);
+   tx.DLASTSGA      = 0;
+   tx.CSR           = DMA_CSR_INTMAJOR_MASK|DMA_CSR_DREQ_MASK;
+
+   // First frame sets command bits retained in PUSHR
+   spi->PUSHR = command|SPI_PUSHR_CONT_MASK|firstData;
+
+   spi->RSER = SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK|SPI_RSER_RFDF_RE_MASK|SPI_RSER_RFDF_DIRS_MASK;
+   Dma0::enableRequests(dmaRxChannel);
+   Dma0::enableRequests(dmaTxChannel);
+   spi->MCR &= ~SPI_MCR_HALT_MASK;
+}
+
+/**
+ * Transmit DMA complete - writes final PUSHR value (without CONT, with EOQ)
+ */
+void Spi::dmaTxComplete() {
+   spi->RSER &= ~(SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK);
+   Dma0::disableRequests(dmaTxChannel);
+   while ((spi->SR&SPI_SR_TXCTR_MASK) >= SPI_SR_TXCTR(SPI_FIFO_DEPTH)) {
+      __asm__("nop");
+   }
+   spi->PUSHR = dmaLastPushr;
+}
+
+/**
+ * Receive DMA complete - stops SPI and notifies user
+ */
+void Spi::dmaRxComplete() {
+   spi->RSER = 0;
+   Dma0::disableRequests(dmaRxChannel);
    spi->MCR |= SPI_MCR_HALT_MASK;
    while ((spi->SR&SPI_SR_TXRXS_MASK)) {
       __asm__("nop");
    }
+   spi->SR = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_RFDF_MASK|SPI_SR_TFFF_MASK;
+   dmaBusy = false;
+   if (dmaCallback != 0) {
+      dmaCallback();
+   }
 }
+#endif
 
 } // End namespace USBDM
@@ -392,13 +392,72 @@ void Usb0::bulkOutCallback(EndpointState state) {
    }
 }
 
+/** Ring buffer feeding bulk IN end-point */
+static uint8_t bulkInRing[BULK_IN_RING_SIZE];
+
+/** Total bytes added to ring (producer) */
+static volatile uint32_t bulkInHead = 0;
+
+/** Total bytes removed from ring (USB) */
+static volatile uint32_t bulkInTail = 0;
+
+static_assert((BULK_IN_RING_SIZE&(BULK_IN_RING_SIZE-1)) == 0, "Ring size must be a power of 2");
+
+/**
+ * Queue data for streaming over bulk IN end-point
+ *
+ * @param size   Number of bytes to queue
+ * @param data   Data to queue
+ *
+ * @return false if not configured or insufficient space (nothing is queued)
+ */
+bool Usb0::queueBulkInData(unsigned size, const uint8_t *data) {
+   if (deviceState.state != USBconfigured) {
+      return false;
+   }
+   uint32_t head = bulkInHead;
+   if ((BULK_IN_RING_SIZE-(head-bulkInTail)) < size) {
+      return false;
+   }
+   for (unsigned index=0; index<size; index++) {
+      bulkInRing[(head+index)&(BULK_IN_RING_SIZE-1)] = data[index];
+   }
+   // Publish data
+   bulkInHead = head+size;
+   startBulkIn();
+   return true;
+}
+
+/**
+ * Start bulk IN transaction from ring buffer if end-point is idle and data is available
+ */
+void Usb0::startBulkIn() {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   uint32_t tail  = bulkInTail;
+   uint32_t count = bulkInHead-tail;
+   if ((epBulkIn.getHardwareState().state == EPIdle) && (count > 0)) {
+      if (count > BULK_IN_EP_MAXSIZE) {
+         count = BULK_IN_EP_MAXSIZE;
+      }
+      static_assert(epBulkIn.BUFFER_SIZE>=BULK_IN_EP_MAXSIZE, "Buffer too small");
+      uint8_t *buffer = epBulkIn.getBuffer();
+      for (unsigned index=0; index<count; index++) {
+         buffer[index] = bulkInRing[(tail+index)&(BULK_IN_RING_SIZE-1)];
+      }
+      bulkInTail = tail+count;
+      epBulkIn.startTxTransaction(count, nullptr, EPDataIn);
+   }
+   __set_PRIMASK(primask);
+}
+
 /**
  * Call-back handling BULK-IN transaction complete
  */
 void Usb0::bulkInCallback(EndpointState state) {
-   static const uint8_t buff[] = "Hello There\n\r";
-   if (state == EPDataIn) {
-      epBulkIn.startTxTransaction(sizeof(buff), buff, EPDataIn);
+   if (state == EPLastIn) {
+      // Continue streaming
+      startBulkIn();
    }
 }
 
@@ -418,71 +477,13 @@ void Usb0::initialise() {
 }
 
 /**
- * Handler for USB0 interrupt
+ * Handler for deferred USB SOF processing (lowest priority)
  *
- * Determines source and dispatches to appropriate routine.
+ * The USB interrupt is handled by UsbBase_T::irqHandler()
  */
-void Usb0::irqHandler() {
-   // All active flags
-   uint8_t interruptFlags = usb->ISTAT;
-
-   //   if (interruptFlags&~USB_ISTAT_SOFTOK_MASK) {
-   //      PRINTF("ISTAT=%2X\n", interruptFlags);
-   //   }
-
-   // Get active and enabled interrupt flags
-   uint8_t enabledInterruptFlags = interruptFlags & usb->INTEN;
-
-   if ((enabledInterruptFlags&USB_ISTAT_USBRST_MASK) != 0) {
-      // Reset signaled on Bus
-      handleUSBReset();
-      usb->ISTAT = USB_ISTAT_USBRST_MASK; // Clear source
-      return;
-   }
-   if ((enabledInterruptFlags&USB_ISTAT_TOKDNE_MASK) != 0) {
-      // Token complete interrupt
-      UsbBase_T::handleTokenComplete();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_TOKDNE_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_RESUME_MASK) != 0) {
-      // Resume signaled on Bus
-      handleUSBResume();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_RESUME_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_STALL_MASK) != 0) {
-      // Stall sent
-      handleStallComplete();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_STALL_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_SOFTOK_MASK) != 0) {
-      // SOF Token?
-      handleSOFToken();
-      usb->ISTAT = USB_ISTAT_SOFTOK_MASK; // Clear source
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_SLEEP_MASK) != 0) {
-      // Bus Idle 3ms => sleep
-      //      PUTS("Suspend");
-      handleUSBSuspend();
-      // Clear source
-      usb->ISTAT = USB_ISTAT_SLEEP_MASK;
-   }
-   else if ((enabledInterruptFlags&USB_ISTAT_ERROR_MASK) != 0) {
-      // Any Error
-      PRINTF("Error s=0x%02X\n", usb->ERRSTAT);
-      usb->ERRSTAT = 0xFF;
-      // Clear source
-      usb->ISTAT = USB_ISTAT_ERROR_MASK;
-   }
-   else  {
-      // Unexpected interrupt
-      // Clear & ignore
-      PRINTF("Unexpected interrupt, flags=0x%02X\n", interruptFlags);
-      // Clear & ignore
-      usb->ISTAT = interruptFlags;
-   }
+extern "C"
+void PendSV_Handler() {
+   Usb0::handleDeferredSOF();
 }
 
 /**
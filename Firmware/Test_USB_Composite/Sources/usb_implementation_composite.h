@@ -68,6 +68,9 @@ static constexpr uint  CDC_NOTIFICATION_EP_MAXSIZE  = 16; //!< CDC notification
 static constexpr uint  CDC_DATA_OUT_EP_MAXSIZE      = 16; //!< CDC data out      16
 static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 16; //!< CDC data in       16
 
+/** Size of ring buffer feeding bulk IN end-point (power of 2) */
+static constexpr uint  BULK_IN_RING_SIZE            = 2048;
+
 #ifdef USBDM_USB0_IS_DEFINED
 /**
  * Class representing USB0
@@ -204,13 +207,6 @@ public:
        */
    }
 
-   /**
-    * Handler for USB interrupt
-    *
-    * Determines source and dispatches to appropriate routine.
-    */
-   static void irqHandler(void);
-
    /**
     * Callback for SOF tokens
     */
@@ -230,6 +226,24 @@ public:
    static void sendData( uint8_t size, const uint8_t *buffer);
    static void receiveData(uint8_t maxSize, uint8_t *buffer);
 
+   /**
+    * Queue data for streaming over bulk IN end-point\n
+    * Data is sent as full packets while available so the host does not poll per record.
+    *
+    * @param size   Number of bytes to queue
+    * @param data   Data to queue
+    *
+    * @return false if not configured or insufficient space (nothing is queued)
+    *
+    * @note Lock-free single producer - may be called from an interrupt handler
+    */
+   static bool queueBulkInData(unsigned size, const uint8_t *data);
+
+   /**
+    * Start bulk IN transaction from ring buffer if end-point is idle and data is available
+    */
+   static void startBulkIn();
+
    /**
     * Call-back handling CDC-INtransaction complete
     */
@@ -38,6 +38,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "USBDM_MK.h"
 #include "delay.h"
 #include "configure.h"
@@ -49,10 +50,14 @@
 #include "bdm.h"
 #include "bdmCommon.h"
 #include "targetDefines.h"
+#include "flashRecord.h"
 
 namespace Bdm {
 
 static USBDM_ErrorCode hc12_alt_speed_detect(void);
+static void initialiseDma();
+static void speedCacheHit(unsigned syncLength);
+static void speedCacheLoad();
 
 /** Time to hold BKGD pin low after reset pin rise for special modes */
 static constexpr unsigned BKGD_WAIT_us = 10;
@@ -287,6 +292,8 @@ void initialise() {
 
    ResetInterface::initialise();
 
+   initialiseDma();
+
    enableFtmCounter();
 
    disablePins();
@@ -295,6 +302,8 @@ void initialise() {
 
    // Switch pins to FTM
    FtmInfo::initPCRs(PORT_PCR_DSE_MASK|PORT_PCR_PE_MASK); // DS+PDN
+
+   speedCacheLoad();
 }
 
 /**
@@ -469,71 +478,324 @@ USBDM_ErrorCode acknowledgeOrWait150(void) {
    return BDM_RC_OK;
 }
 
+//==========================================================================
+// DMA bit engine
+//
+// The FTM counter runs continuously with a period of one BDM bit.
+// Each period the combined channel pairs generate the BKGD low pulse and buffer enable pulse.
+//
+// During a frame the FTM runs with FTMEN=0 so that CnV writes to the combined channels are
+// buffered and only take effect when the counter wraps from MOD to CNTIN i.e. at the start of
+// the next bit.  (With FTMEN=1 they would need a synchronisation trigger for every bit.)
+//
+// A spare FTM channel (bitClockChannel) matches after the last edge of each bit and requests DMA:
+//  - DMA_WIDTH_CHANNEL  writes the BKGD pulse width for the next bit to C(bkgdOutChannel+1)V
+//  - DMA_ENABLE_CHANNEL (minor-loop linked) writes the buffer enable width to C(bkgdEnChannel+1)V
+//  - After the last bit a scatter-gather TCD writes FTM.SC = 0 to stop the counter
+//
+// For receive the rising edge of BKGD is captured by bkgdInChannel and DMA_CAPTURE_CHANNEL
+// copies each capture value to a buffer that is decoded once the frame is complete.
+//
+// The request is placed as late as possible while still allowing both linked writes to complete
+// before the counter wraps.  The eDMA latency is measured at start-up at the current bus clock.
+//
+// Interrupts are disabled around each frame and the following ACKN set-up (see tx()).
+
+/** Maximum number of bits in a frame */
+static constexpr unsigned MAX_FRAME_BITS = 32;
+
+/** FTM channel (no pin) used to request the DMA transfers for the next bit */
+constexpr int bitClockChannel = 0;
+
+/** DMA channel writing BKGD out pulse widths */
+static constexpr unsigned DMA_WIDTH_CHANNEL   = 2;
+
+/** DMA channel writing buffer enable pulse widths */
+static constexpr unsigned DMA_ENABLE_CHANNEL  = 3;
+
+/** DMA channel reading BKGD in capture values */
+static constexpr unsigned DMA_CAPTURE_CHANNEL = 4;
+
+/** Time to set up Timer at start of each bit (ticks) */
+static constexpr unsigned TMR_SETUP_TIME = 20;
+
+/** Ticks from DMA request until both linked pulse width writes have completed (measured) */
+static unsigned dmaLatencyTicks = 10;
+
+/** Layout of DMA Transfer Control Descriptor in memory (for scatter-gather) */
+struct DmaTcd {
+   uint32_t SADDR;
+   int16_t  SOFF;
+   uint16_t ATTR;
+   uint32_t NBYTES;
+   int32_t  SLAST;
+   uint32_t DADDR;
+   int16_t  DOFF;
+   uint16_t CITER;
+   int32_t  DLASTSGA;
+   uint16_t CSR;
+   uint16_t BITER;
+};
+
+/** BKGD out pulse widths for each bit (CnV values) */
+static uint32_t bitWidths[MAX_FRAME_BITS];
+
+/** Buffer enable pulse widths for each bit (CnV values) */
+static uint32_t enableWidths[MAX_FRAME_BITS];
+
+/** Captured BKGD rising edge for each bit */
+static uint32_t captureTimes[MAX_FRAME_BITS];
+
+/** Value written to FTM.SC to stop the counter */
+static const uint32_t ftmStopValue = 0;
+
+/** Scatter-gather descriptor loaded after the last bit to stop the counter */
+alignas(32) static DmaTcd stopTcd;
+
 /**
- * Receive an value over BDM interface
+ * Measure eDMA latency in FTM ticks at the current bus clock
  *
- * @param [in]  length Number of bits to receive
- * @param [out] data   Data received
+ * A software-started transfer copies FTM.CNT to memory.
+ * The result is doubled to cover the linked buffer enable transfer and
+ * padded for DMAMUX request synchronisation.
  *
- * @return BDM_RC_OK => Success, error otherwise
+ * @note The FTM counter must be running with MOD = 0xFFFF
+ */
+static void measureDmaLatency() {
+   static volatile uint32_t sampledCount;
+
+   DMAMUX0->CHCFG[DMA_CAPTURE_CHANNEL] = 0;
+   DMA0->CDNE = DMA_CDNE_CDNE(DMA_CAPTURE_CHANNEL);
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].SADDR          = (uint32_t)&ftm->CNT;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].SOFF           = 0;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].NBYTES_MLNO    = sizeof(sampledCount);
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].SLAST          = 0;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].DADDR          = (uint32_t)&sampledCount;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].DOFF           = 0;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].CITER_ELINKNO  = DMA_CITER_ELINKNO_CITER(1);
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].BITER_ELINKNO  = DMA_BITER_ELINKNO_BITER(1);
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].DLASTSGA       = 0;
+   DMA0->TCD[DMA_CAPTURE_CHANNEL].CSR            = 0;
+
+   uint16_t startCount = (uint16_t)ftm->CNT;
+   DMA0->SSRT = DMA_SSRT_SSRT(DMA_CAPTURE_CHANNEL);
+   while ((DMA0->TCD[DMA_CAPTURE_CHANNEL].CSR&DMA_CSR_DONE_MASK) == 0) {
+   }
+   DMA0->CDNE = DMA_CDNE_CDNE(DMA_CAPTURE_CHANNEL);
+
+   dmaLatencyTicks = 2*(uint16_t)(sampledCount-startCount)+2;
+}
+
+/**
+ * Initialise DMA used by bit engine
+ */
+static void initialiseDma() {
+   SIM->SCGC6 |= SIM_SCGC6_DMAMUX0_MASK;
+   SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+   // Stop counter after the last bit
+   stopTcd.SADDR    = (uint32_t)&ftmStopValue;
+   stopTcd.SOFF     = 0;
+   stopTcd.ATTR     = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+   stopTcd.NBYTES   = sizeof(ftmStopValue);
+   stopTcd.SLAST    = 0;
+   stopTcd.DADDR    = (uint32_t)&ftm->SC;
+   stopTcd.DOFF     = 0;
+   stopTcd.CITER    = 1;
+   stopTcd.BITER    = 1;
+   stopTcd.DLASTSGA = 0;
+   stopTcd.CSR      = DMA_CSR_DREQ_MASK;
+
+   // Pulse widths -> FTM.C(bkgdEnChannel+1)V, started by link from width channel
+   DMAMUX0->CHCFG[DMA_ENABLE_CHANNEL] = 0;
+   DMA0->TCD[DMA_ENABLE_CHANNEL].SOFF           = sizeof(enableWidths[0]);
+   DMA0->TCD[DMA_ENABLE_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+   DMA0->TCD[DMA_ENABLE_CHANNEL].NBYTES_MLNO    = sizeof(enableWidths[0]);
+   DMA0->TCD[DMA_ENABLE_CHANNEL].SLAST          = 0;
+   DMA0->TCD[DMA_ENABLE_CHANNEL].DADDR          = (uint32_t)&ftm->CONTROLS[bkgdEnChannel+1].CnV;
+   DMA0->TCD[DMA_ENABLE_CHANNEL].DOFF           = 0;
+   DMA0->TCD[DMA_ENABLE_CHANNEL].DLASTSGA       = 0;
+
+   measureDmaLatency();
+}
+
+/**
+ * Run a frame of bits through the DMA bit engine
  *
- * @note FTM use:\n
- *    bkgdEnChannel,bkgdEnChannel+1   = Positive pulse for buffer enable   \n
- *    bkgdOutChannel,bkgdOutChannel+1 = Negative pulse for BKGD out        \n
- *    bkgdInChannel                   = Sampling of data bit from target
+ * @param [in] length    Number of bits
+ * @param [in] capture   Capture BKGD rising edge of each bit into captureTimes[]
+ *
+ * @return true if all bits were captured (always true if capture not requested)
+ *
+ * @note bitWidths[] and enableWidths[] must contain the CnV values for each bit
  */
-USBDM_ErrorCode rx(int length, unsigned &data) {
+static bool runFrame(unsigned length, bool capture) {
 
-   /** Time to set up Timer - This varies with optimisation! */
-   static constexpr unsigned TMR_SETUP_TIME = 20;
+   const uint16_t maxBitTime = TMR_SETUP_TIME+minPeriod;
+
+   // Last edge of any bit (BKGD out or buffer enable)
+   const uint16_t lastEdge = TMR_SETUP_TIME+zeroBitTime+SPEEDUP_PULSE_WIDTH_ticks;
 
+   // Request as late as possible so both linked writes still complete before the counter wraps
+   uint16_t requestTime = lastEdge+1;
+   if (maxBitTime > lastEdge+1+dmaLatencyTicks) {
+      requestTime = maxBitTime-dmaLatencyTicks;
+   }
+
+   // Disable so immediate effect
    disableFtmCounter();
 
+   // Legacy mode - combined CnV updates are buffered until counter wraps
+   ftm->MODE  = FTM_MODE_WPDIS_MASK;
+   ftm->CNTIN = 0;
+   ftm->CNT   = 0;
+   ftm->MOD   = maxBitTime-1;
+
    ftm->COMBINE =
          FTM_COMBINE_COMBINE0_MASK<<(bkgdEnChannel*4)|
          FTM_COMBINE_COMBINE0_MASK<<(bkgdOutChannel*4);
 
    // Positive pulse for buffer enable
-   ftm->CONTROLS[bkgdEnChannel].CnSC    = FTM_CnSC_ELS(2);
+   ftm->CONTROLS[bkgdEnChannel].CnSC    = USBDM::ftm_CombinePositivePulse;
    ftm->CONTROLS[bkgdEnChannel].CnV     = TMR_SETUP_TIME;
-   ftm->CONTROLS[bkgdEnChannel+1].CnV   = TMR_SETUP_TIME+oneBitTime-SPEEDUP_PULSE_WIDTH_ticks;
+   ftm->CONTROLS[bkgdEnChannel+1].CnV   = enableWidths[0];
 
    // Negative pulse for BKGD out
-   ftm->CONTROLS[bkgdOutChannel].CnSC   = FTM_CnSC_ELS(1);
+   ftm->CONTROLS[bkgdOutChannel].CnSC   = USBDM::ftm_CombineNegativePulse;
    ftm->CONTROLS[bkgdOutChannel].CnV    = TMR_SETUP_TIME;
-   ftm->CONTROLS[bkgdOutChannel+1].CnV  = TMR_SETUP_TIME+oneBitTime;
-
-   // Capture rising edge of BKGD in
-   ftm->CONTROLS[bkgdInChannel].CnSC    = USBDM::ftm_inputCaptureRisingEdge;
+   ftm->CONTROLS[bkgdOutChannel+1].CnV  = bitWidths[0];
+
+   // Request DMA once all edges of the bit are complete (software compare, no pin)
+   ftm->CONTROLS[bitClockChannel].CnSC  = FTM_CnSC_MSA_MASK|FTM_CnSC_CHIE_MASK|FTM_CnSC_DMA_MASK;
+   ftm->CONTROLS[bitClockChannel].CnV   = requestTime;
+
+   // Remaining widths then stop counter
+   // DONE must be clear before CSR is written or ESG is ignored
+   DMAMUX0->CHCFG[DMA_WIDTH_CHANNEL] = 0;
+   DMA0->CDNE = DMA_CDNE_CDNE(DMA_WIDTH_CHANNEL);
+   DMA0->CDNE = DMA_CDNE_CDNE(DMA_ENABLE_CHANNEL);
+   if (length > 1) {
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SADDR          = (uint32_t)(bitWidths+1);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SOFF           = sizeof(bitWidths[0]);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].NBYTES_MLNO    = sizeof(bitWidths[0]);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SLAST          = 0;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DADDR          = (uint32_t)&ftm->CONTROLS[bkgdOutChannel+1].CnV;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DOFF           = 0;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].CITER_ELINKYES =
+            DMA_CITER_ELINKYES_ELINK_MASK|DMA_CITER_ELINKYES_LINKCH(DMA_ENABLE_CHANNEL)|DMA_CITER_ELINKYES_CITER(length-1);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].BITER_ELINKYES =
+            DMA_BITER_ELINKYES_ELINK_MASK|DMA_BITER_ELINKYES_LINKCH(DMA_ENABLE_CHANNEL)|DMA_BITER_ELINKYES_BITER(length-1);
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DLASTSGA       = (uint32_t)&stopTcd;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].CSR            = DMA_CSR_ESG_MASK;
+
+      DMA0->TCD[DMA_ENABLE_CHANNEL].SADDR         = (uint32_t)(enableWidths+1);
+      DMA0->TCD[DMA_ENABLE_CHANNEL].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(length-1);
+      DMA0->TCD[DMA_ENABLE_CHANNEL].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(length-1);
+      DMA0->TCD[DMA_ENABLE_CHANNEL].CSR           = 0;
+   }
+   else {
+      // Single bit - only need to stop counter
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SADDR          = stopTcd.SADDR;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SOFF           = stopTcd.SOFF;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].ATTR           = stopTcd.ATTR;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].NBYTES_MLNO    = stopTcd.NBYTES;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].SLAST          = stopTcd.SLAST;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DADDR          = stopTcd.DADDR;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DOFF           = stopTcd.DOFF;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].CITER_ELINKNO  = stopTcd.CITER;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].BITER_ELINKNO  = stopTcd.BITER;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].DLASTSGA       = stopTcd.DLASTSGA;
+      DMA0->TCD[DMA_WIDTH_CHANNEL].CSR            = stopTcd.CSR;
+   }
+   DMAMUX0->CHCFG[DMA_WIDTH_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(DMA0_SLOT_FTM0_Ch_0);
+
+   DMAMUX0->CHCFG[DMA_CAPTURE_CHANNEL] = 0;
+   DMA0->CDNE = DMA_CDNE_CDNE(DMA_CAPTURE_CHANNEL);
+   if (capture) {
+      // FTM.C(bkgdInChannel)V -> captureTimes[]
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].SADDR          = (uint32_t)&ftm->CONTROLS[bkgdInChannel].CnV;
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].SOFF           = 0;
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].NBYTES_MLNO    = sizeof(captureTimes[0]);
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].SLAST          = 0;
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].DADDR          = (uint32_t)captureTimes;
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].DOFF           = sizeof(captureTimes[0]);
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].CITER_ELINKNO  = DMA_CITER_ELINKNO_CITER(length);
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].BITER_ELINKNO  = DMA_BITER_ELINKNO_BITER(length);
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].DLASTSGA       = 0;
+      DMA0->TCD[DMA_CAPTURE_CHANNEL].CSR            = DMA_CSR_DREQ_MASK;
+      DMAMUX0->CHCFG[DMA_CAPTURE_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(DMA0_SLOT_FTM0_Ch_4);
+
+      // Capture rising edge of BKGD in
+      ftm->CONTROLS[bkgdInChannel].CnSC = USBDM::ftm_inputCaptureRisingEdge|FTM_CnSC_CHIE_MASK|FTM_CnSC_DMA_MASK;
+   }
+   // Clear channel flags
+   ftm->STATUS &= ~(
+         (1<<bitClockChannel)|
+         (1<<bkgdEnChannel) |(1<<(bkgdEnChannel+1))|
+         (1<<bkgdOutChannel)|(1<<(bkgdOutChannel+1))|
+         (1<<bkgdInChannel));
 
+   DMA0->SERQ = DMA_SERQ_SERQ(DMA_WIDTH_CHANNEL);
+   if (capture) {
+      DMA0->SERQ = DMA_SERQ_SERQ(DMA_CAPTURE_CHANNEL);
+   }
    enableFtmCounter();
 
-   bool success = true;
-   unsigned value = 0;
-   while (length-->0) {
-
-      // Restart counter
-      ftm->CNT = 0;
+   // Wait for counter to be stopped by DMA after the last bit
+   static auto frameComplete = [] {
+         return (ftm->SC&FTM_SC_CLKS_MASK) == 0;
+   };
+   USBDM::waitUS(1000, frameComplete);
 
-      // Clear channel flags
-      ftm->STATUS &= ~(
-            (1<<bkgdEnChannel) |(1<<(bkgdEnChannel+1))|
-            (1<<bkgdOutChannel)|(1<<(bkgdOutChannel+1))|
-            (1<<bkgdInChannel));
+   // Restore counter for ACKN, SYNC etc.
+   disableFtmCounter();
+   DMA0->CERQ = DMA_CERQ_CERQ(DMA_WIDTH_CHANNEL);
+   DMA0->CERQ = DMA_CERQ_CERQ(DMA_CAPTURE_CHANNEL);
+   ftm->CONTROLS[bitClockChannel].CnSC = 0;
+   ftm->CONTROLS[bkgdInChannel].CnSC   = USBDM::ftm_inputCaptureRisingEdge;
+   ftm->MODE = FTM_MODE_FTMEN_MASK|FTM_MODE_WPDIS_MASK;
+   ftm->MOD = (uint32_t)-1;
+   ftm->CNT = 0;
+   enableFtmCounter();
 
-      // Wait until end of bit
-      do {
-      } while (ftm->CNT <= TMR_SETUP_TIME+minPeriod);
+   if (!capture) {
+      return true;
+   }
+   // All bits captured if capture channel has completed
+   return (DMA0->TCD[DMA_CAPTURE_CHANNEL].CSR&DMA_CSR_DONE_MASK) != 0;
+}
 
-      // Should have captured a rising edge from target
-      success = success && ((ftm->CONTROLS[bkgdInChannel].CnSC & FTM_CnSC_CHF_MASK) != 0);
+/**
+ * Receive an value over BDM interface
+ *
+ * @param [in]  length Number of bits to receive
+ * @param [out] data   Data received
+ *
+ * @return BDM_RC_OK => Success, error otherwise
+ *
+ * @note FTM use:\n
+ *    bkgdEnChannel,bkgdEnChannel+1   = Positive pulse for buffer enable   \n
+ *    bkgdOutChannel,bkgdOutChannel+1 = Negative pulse for BKGD out        \n
+ *    bkgdInChannel                   = Sampling of data bit from target   \n
+ *    bitClockChannel                 = DMA request for each bit
+ */
+USBDM_ErrorCode rx(int length, unsigned &data) {
 
-      // Use time of rise to determine bit value
-      value = (value<<1)|((ftm->CONTROLS[bkgdInChannel].CnV>(TMR_SETUP_TIME+sampleBitTime))?0:1);
+   for (int index=0; index<length; index++) {
+      bitWidths[index]    = TMR_SETUP_TIME+oneBitTime;
+      enableWidths[index] = TMR_SETUP_TIME+oneBitTime-SPEEDUP_PULSE_WIDTH_ticks;
    }
-   if (!success) {
+   if (!runFrame(length, true)) {
       return BDM_RC_BKGD_TIMEOUT;
    }
+   // Use time of rise to determine bit value
+   unsigned value = 0;
+   for (int index=0; index<length; index++) {
+      value = (value<<1)|((captureTimes[index]>(TMR_SETUP_TIME+sampleBitTime))?0:1);
+   }
    data = value;
    return BDM_RC_OK;
 }
@@ -585,11 +847,11 @@ USBDM_ErrorCode rx32(uint8_t *data) {
 
 /**
  * Set up for transmission
+ *
+ * @note Interrupts are not disabled here - tx() masks them around each frame
  */
 inline
 void transactionStart() {
-   ftm->SYNCONF = FTM_SYNCONF_SYNCMODE(1)|FTM_SYNCONF_SWWRBUF(1);
-   disableInterrupts();
    enablePins();
 }
 
@@ -616,68 +878,37 @@ void transactionComplete() {
  *    bkgdOutChannel,bkgdOutChannel+1 = Negative pulse for BKGD out, width modified by data 0/1 \n
  *    bkgdInChannel                   = ACKN capture   \n
  *    bkgdInChannel+1                 = ACKN timeout   \n
+ *    bitClockChannel                 = DMA request for each bit \n
  * bkgdInChannel,bkgdInChannel+1 are left setup for ACKN.  ACKN is not waited for.
  */
 USBDM_ErrorCode tx(int length, unsigned data) {
 
-   /* Time to set up Timer - This varies with optimisation! */
-   static constexpr unsigned TMR_SETUP_TIME = 20;
+   // Pre-compute pulse widths for each bit (MSB first)
    uint32_t mask = (1U<<(length-1));
+   for (int index=0; index<length; index++) {
+      uint32_t width = TMR_SETUP_TIME+((data&mask)?oneBitTime:zeroBitTime);
+      bitWidths[index]    = width;
+      enableWidths[index] = width+SPEEDUP_PULSE_WIDTH_ticks;
+      mask >>= 1;
+   }
+   // An interrupt between the end of the frame and the ACKN set-up could miss a fast ACKN
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
 
-   ftm->COMBINE =
-         FTM_COMBINE_SYNCEN0_MASK<<(bkgdEnChannel*4)|
-         FTM_COMBINE_COMBINE0_MASK<<(bkgdEnChannel*4)|
-         FTM_COMBINE_SYNCEN0_MASK<<(bkgdOutChannel*4)|
-         FTM_COMBINE_COMBINE0_MASK<<(bkgdOutChannel*4);
-
-   // Disable so immediate effect
-   disableFtmCounter();
-
-   // Positive pulse for buffer enable
-   ftm->CONTROLS[bkgdEnChannel].CnSC    = USBDM::ftm_CombinePositivePulse;
-   ftm->CONTROLS[bkgdEnChannel].CnV     = TMR_SETUP_TIME;
-
-   // Negative pulse for BKGD out
-   ftm->CONTROLS[bkgdOutChannel].CnSC   = USBDM::ftm_CombineNegativePulse;
-   ftm->CONTROLS[bkgdOutChannel].CnV    = TMR_SETUP_TIME;
-
-   // Data sample capture rising edge of BKGD in
-   ftm->CONTROLS[bkgdInChannel].CnSC    = USBDM::ftm_inputCaptureRisingEdge;
+   (void)runFrame(length, false);
 
    // ACKN timeout
    ftm->CONTROLS[bkgdInChannel+1].CnSC  = USBDM::ftm_outputCompare;
    ftm->CONTROLS[bkgdInChannel+1].CnV   = TMR_SETUP_TIME+ACKN_TIMEOUT_us;
 
-   // Maximum length of a bit
-   const uint16_t maxBitTime = TMR_SETUP_TIME+minPeriod;
-   while (mask>0) {
-      int width;
-      if (data&mask) {
-         width = TMR_SETUP_TIME+oneBitTime;
-      }
-      else {
-         width = TMR_SETUP_TIME+zeroBitTime;
-      }
-      mask >>= 1;
-
-      disableFtmCounter();
-      ftm->CNT = 0;
-      ftm->CONTROLS[bkgdOutChannel+1].CnV  = width;
-      ftm->CONTROLS[bkgdEnChannel+1].CnV   = width+SPEEDUP_PULSE_WIDTH_ticks;
-      ftm->SYNC = FTM_SYNC_SWSYNC(1);
-
-      enableFtmCounter();
-
-      // Wait until end of bit
-      do {
-      } while (ftm->CNT < maxBitTime);
-   }
    // Clear channel flags for ACKN pulse
    ftm->STATUS &= ~(
          (1<<bkgdEnChannel) |(1<<(bkgdEnChannel+1))|
          (1<<bkgdOutChannel)|(1<<(bkgdOutChannel+1))|
          (1<<bkgdInChannel)|(1<<(bkgdInChannel+1)));
 
+   __set_PRIMASK(primask);
+
    return BDM_RC_OK;
 }
 
@@ -744,6 +975,7 @@ USBDM_ErrorCode tx32(uint32_t data) {
  * @note Interrupts are left disabled, no ACK is expected
  */
 void cmd_0_0_T(uint8_t cmd) {
+   disableInterrupts();
    transactionStart();
    tx8(cmd);
 }
@@ -757,6 +989,7 @@ void cmd_0_0_T(uint8_t cmd) {
  * @note Interrupts are left disabled, no ACK is expected
  */
 void cmd_1B_0_T(uint8_t cmd, uint8_t parameter) {
+   disableInterrupts();
    transactionStart();
    tx8(cmd);
    tx8(parameter);
@@ -772,6 +1005,7 @@ void cmd_1B_0_T(uint8_t cmd, uint8_t parameter) {
  * @note Interrupts are left disabled, no ACK is expected
  */
 void cmd_1W1B_0_T(uint8_t cmd, uint16_t parameter1, uint8_t parameter2) {
+   disableInterrupts();
    transactionStart();
    tx8(cmd);
    tx16(parameter1);
@@ -1486,6 +1720,7 @@ USBDM_ErrorCode physicalConnect(void) {
    if (rc == BDM_RC_OK) {
       // Speed determined by SYNC method
       cable_status.speed = SPEED_SYNC;
+      speedCacheHit(syncLength);
    }
    else if ((bdm_option.guessSpeed) && (cable_status.target_type == T_HC12)) {
       // Try alternative method if enabled and HC12 target
@@ -1860,56 +2095,223 @@ constexpr uint32_t convertFrequencyToSyncValue(uint32_t frequency) {
    return (125*1000000)/frequency;
 }
 
+/** Number of entries in speed cache */
+static constexpr unsigned SPEED_CACHE_SIZE = 8;
+
+/** Confidence counter limit - an entry must miss this many times in a row before being discarded */
+static constexpr uint8_t  SPEED_MAX_CONFIDENCE = 4;
+
+/** Sync lengths within syncLength/SPEED_MATCH_DIVISOR are considered the same speed */
+static constexpr unsigned SPEED_MATCH_DIVISOR = 32;
+
+/** Ratio between adjacent speeds tried when searching (x1024) i.e. ~5% */
+static constexpr unsigned SPEED_SEARCH_STEP = 1075;
+
+/** Lowest target speed searched */
+static constexpr uint32_t SPEED_SEARCH_MIN_FREQUENCY = 1000000;
+
+/** Highest target speed searched */
+static constexpr uint32_t SPEED_SEARCH_MAX_FREQUENCY = 50000000;
+
+/** Speed cache entry */
+struct SpeedCacheEntry {
+   uint16_t syncLength;   //!< Sync length that worked
+   uint8_t  targetType;   //!< Target type it worked with
+   uint8_t  confidence;   //!< Confidence counter (0 => unused entry)
+};
+
+/** Layout version of speed cache record in flash */
+static constexpr uint8_t SPEED_CACHE_VERSION = 1;
+
+/**
+ * Cache of recently used speeds in LRU order ([0] is most recent)\n
+ * This is saved to flash so survives a probe reset
+ */
+static SpeedCacheEntry speedCache[SPEED_CACHE_SIZE];
+
+/** Speed cache as last saved to flash */
+static SpeedCacheEntry savedSpeedCache[SPEED_CACHE_SIZE];
+
+/**
+ * Check if two sync lengths represent the same speed
+ *
+ * @param [in] syncLength1  Sync length to compare
+ * @param [in] syncLength2  Sync length to compare
+ *
+ * @return true if within tolerance
+ */
+static bool isSameSpeed(unsigned syncLength1, unsigned syncLength2) {
+   unsigned difference = (syncLength1>syncLength2)?(syncLength1-syncLength2):(syncLength2-syncLength1);
+   return difference <= (syncLength1/SPEED_MATCH_DIVISOR);
+}
+
+/**
+ * Move speed cache entry to front (most recent)
+ *
+ * @param [in] index Index of entry to move
+ */
+static void speedCacheMoveToFront(unsigned index) {
+   SpeedCacheEntry entry = speedCache[index];
+   for (; index>0; index--) {
+      speedCache[index] = speedCache[index-1];
+   }
+   speedCache[0] = entry;
+}
+
+/**
+ * Load speed cache from flash\n
+ * The cache is left empty if there is no valid record
+ */
+static void speedCacheLoad() {
+   static bool loaded = false;
+   if (loaded) {
+      return;
+   }
+   loaded = true;
+   if (flashRecordRead(FLASH_RECORD_BDM_SPEEDS, SPEED_CACHE_VERSION, speedCache, sizeof(speedCache))) {
+      memcpy(savedSpeedCache, speedCache, sizeof(speedCache));
+   }
+}
+
+/**
+ * Save speed cache to flash if changed\n
+ * Sync lengths that represent the same speed are not a change so re-measuring a target does not wear the flash
+ */
+static void speedCacheSave() {
+   bool changed = false;
+   for (unsigned index=0; index<SPEED_CACHE_SIZE; index++) {
+      const SpeedCacheEntry &entry = speedCache[index];
+      const SpeedCacheEntry &saved = savedSpeedCache[index];
+      if ((entry.confidence != saved.confidence) ||
+          (entry.targetType != saved.targetType) ||
+          !isSameSpeed(saved.syncLength, entry.syncLength)) {
+         changed = true;
+         break;
+      }
+   }
+   if (changed &&
+       (flashRecordWrite(FLASH_RECORD_BDM_SPEEDS, SPEED_CACHE_VERSION, speedCache, sizeof(speedCache)) == BDM_RC_OK)) {
+      memcpy(savedSpeedCache, speedCache, sizeof(speedCache));
+   }
+}
+
+/**
+ * Record a speed that worked for the current target
+ *
+ * @param [in] syncLength Sync length in timer ticks
+ */
+static void speedCacheHit(unsigned syncLength) {
+   unsigned index;
+   for (index=0; index<SPEED_CACHE_SIZE-1; index++) {
+      if ((speedCache[index].confidence > 0) &&
+          (speedCache[index].targetType == cable_status.target_type) &&
+          isSameSpeed(speedCache[index].syncLength, syncLength)) {
+         break;
+      }
+   }
+   // index is matching entry or last (LRU) entry which is replaced
+   if ((speedCache[index].confidence == 0) ||
+       (speedCache[index].targetType != cable_status.target_type) ||
+       !isSameSpeed(speedCache[index].syncLength, syncLength)) {
+      speedCache[index].confidence = 0;
+   }
+   if (speedCache[index].confidence < SPEED_MAX_CONFIDENCE) {
+      speedCache[index].confidence++;
+   }
+   speedCache[index].syncLength = syncLength;
+   speedCache[index].targetType = cable_status.target_type;
+   speedCacheMoveToFront(index);
+   speedCacheSave();
+}
+
+/**
+ * Record a cached speed that failed for the current target
+ *
+ * @param [in] index Index of entry
+ */
+static void speedCacheMiss(unsigned index) {
+   if (speedCache[index].confidence > 0) {
+      speedCache[index].confidence--;
+   }
+}
+
 /**  Attempt to determine target speed by trial and error
  *
  *  Basic process used to check for communication is:
  *    -  Attempt to modify the BDM Status register [BDMSTS] or BDM CCR Save Register [BDMCCR]
  *
- *  The above is attempted for a range of 'nice' frequencies and then every Tx driver frequency. \n
- *  To improve performance the last two successful frequencies are remembered.  This covers the \n
- *  common case of alternating between two frequencies [reset & clock configured] with a minimum \n
- *  number of probes.
+ *  Speeds are tried in order of likelihood:
+ *    -  Cached speeds for this target type in LRU order.  This is usually the only probe needed.
+ *    -  A few 'nice' frequencies
+ *    -  A geometric series of speeds working outwards from the most recent speed
+ *
+ *  @note hc12confirmSpeed() only indicates success/failure (not too fast/slow) so a
+ *        bisection search is not possible. The outward search finds nearby speeds first.
  */
 static USBDM_ErrorCode hc12_alt_speed_detect(void) {
-static const uint32_t typicalSpeeds[] = {
-      // Table of 'nice' BDM speeds to try
-      8000000,
-      16000000,
-   0
+   static const uint32_t typicalSpeeds[] = {
+         // Table of 'nice' BDM speeds to try
+         8000000,
+         16000000,
+         0
    };
-static uint16_t lastGuess1 = convertFrequencyToSyncValue(8000000);  // Used to remember last 2 guesses
-static uint16_t lastGuess2 = convertFrequencyToSyncValue(16000000); // Common situation to change between 2 speeds (reset,running)
-int sub;
-uint16_t currentGuess;
-USBDM_ErrorCode  rc;
-
-   // Try last used speed #1
-   if (hc12confirmSpeed(lastGuess1) == BDM_RC_OK) {
-      cable_status.speed = SPEED_GUESSED;  // Speed found by trial and error
-      return BDM_RC_OK;
-   }
-   // Try last used speed #2
-   currentGuess = lastGuess2;
-   rc = hc12confirmSpeed(lastGuess2);
-   if (rc != BDM_RC_OK) {
-      // TODO This may take a while
-//      setBDMBusy();
+   // Try cached speeds for this target
+   for (unsigned index=0; index<SPEED_CACHE_SIZE; index++) {
+      if ((speedCache[index].confidence == 0) ||
+          (speedCache[index].targetType != cable_status.target_type)) {
+         continue;
+      }
+      if (hc12confirmSpeed(speedCache[index].syncLength) == BDM_RC_OK) {
+         speedCacheHit(speedCache[index].syncLength);
+         cable_status.speed = SPEED_GUESSED;  // Speed found by trial and error
+         return BDM_RC_OK;
+      }
+      speedCacheMiss(index);
    }
    // Try some likely numbers!
-   for (sub=0; typicalSpeeds[sub]>0; sub++) {
-      rc = hc12confirmSpeed(lastGuess1);
+   USBDM_ErrorCode rc = BDM_RC_BDM_EN_FAILED;
+   uint32_t currentGuess = 0;
+   for (unsigned sub=0; typicalSpeeds[sub]>0; sub++) {
+      currentGuess = convertFrequencyToSyncValue(typicalSpeeds[sub]);
+      rc = hc12confirmSpeed(currentGuess);
       if (rc == BDM_RC_OK) {
          break;
       }
-      currentGuess = convertFrequencyToSyncValue(typicalSpeeds[sub]);
-      rc           = hc12confirmSpeed(currentGuess);
+   }
+   if (rc != BDM_RC_OK) {
+      // Search outwards from most recent speed alternating slower/faster
+      constexpr uint32_t minSync = convertFrequencyToSyncValue(SPEED_SEARCH_MAX_FREQUENCY);
+      constexpr uint32_t maxSync = convertFrequencyToSyncValue(SPEED_SEARCH_MIN_FREQUENCY);
+
+      uint32_t centre = convertFrequencyToSyncValue(typicalSpeeds[0]);
+      if (speedCache[0].confidence > 0) {
+         centre = speedCache[0].syncLength;
+      }
+      uint32_t slower = centre;
+      uint32_t faster = centre;
+      while ((rc != BDM_RC_OK) && ((slower < maxSync) || (faster > minSync))) {
+         if (slower < maxSync) {
+            slower = (slower*SPEED_SEARCH_STEP)/1024+1;
+            currentGuess = slower;
+            rc = hc12confirmSpeed(currentGuess);
+            if (rc == BDM_RC_OK) {
+               break;
+            }
+         }
+         if (faster > minSync) {
+            faster = (faster*1024)/SPEED_SEARCH_STEP;
+            currentGuess = faster;
+            rc = hc12confirmSpeed(currentGuess);
+         }
       }
+   }
    if (rc == BDM_RC_OK) {
-      // Update speed cache (LRU)
-      lastGuess2         = lastGuess1;
-      lastGuess1         = currentGuess;
+      speedCacheHit(currentGuess);
       cable_status.speed = SPEED_GUESSED;  // Speed found by trial and error
-      return BDM_RC_OK;
+   }
+   else {
+      // Keep reduced confidence of cached speeds that failed
+      speedCacheSave();
    }
    return rc;
 }
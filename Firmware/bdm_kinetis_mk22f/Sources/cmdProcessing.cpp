@@ -17,10 +17,19 @@
 #include "bdmCommon.h"
 #include "cmdProcessing.h"
 #include "cmdProcessingSWD.h"
+#include "liveWatch.h"
+#include "commandTiming.h"
+#include "targetEvent.h"
 #include "cmdProcessingHCS.h"
 
-/** Buffer for USB command in, result out */
-uint8_t commandBuffer[MAX_COMMAND_SIZE+4];
+/** Number of command buffers - the next command is received while the current one executes */
+static constexpr unsigned COMMAND_BUFFER_COUNT = 2;
+
+/** Command buffers used alternately - a command is received, executed and its response built in place */
+static uint8_t commandBuffers[COMMAND_BUFFER_COUNT][COMMAND_BUFFER_SIZE];
+
+/** Buffer for USB command in, result out (current entry of commandBuffers[]) */
+uint8_t *commandBuffer = commandBuffers[0];
 
 /** Size of command return result */
 int returnSize;
@@ -49,6 +58,9 @@ BDM_Option_t bdm_option = {
 /** Error code from last/current command */
 static USBDM_ErrorCode commandStatus;
 
+/** Sequence number from current command (upper 2 bits of command byte) */
+static uint8_t commandSequence = 0;
+
 /**
  *  Creates status byte
  *
@@ -231,6 +243,83 @@ USBDM_ErrorCode eraseKinetisSecurity(void) {
 }
 #endif
 
+/**
+ *  Get command latency statistics
+ *
+ *  @param command  Command code or 0xFF for host turnaround, SWD & USB counters
+ *  @param clear    Clear all statistics after reading
+ *
+ *  @return
+ *    commandBuffer (command code, times in probe clock cycles)\n
+ *      - [1..4]   = Number of executions\n
+ *      - [5..8]   = Minimum receive->send time\n
+ *      - [9..12]  = Maximum receive->send time\n
+ *      - [13..16] = Mean receive->send time\n
+ *      - [17..20] = Mean firmware overhead (receive->dispatch + complete->send)\n
+ *      - [21..24] = Mean execution time (dispatch->complete)\n
+ *      - [25..56] = 16 x 16-bit log2 histogram of receive->send time\n
+ *    commandBuffer (0xFF)\n
+ *      - [1..4]   = Number of host turnarounds (send->next receive)\n
+ *      - [5..8]   = Mean host turnaround time\n
+ *      - [9..12]  = Probe clock frequency (Hz)\n
+ *      - [13..16] = SWD WAIT responses\n
+ *      - [17..20] = SWD parity errors\n
+ *      - [21..24] = SWD re-connects\n
+ *      - [25..28] = USB interrupt entries\n
+ *      - [29..32] = USB interrupt sources serviced without a separate entry (coalesced)\n
+ *      - [33..36] = USB tokens processed
+ */
+static USBDM_ErrorCode getCommandTiming(uint8_t command, bool clear) {
+   if (command == 0xFF) {
+      const HostTiming &host = timingGetHost();
+      uint32_t mean = (host.count == 0)?0:(uint32_t)(host.totalCycles/host.count);
+      unpack32BE(host.count,      commandBuffer+1);
+      unpack32BE(mean,            commandBuffer+5);
+      unpack32BE(SystemCoreClock, commandBuffer+9);
+#if (TARGET_CAPABILITY&CAP_ARM_SWD)
+      Swd::TransactionStatistics statistics;
+      Swd::getTransactionStatistics(statistics, clear);
+      unpack32BE(statistics.waits,        commandBuffer+13);
+      unpack32BE(statistics.parityErrors, commandBuffer+17);
+      unpack32BE(statistics.reconnects,   commandBuffer+21);
+#else
+      memset(commandBuffer+13, 0, 12);
+#endif
+      USBDM::UsbImplementation::IrqStatistics usbStatistics;
+      USBDM::UsbImplementation::getIrqStatistics(usbStatistics, clear);
+      unpack32BE(usbStatistics.interrupts, commandBuffer+25);
+      unpack32BE(usbStatistics.coalesced,  commandBuffer+29);
+      unpack32BE(usbStatistics.tokens,     commandBuffer+33);
+      returnSize = 37;
+   }
+   else {
+      if (command >= TIMING_NUM_COMMANDS) {
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      const CommandTiming &timing = timingGetCommand(command);
+      uint32_t count = timing.count;
+      unpack32BE(count, commandBuffer+1);
+      if (count == 0) {
+         memset(commandBuffer+5, 0, 20);
+      }
+      else {
+         unpack32BE(timing.minCycles,                        commandBuffer+5);
+         unpack32BE(timing.maxCycles,                        commandBuffer+9);
+         unpack32BE((uint32_t)(timing.totalCycles/count),    commandBuffer+13);
+         unpack32BE((uint32_t)(timing.overheadCycles/count), commandBuffer+17);
+         unpack32BE((uint32_t)(timing.executeCycles/count),  commandBuffer+21);
+      }
+      for (unsigned bucket=0; bucket<TIMING_NUM_BUCKETS; bucket++) {
+         unpack16BE(timing.histogram[bucket], commandBuffer+25+2*bucket);
+      }
+      returnSize = 25+2*TIMING_NUM_BUCKETS;
+   }
+   if (clear) {
+      timingClear();
+   }
+   return BDM_RC_OK;
+}
+
 /**
  *  Various debugging & testing commands
  *
@@ -342,7 +431,62 @@ USBDM_ErrorCode f_CMD_DEBUG(void) {
 
       case   BDM_DBG_SWD:  //!< - Test ARM-SWD functions
          return Swd::connect();
+
+      case   BDM_DBG_SWD_READ_STATS:  //!< - Get SWD pipelined memory read statistics
+      {
+         Swd::BlockReadStatistics statistics;
+         Swd::getBlockReadStatistics(statistics, commandBuffer[3] != 0);
+         uint32_t bytesPerSecond = 0;
+         if (statistics.ticks != 0) {
+            bytesPerSecond = ((uint64_t)statistics.bytes*SystemCoreClock)/statistics.ticks;
+         }
+         unpack32BE(statistics.bytes,     commandBuffer+1);
+         unpack32BE(statistics.swdClocks, commandBuffer+5);
+         unpack32BE(bytesPerSecond,       commandBuffer+9);
+         unpack32BE(Swd::getSpeed(),      commandBuffer+13);
+         returnSize = 17;
+         return BDM_RC_OK;
+      }
+
+      case   BDM_DBG_SWD_XFER_STATS:  //!< - Get SWD register transaction statistics
+      {
+         Swd::TransactionStatistics statistics;
+         Swd::getTransactionStatistics(statistics, commandBuffer[3] != 0);
+         unpack32BE(statistics.reads,        commandBuffer+1);
+         unpack32BE(statistics.writes,       commandBuffer+5);
+         unpack32BE(statistics.waits,        commandBuffer+9);
+         unpack32BE(statistics.faults,       commandBuffer+13);
+         unpack32BE(statistics.noResponses,  commandBuffer+17);
+         unpack32BE(statistics.parityErrors, commandBuffer+21);
+         unpack32BE(statistics.swdClocks,    commandBuffer+25);
+         unpack32BE(statistics.pushrWrites,  commandBuffer+29);
+         unpack32BE(statistics.reconnects,   commandBuffer+33);
+         returnSize = 37;
+         return BDM_RC_OK;
+      }
+
+      case   BDM_DBG_SWD_READ_CHECK:  //!< - Compare SWD pipelined memory read with individual reads
+      {
+         // Pipelined data is read into the command buffer after the result
+         static constexpr unsigned DATA_OFFSET = 12;
+         unsigned count   = commandBuffer[3];
+         uint32_t address = pack32BE(commandBuffer+4);
+         if (count > (COMMAND_BUFFER_SIZE-DATA_OFFSET)) {
+            return BDM_RC_ILLEGAL_PARAMS;
+         }
+         unsigned mismatches, firstMismatch;
+         USBDM_ErrorCode rc = Swd::checkBlockRead(address, count, commandBuffer+DATA_OFFSET, mismatches, firstMismatch);
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+         unpack32BE(mismatches,    commandBuffer+1);
+         unpack32BE(firstMismatch, commandBuffer+5);
+         returnSize = 9;
+         return BDM_RC_OK;
+      }
 #endif
+      case   BDM_DBG_COMMAND_TIMING:  //!< - Get command latency statistics
+         return getCommandTiming(commandBuffer[3], commandBuffer[4] != 0);
 #if (TARGET_CAPABILITY & CAP_ARM_SWD) && defined(ERASE_KINETIS)
 
       case   BDM_DBG_SWD+10:  //!< - Erase Kinetis Security region
@@ -376,6 +520,7 @@ USBDM_ErrorCode f_CMD_SET_OPTIONS(void) {
    bdm_option.leaveTargetPowered = value&(1<<2);
    bdm_option.guessSpeed         = value&(1<<3);
    bdm_option.useResetSignal     = value&(1<<4);
+   bdm_option.notifyTargetEvents = value&(1<<5);
    bdm_option.targetVdd          = (TargetVddSelect_t)commandBuffer[sub++];
    bdm_option.useAltBDMClock     = (ClkSwValues_t)commandBuffer[sub++];
    bdm_option.autoReconnect      = (AutoConnect_t)commandBuffer[sub++];
@@ -655,6 +800,10 @@ typedef struct {
 } FunctionPtrs;
 
 extern USBDM_ErrorCode f_CMD_SET_TARGET(void);
+extern USBDM_ErrorCode f_CMD_READ_MEM_STREAM(void);
+extern USBDM_ErrorCode f_CMD_WRITE_MEM_STREAM(void);
+extern USBDM_ErrorCode f_CMD_EXECUTE_BATCH(void);
+extern USBDM_ErrorCode f_CMD_CALCULATE_CRC32(void);
 
 /** Command functions shared by all targets */
 static const FunctionPtr commonFunctionPtrs[] = {
@@ -667,11 +816,11 @@ static const FunctionPtr commonFunctionPtrs[] = {
       f_CMD_GET_BDM_STATUS             ,//= 4,  CMD_USBDM_GET_BDM_STATUS
       f_CMD_GET_CAPABILITIES           ,//= 5,  CMD_USBDM_GET_CAPABILITIES
       f_CMD_SET_OPTIONS                ,//= 6,  CMD_USBDM_SET_OPTIONS
-      f_CMD_ILLEGAL                    ,//= 7,  Reserved
+      f_CMD_CALCULATE_CRC32            ,//= 7,  CMD_USBDM_CALCULATE_CRC32
       f_CMD_CONTROL_PINS               ,//= 8,  CMD_USBDM_CONTROL_PINS
-      //   f_CMD_ILLEGAL                    ,//= 9,  Reserved
-      //   f_CMD_ILLEGAL                    ,//= 10, Reserved
-      //   f_CMD_ILLEGAL                    ,//= 11, Reserved
+      f_CMD_READ_MEM_STREAM            ,//= 9,  CMD_USBDM_READ_MEM_STREAM
+      f_CMD_WRITE_MEM_STREAM           ,//= 10, CMD_USBDM_WRITE_MEM_STREAM
+      f_CMD_EXECUTE_BATCH              ,//= 11, CMD_USBDM_EXECUTE_BATCH
       //   f_CMD_ILLEGAL                    ,//= 12, CMD_USBDM_GET_VER (EP0)
       //   f_CMD_ILLEGAL                    ,//= 13, Reserved
       //   f_CMD_ILLEGAL                    ,//= 14, CMD_USBDM_ICP_BOOT (EP0)
@@ -984,7 +1133,23 @@ static const FunctionPtrs HCS12FunctionPointers = {CMD_USBDM_CONNECT,
          Swd::f_CMD_READ_MEM               ,//= 33  CMD_USBDM_READ_MEM
 #if HW_CAPABILITY&CAP_CORE_REGS
          Swd::f_CMD_READ_ALL_CORE_REGS     ,//= 34  CMD_USBDM_READ_ALL_REGS
+#else
+         f_CMD_ILLEGAL                     ,//= 34  CMD_USBDM_READ_ALL_REGS
 #endif
+         f_CMD_ILLEGAL                     ,//= 35  CMD_USBDM_RS08_FLASH_ENABLE
+         f_CMD_ILLEGAL                     ,//= 36  CMD_USBDM_RS08_FLASH_STATUS
+         f_CMD_ILLEGAL                     ,//= 37  CMD_USBDM_RS08_FLASH_DISABLE
+         f_CMD_ILLEGAL                     ,//= 38  CMD_USBDM_JTAG_GOTORESET
+         f_CMD_ILLEGAL                     ,//= 39  CMD_USBDM_JTAG_GOTOSHIFT
+         f_CMD_ILLEGAL                     ,//= 40  CMD_USBDM_JTAG_WRITE
+         f_CMD_ILLEGAL                     ,//= 41  CMD_USBDM_JTAG_READ
+         f_CMD_ILLEGAL                     ,//= 42  CMD_USBDM_SET_VPP
+         f_CMD_ILLEGAL                     ,//= 43  CMD_USBDM_JTAG_READ_WRITE
+         f_CMD_ILLEGAL                     ,//= 44  CMD_USBDM_JTAG_EXECUTE_SEQUENCE
+         Swd::f_CMD_FLASH_SETUP            ,//= 45  CMD_USBDM_FLASH_SETUP
+         Swd::f_CMD_FLASH_PROGRAM_STREAM   ,//= 46  CMD_USBDM_FLASH_PROGRAM_STREAM
+         Swd::f_CMD_PROFILE                ,//= 47  CMD_USBDM_PROFILE
+         Swd::f_CMD_LIVE_WATCH             ,//= 48  CMD_USBDM_LIVE_WATCH
    };
    /** Information about command functions for ARM-SWD targets */
    static const FunctionPtrs SWDFunctionPointers   = {CMD_USBDM_CONNECT,
@@ -1071,6 +1236,232 @@ USBDM_ErrorCode f_CMD_SET_TARGET(void) {
    return setTarget(target);
 }
 
+/** Maximum data bytes in each memory stream packet (multiple of 4 for element alignment) */
+static constexpr unsigned STREAM_IN_BLOCK_SIZE  = USBDM::BULK_IN_EP_MAXSIZE-4;
+/** Maximum data bytes in each memory stream OUT packet */
+static constexpr unsigned STREAM_OUT_BLOCK_SIZE = USBDM::BULK_OUT_EP_MAXSIZE;
+
+/**
+ *  Execute a memory command for the current target
+ *  This builds the command in commandBuffer and dispatches it through the target function table
+ *
+ *  @param command      CMD_USBDM_READ_MEM or CMD_USBDM_WRITE_MEM
+ *  @param memorySpace  Memory space/element size
+ *  @param count        Number of bytes to transfer
+ *  @param address      Target memory address
+ *
+ *  @note For writes the data is expected in commandBuffer[8..]\n
+ *        For reads the data is returned in commandBuffer[1..]
+ */
+static USBDM_ErrorCode executeMemoryCommand(BDMCommands command, uint8_t memorySpace, uint8_t count, uint32_t address) {
+   if (currentFunctions == NULL) {
+      return BDM_RC_ILLEGAL_COMMAND;
+   }
+   int commandIndex = command - currentFunctions->firstCommand;
+   if ((commandIndex < 0) || (commandIndex >= currentFunctions->size)) {
+      return BDM_RC_ILLEGAL_COMMAND;
+   }
+   commandBuffer[1] = command;
+   commandBuffer[2] = memorySpace;
+   commandBuffer[3] = count;
+   unpack32BE(address, commandBuffer+4);
+   return currentFunctions->functions[commandIndex]();
+}
+
+/*
+ *  Read target memory as a stream of bulk IN packets
+ *
+ *  @note
+ *    commandBuffer\n
+ *      - [2]     = Memory space/element size\n
+ *      - [4..7]  = Target address\n
+ *      - [8..11] = Byte count\n
+ *
+ *  @return
+ *   Each packet is [0] status+sequence, [1..60] data\n
+ *   The final packet is returned by commandLoop() as the usual command response
+ */
+USBDM_ErrorCode f_CMD_READ_MEM_STREAM(void) {
+   uint8_t  memorySpace = commandBuffer[2];
+   uint32_t address     = pack32BE(commandBuffer+4);
+   uint32_t count       = pack32BE(commandBuffer+8);
+
+   USBDM_ErrorCode rc = optionalReconnect(AUTOCONNECT_ALWAYS);
+   while ((rc == BDM_RC_OK) && (count > 0)) {
+      uint8_t blockSize = (count>STREAM_IN_BLOCK_SIZE)?STREAM_IN_BLOCK_SIZE:count;
+      rc = executeMemoryCommand(CMD_USBDM_READ_MEM, memorySpace, blockSize, address);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      address    += blockSize;
+      count      -= blockSize;
+      returnSize  = blockSize+1;
+      if (count == 0) {
+         // Last block is left in commandBuffer as the command response
+         break;
+      }
+      // The next block is read from the target while this one is sent.
+      // The block is staged in commandBuffer because the end-point buffer is single-buffered -
+      // reading directly into it would serialise target reads with USB transmission.
+      uint8_t *packet = USBDM::UsbImplementation::lendBulkInBuffer();
+      memcpy(packet+1, commandBuffer+1, blockSize);
+      packet[0] = BDM_RC_OK|commandSequence;
+      USBDM::UsbImplementation::returnBulkInBuffer(blockSize+1);
+   }
+   return rc;
+}
+
+/** Maximum data bytes read from target for each CRC block (multiple of 4 for element alignment) */
+static constexpr unsigned CRC_BLOCK_SIZE = (MAX_COMMAND_SIZE-2)&~3;
+
+/*
+ *  Calculate CRC32 of target memory
+ *
+ *  The target is read using the usual memory command for the current target and
+ *  each block is fed to the CRC module as it arrives.  Only the CRC is returned to the host.
+ *
+ *  @note
+ *    commandBuffer\n
+ *      - [2]     = Memory space/element size\n
+ *      - [4..7]  = Target address\n
+ *      - [8..11] = Byte count\n
+ *
+ *  @return
+ *    commandBuffer\n
+ *      - [1..4] = CRC32 (IEEE 802.3, reflected, initial value and final XOR 0xFFFFFFFF)
+ */
+USBDM_ErrorCode f_CMD_CALCULATE_CRC32(void) {
+   uint8_t  memorySpace = commandBuffer[2];
+   uint32_t address     = pack32BE(commandBuffer+4);
+   uint32_t count       = pack32BE(commandBuffer+8);
+
+   // CRC-32: transpose bits in bytes on write, bits and bytes on read, complement result
+   SIM->SCGC6 |= SIM_SCGC6_CRC_MASK;
+   CRC->CTRL  = CRC_CTRL_TCRC_MASK|CRC_CTRL_TOT(1)|CRC_CTRL_TOTR(2)|CRC_CTRL_FXOR_MASK;
+   CRC->GPOLY = 0x04C11DB7;
+   CRC->CTRL  = CRC_CTRL_TCRC_MASK|CRC_CTRL_TOT(1)|CRC_CTRL_TOTR(2)|CRC_CTRL_FXOR_MASK|CRC_CTRL_WAS_MASK;
+   CRC->DATA  = 0xFFFFFFFF;
+   CRC->CTRL  = CRC_CTRL_TCRC_MASK|CRC_CTRL_TOT(1)|CRC_CTRL_TOTR(2)|CRC_CTRL_FXOR_MASK;
+
+   USBDM_ErrorCode rc = optionalReconnect(AUTOCONNECT_ALWAYS);
+   while ((rc == BDM_RC_OK) && (count > 0)) {
+      uint8_t blockSize = (count>CRC_BLOCK_SIZE)?CRC_BLOCK_SIZE:count;
+      rc = executeMemoryCommand(CMD_USBDM_READ_MEM, memorySpace, blockSize, address);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      // Target memory is a byte stream so data is written a byte at a time
+      const uint8_t *data = commandBuffer+1;
+      for (unsigned sub=0; sub<blockSize; sub++) {
+         CRC->DATALL = data[sub];
+      }
+      address += blockSize;
+      count   -= blockSize;
+   }
+   if (rc == BDM_RC_OK) {
+      unpack32BE(CRC->DATA, commandBuffer+1);
+      returnSize = 5;
+   }
+   return rc;
+}
+
+/*
+ *  Receive a stream of bulk OUT data packets following a command
+ *
+ *  @param count    Number of data bytes expected
+ *  @param handler  Routine to process each packet as it arrives
+ *  @param rc       Status from command set-up. The handler is not called if this indicates an error
+ *
+ *  @return Status from set-up or first handler failure
+ *
+ *  @note The next packet is received while the handler processes the previous one.\n
+ *        All data packets are consumed even on error to keep the host synchronised
+ */
+USBDM_ErrorCode receiveDataStream(uint32_t count, StreamHandler handler, USBDM_ErrorCode rc) {
+   // Packets in transit - the next packet is received while the previous one is processed
+   static uint8_t streamBuffers[2][USBDM::BULK_OUT_EP_MAXSIZE];
+   unsigned bufferIndex = 0;
+
+   if (count > 0) {
+      USBDM::UsbImplementation::startReceiveBulkData(STREAM_OUT_BLOCK_SIZE, streamBuffers[bufferIndex]);
+   }
+   while (count > 0) {
+      uint8_t *packet    = streamBuffers[bufferIndex];
+      uint32_t blockSize = USBDM::UsbImplementation::waitReceiveBulkData();
+      if (blockSize == 0) {
+         // Host has abandoned the transfer
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      if (blockSize > count) {
+         blockSize = count;
+      }
+      count -= blockSize;
+      if (count > 0) {
+         bufferIndex ^= 1;
+         USBDM::UsbImplementation::startReceiveBulkData(STREAM_OUT_BLOCK_SIZE, streamBuffers[bufferIndex]);
+      }
+      if (rc == BDM_RC_OK) {
+         rc = handler(packet, blockSize);
+      }
+   }
+   return rc;
+}
+
+/** Memory space for CMD_USBDM_WRITE_MEM_STREAM */
+static uint8_t  streamMemorySpace;
+/** Next target address for CMD_USBDM_WRITE_MEM_STREAM */
+static uint32_t streamAddress;
+
+/**
+ *  Write a data packet from CMD_USBDM_WRITE_MEM_STREAM to target memory
+ *
+ *  @param data   Data to write
+ *  @param size   Number of bytes
+ *
+ *  @return Error code
+ */
+static USBDM_ErrorCode writeStreamPacket(uint8_t *data, unsigned size) {
+   memcpy(commandBuffer+8, data, size);
+   USBDM_ErrorCode rc = executeMemoryCommand(CMD_USBDM_WRITE_MEM, streamMemorySpace, size, streamAddress);
+   streamAddress += size;
+   return rc;
+}
+
+/*
+ *  Write target memory from a stream of bulk OUT packets
+ *
+ *  @note
+ *    commandBuffer\n
+ *      - [2]     = Memory space/element size\n
+ *      - [4..7]  = Target address\n
+ *      - [8..11] = Byte count\n
+ *    Followed by raw data packets of up to 64 bytes
+ *
+ *  @note All data packets are consumed even on error to keep the host synchronised
+ */
+USBDM_ErrorCode f_CMD_WRITE_MEM_STREAM(void) {
+   streamMemorySpace = commandBuffer[2];
+   streamAddress     = pack32BE(commandBuffer+4);
+   uint32_t count    = pack32BE(commandBuffer+8);
+
+   USBDM_ErrorCode rc = optionalReconnect(AUTOCONNECT_ALWAYS);
+   rc = receiveDataStream(count, writeStreamPacket, rc);
+   returnSize = 1;
+   return rc;
+}
+
+/**
+ *  Indicates if a command receives its own data packets after the command packet
+ *
+ *  @param command Command to check
+ *
+ *  @return true if the command reads further bulk OUT packets
+ */
+static bool receivesDataStream(BDMCommands command) {
+   return (command == CMD_USBDM_WRITE_MEM_STREAM) ||
+          (command == CMD_USBDM_FLASH_PROGRAM_STREAM);
+}
+
 /*
  *   Processes all commands received over USB
  *
@@ -1121,7 +1512,8 @@ static void commandExec(void) {
       returnSize = 1;  // Return a single byte error code
       // Always do
       // Changed guard V4.10.6
-      if ((uint8_t)command > sizeof(commonFunctionPtrs)/sizeof(FunctionPtr)) {
+      if (((uint8_t)command > sizeof(commonFunctionPtrs)/sizeof(FunctionPtr)) ||
+          (command == CMD_USBDM_READ_MEM_STREAM) || (command == CMD_USBDM_WRITE_MEM_STREAM)) {
          // Modeless command
          // Do any common error recovery or cleanup here
 #if (TARGET_CAPABILITY&CAP_CFVx)
@@ -1158,9 +1550,132 @@ static void commandExec(void) {
 //   Debug::low();
 }
 
+/*
+ *  Execute a list of commands
+ *
+ *  @note
+ *    commandBuffer\n
+ *      - [2]     = Options, see BatchOptions_t\n
+ *      - [3]     = Number of sub-commands\n
+ *      - [4..N]  = Sub-commands, each [size][command][parameters]\n
+ *
+ *  @return
+ *    commandBuffer\n
+ *      - [1]     = Number of sub-commands executed\n
+ *      - [2..N]  = Results, each [size][status][results]\n
+ *
+ *  @note Sub-commands are executed through commandExec() so each has the usual
+ *        reconnect and error recovery behaviour.
+ *        Commands that use the USB end-points directly may not be batched.
+ *
+ *  @note The sizes of all sub-commands are checked before any is executed so a malformed
+ *        batch returns BDM_RC_ILLEGAL_PARAMS without side effects.
+ *
+ *  @note A sub-command that executes but whose results do not fit in the response is still counted.
+ *        Its result is truncated to [1][BDM_RC_OVERRUN] and the batch stops.
+ */
+USBDM_ErrorCode f_CMD_EXECUTE_BATCH(void) {
+   // Copy of sub-commands as commandBuffer is used to execute each one
+   static uint8_t batchCommands[MAX_COMMAND_SIZE];
+   // Results are accumulated here
+   static uint8_t batchResults[MAX_COMMAND_SIZE];
+
+   uint8_t  options      = commandBuffer[2];
+   unsigned commandCount = commandBuffer[3];
+   memcpy(batchCommands, commandBuffer+4, MAX_COMMAND_SIZE-4);
+
+   // Check the whole batch before executing any of it
+   unsigned commandIndex = 0;
+   for (unsigned index=0; index<commandCount; index++) {
+      unsigned size = batchCommands[commandIndex];
+      if ((size == 0) || ((commandIndex+1+size) > (MAX_COMMAND_SIZE-4))) {
+         // Malformed sub-command
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      commandIndex += 1+size;
+   }
+   commandIndex = 0;
+   unsigned resultIndex  = 2;
+   unsigned executed     = 0;
+   while (executed < commandCount) {
+      if ((resultIndex+2) > MAX_COMMAND_SIZE) {
+         // No room for even a status result - host should use smaller batches
+         break;
+      }
+      unsigned size = batchCommands[commandIndex];
+      commandBuffer[0] = size;
+      memcpy(commandBuffer+1, batchCommands+commandIndex+1, size);
+      commandIndex += 1+size;
+
+      // Discard sequence/flag bits as done for top-level commands
+      commandBuffer[1] &= 0x3F;
+      BDMCommands command = (BDMCommands)commandBuffer[1];
+      if ((command == CMD_USBDM_EXECUTE_BATCH) ||
+          (command == CMD_USBDM_READ_MEM_STREAM) ||
+          receivesDataStream(command)) {
+         commandBuffer[0] = BDM_RC_ILLEGAL_COMMAND;
+         returnSize       = 1;
+      }
+      else {
+         commandExec();
+      }
+      if ((resultIndex+1+returnSize) > MAX_COMMAND_SIZE) {
+         // Command has executed but result does not fit - report truncation
+         batchResults[resultIndex++] = 1;
+         batchResults[resultIndex++] = BDM_RC_OVERRUN;
+         executed++;
+         break;
+      }
+      batchResults[resultIndex++] = returnSize;
+      memcpy(batchResults+resultIndex, commandBuffer, returnSize);
+      resultIndex += returnSize;
+      executed++;
+      if ((commandBuffer[0] != BDM_RC_OK) && !(options & BATCH_CONTINUE_ON_ERROR)) {
+         break;
+      }
+   }
+   batchResults[1] = executed;
+   memcpy(commandBuffer+1, batchResults+1, resultIndex-1);
+   returnSize = resultIndex;
+   return BDM_RC_OK;
+}
+
+/** Command buffer holding a multi-packet response that may still be transmitting */
+static const uint8_t *responsePending = nullptr;
+
+/**
+ * Start reception of the next command
+ *
+ * @param buffer Command buffer to receive into
+ */
+static void startCommandReceive(uint8_t *buffer) {
+   if (buffer == responsePending) {
+      // Previous response is still being sent from this buffer
+      USBDM::UsbImplementation::waitSendBulkData();
+      responsePending = nullptr;
+   }
+   USBDM::UsbImplementation::startReceiveBulkData(MAX_COMMAND_SIZE, buffer);
+}
+
+/**
+ * Background work done while waiting for a command\n
+ * (live-watch sampling and target event polling)
+ */
+static void idleFunction() {
+#if (TARGET_CAPABILITY&CAP_ARM_SWD)
+   Swd::watchPoll();
+#endif
+   targetEventPoll();
+}
+
 /**
  * Process commands from USB device
  *
+ *   Reception of the next command is started before the current command is executed
+ *   so the host may queue commands and have USB transfers overlap target operations.\n
+ *   Commands that receive their own data packets (e.g. CMD_USBDM_WRITE_MEM_STREAM) delay this
+ *   until they have completed.
+ *
  *   @note : Command                                    \n
  *       commandBuffer[0]    = size of command (N)      \n
  *       commandBuffer[1]    = command                  \n
@@ -1171,14 +1686,47 @@ static void commandExec(void) {
  *       commandBuffer[1..N] = response/data
  */
 void commandLoop(void) {
-   static uint8_t commandSequence = 0;
+   unsigned receiveIndex  = 0;
+   bool     receiveArmed  = false;
+
+   timingInitialise();
 
    for(;;) {
-      (void)USBDM::UsbImplementation::receiveBulkData(MAX_COMMAND_SIZE, commandBuffer);
+      if (!receiveArmed) {
+         startCommandReceive(commandBuffers[receiveIndex]);
+      }
+      (void)USBDM::UsbImplementation::waitReceiveBulkData(idleFunction);
+      timingMark(TIMING_RECEIVE);
+      // Command is executed in the buffer it was received into
+      commandBuffer = commandBuffers[receiveIndex];
+      receiveIndex  = (receiveIndex+1)%COMMAND_BUFFER_COUNT;
+
       commandSequence = commandBuffer[1] & 0xC0;
       commandBuffer[1] &= 0x3F;
+
+      // Arm reception of next command while this one executes
+      receiveArmed = !receivesDataStream((BDMCommands)commandBuffer[1]);
+      if (receiveArmed) {
+         startCommandReceive(commandBuffers[receiveIndex]);
+      }
+      uint8_t command = commandBuffer[1];
+      timingMark(TIMING_DISPATCH);
       commandExec();
+      timingMark(TIMING_COMPLETE);
       commandBuffer[0] |= commandSequence;
-      USBDM::UsbImplementation::sendBulkData(returnSize, commandBuffer);
+
+      if (returnSize <= (int)USBDM::BULK_IN_EP_MAXSIZE) {
+         // Single packet - copied once into end-point buffer
+         uint8_t *response = USBDM::UsbImplementation::lendBulkInBuffer();
+         memcpy(response, commandBuffer, returnSize);
+         USBDM::UsbImplementation::returnBulkInBuffer(returnSize);
+      }
+      else {
+         // Sent from the command buffer which is not received into until transmission completes
+         USBDM::UsbImplementation::sendBulkData(returnSize, commandBuffer);
+         responsePending = commandBuffer;
+      }
+      timingMark(TIMING_SEND);
+      timingRecord(command);
    }
 }
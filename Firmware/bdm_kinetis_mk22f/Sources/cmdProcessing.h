@@ -6,8 +6,11 @@
 #include <stdint.h>
 #include "commands.h"
 
-/** Buffer for USB command in, result out */
-extern uint8_t   commandBuffer[MAX_COMMAND_SIZE+4];
+/** Size of each command buffer */
+static constexpr unsigned COMMAND_BUFFER_SIZE = MAX_COMMAND_SIZE+4;
+
+/** Buffer for USB command in, result out (commandLoop() alternates between two buffers) */
+extern uint8_t  *commandBuffer;
 
 /** Size of command return result */
 extern int returnSize;
@@ -26,6 +29,29 @@ extern int returnSize;
  */
 extern void commandLoop(void);
 
+/**
+ * Routine to process a data packet received by receiveDataStream()
+ *
+ * @param data   Packet data
+ * @param size   Number of bytes in packet
+ *
+ * @return Error code, processing of later packets stops on error
+ */
+typedef USBDM_ErrorCode (*StreamHandler)(uint8_t *data, unsigned size);
+
+/**
+ * Receive a stream of bulk OUT data packets following a command
+ *
+ * @param count    Number of data bytes expected
+ * @param handler  Routine to process each packet as it arrives
+ * @param rc       Status from command set-up. The handler is not called if this indicates an error
+ *
+ * @return Status from set-up or first handler failure
+ *
+ * @note All data packets are consumed even on error to keep the host synchronised
+ */
+extern USBDM_ErrorCode receiveDataStream(uint32_t count, StreamHandler handler, USBDM_ErrorCode rc);
+
 /**
  *   Optionally re-connects with target
  *
@@ -59,6 +85,7 @@ struct BDM_Option_t {
    bool               leaveTargetPowered:1;   //!< Leave target power on exit
    bool               guessSpeed:1;           //!< Guess speed for target w/o ACKN
    bool               useResetSignal:1;       //!< Use RESET signal on BDM interface
+   bool               notifyTargetEvents:1;   //!< Poll target state and report halt/reset on event end-point
    TargetVddSelect_t  targetVdd;              //!< Selected target Vdd (off, 3.3V or 5V)
    ClkSwValues_t      useAltBDMClock:8;       //!< Use alternative BDM clock source in target (HCS08)
    AutoConnect_t      autoReconnect:8;        //!< Automatically re-connect method (for speed change)
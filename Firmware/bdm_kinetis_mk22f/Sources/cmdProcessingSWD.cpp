@@ -37,6 +37,9 @@
 #include "cmdProcessingSWD.h"
 #include "swd.h"
 #include "bdmCommon.h"
+#include "delay.h"
+#include "swdProfiler.h"
+#include "liveWatch.h"
 
 namespace Swd {
 
@@ -69,12 +72,19 @@ USBDM_ErrorCode f_CMD_CONNECT(void) {
  *
  *  @note
  *   commandBuffer\n
- *    - [2..3]  =>  speed in kHz
+ *    - [2..3]  =>  speed in kHz, 0 => automatically determine speed
  *
  *  @return BDM_RC_OK => success, error otherwise
  */
 USBDM_ErrorCode f_CMD_SET_SPEED(void) {
    uint16_t freq = (commandBuffer[2]<<8)|commandBuffer[3]; // Get the new speed
+   if (freq == 0) {
+      USBDM_ErrorCode rc = checkTargetVdd();
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      return Swd::autoTuneSpeed();
+   }
    return Swd::setSpeed(1000*freq);
 }
 
@@ -217,8 +227,11 @@ USBDM_ErrorCode f_CMD_WRITE_MEM(void) {
  */
 USBDM_ErrorCode f_CMD_READ_MEM(void) {
    uint32_t size = commandBuffer[3];
-   USBDM_ErrorCode rc = Swd::readMemory(commandBuffer[2], commandBuffer[3], pack32BE(commandBuffer+4), commandBuffer+1);
+   uint32_t address = pack32BE(commandBuffer+4);
+   USBDM_ErrorCode rc = Swd::readMemory(commandBuffer[2], commandBuffer[3], address, commandBuffer+1);
    if (rc == BDM_RC_OK) {
+      // Include reset/retire status seen by target event polling
+      Swd::mergeLatchedDHCSR(address, size, commandBuffer+1);
       // Return size including status byte
       returnSize = size+1;
    }
@@ -261,22 +274,19 @@ USBDM_ErrorCode f_CMD_READ_ALL_CORE_REGS(void) {
    }
    uint8_t  regIndex    = commandBuffer[3];
    uint8_t  endRegister = commandBuffer[4];
-   uint8_t* outputPtr   = commandBuffer+1;
    returnSize = 1;
-   while (regIndex<=endRegister) {
-      uint8_t regValue[4];
-      USBDM_ErrorCode rc = Swd::readCoreRegister(regIndexMap[regIndex], regValue);
-      if (rc != BDM_RC_OK) {
-         return rc;
-      }
-      // Write to buffer (target format - LITTLE-ENDIAN ARM)
-      *outputPtr++ = regValue[3];
-      *outputPtr++ = regValue[2];
-      *outputPtr++ = regValue[1];
-      *outputPtr++ = regValue[0];
-      returnSize += 4;
-      regIndex++;
+   if (endRegister >= sizeof(regIndexMap)/sizeof(regIndexMap[0])) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   if (regIndex > endRegister) {
+      return BDM_RC_OK;
    }
+   unsigned count = endRegister-regIndex+1;
+   USBDM_ErrorCode rc = Swd::readCoreRegisters(regIndexMap+regIndex, count, commandBuffer+1);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   returnSize = 1+4*count;
    return BDM_RC_OK;
 }
 
@@ -334,4 +344,342 @@ USBDM_ErrorCode f_CMD_TARGET_HALT(void) {
    return modifyDHCSR(DHCSR_C_MASKINTS, DHCSR_C_HALT|DHCSR_C_DEBUGEN);
 }
 
+/** Time allowed for the flash algorithm to program a buffer */
+static constexpr unsigned FLASH_ALGORITHM_TIMEOUT_ms = 2000;
+
+/** Initial xPSR for flash algorithm (Thumb state) */
+static constexpr uint32_t XPSR_THUMB = (1<<24);
+
+/** Target flash algorithm description from CMD_USBDM_FLASH_SETUP */
+struct FlashAlgorithm {
+   uint32_t entry;          //!< Algorithm entry point
+   uint32_t stack;          //!< Initial stack pointer
+   uint32_t returnAddress;  //!< Address of BKPT instruction used to return to debugger
+   uint32_t buffers[2];     //!< Target RAM data buffers
+   uint32_t bufferSize;     //!< Size of each data buffer
+   bool     valid;          //!< Algorithm has been set up
+};
+
+/** State of flash programming stream */
+struct FlashProgramState {
+   uint32_t flashAddress;   //!< Flash address for start of buffer being filled
+   unsigned bufferIndex;    //!< Index of buffer being filled
+   uint32_t bufferOffset;   //!< Bytes already written to buffer being filled
+   bool     running;        //!< Algorithm is executing on the other buffer
+};
+
+static FlashAlgorithm    flashAlgorithm = {0, 0, 0, {0, 0}, 0, false};
+static FlashProgramState flashState;
+
+/**
+ *  Write 32-bit value to core register
+ *
+ *  @param regNo  Register number
+ *  @param value  Value to write
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+static USBDM_ErrorCode writeCoreRegister(uint32_t regNo, uint32_t value) {
+   uint8_t data[4];
+   unpack32BE(value, data);
+   return writeCoreReg(regNo, data);
+}
+
+/**
+ *  Wait for the flash algorithm to complete (target halts at the BKPT)
+ *
+ *  @return BDM_RC_OK => success, error otherwise \n
+ *     == \ref BDM_RC_TARGET_BUSY => Algorithm did not complete (target is halted) \n
+ *     == \ref BDM_RC_FAIL        => Algorithm reported failure
+ */
+static USBDM_ErrorCode waitForFlashAlgorithm() {
+   if (!flashState.running) {
+      return BDM_RC_OK;
+   }
+   flashState.running = false;
+
+   USBDM_ErrorCode rc;
+   uint32_t dhcsrValue = 0;
+   unsigned timeout    = FLASH_ALGORITHM_TIMEOUT_ms;
+   for(;;) {
+      rc = readMemoryWord(DHCSR_ADDR, dhcsrValue);
+      if ((rc != BDM_RC_OK) || ((dhcsrValue&DHCSR_S_HALT) != 0)) {
+         break;
+      }
+      if (timeout-- == 0) {
+         (void)modifyDHCSR(DHCSR_C_MASKINTS, DHCSR_C_HALT|DHCSR_C_DEBUGEN);
+         return BDM_RC_TARGET_BUSY;
+      }
+      USBDM::waitMS(1);
+   }
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   // Algorithm returns status in R0
+   uint8_t result[4];
+   rc = readCoreRegister(ARM_RegR0, result);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   return (pack32BE(result) == 0)?BDM_RC_OK:BDM_RC_FAIL;
+}
+
+/**
+ *  Start the flash algorithm on the buffer being filled and swap buffers
+ *
+ *  The algorithm is called as: result = algorithm(flashAddress, buffer, size)
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+static USBDM_ErrorCode startFlashAlgorithm() {
+   // Wait for the other buffer to be released
+   USBDM_ErrorCode rc = waitForFlashAlgorithm();
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   const struct {
+      uint8_t  regNo;
+      uint32_t value;
+   } registers[] = {
+      {ARM_RegR0,   flashState.flashAddress},
+      {ARM_RegR1,   flashAlgorithm.buffers[flashState.bufferIndex]},
+      {ARM_RegR2,   flashState.bufferOffset},
+      {ARM_RegSP,   flashAlgorithm.stack},
+      {ARM_RegLR,   flashAlgorithm.returnAddress|1},
+      {ARM_RegPC,   flashAlgorithm.entry&~1},
+      {ARM_RegxPSR, XPSR_THUMB},
+   };
+   for (unsigned index=0; index<(sizeof(registers)/sizeof(registers[0])); index++) {
+      rc = writeCoreRegister(registers[index].regNo, registers[index].value);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   // Run with interrupts masked
+   // C_MASKINTS may only be changed while halted - changing it in the same write
+   // that clears C_HALT is UNPREDICTABLE (ARMv7-M) so it is set first
+   rc = modifyDHCSR(0, DHCSR_C_MASKINTS|DHCSR_C_HALT|DHCSR_C_DEBUGEN);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = modifyDHCSR(0, DHCSR_C_MASKINTS|DHCSR_C_DEBUGEN);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   flashState.running       = true;
+   flashState.flashAddress += flashState.bufferOffset;
+   flashState.bufferOffset  = 0;
+   flashState.bufferIndex  ^= 1;
+   return BDM_RC_OK;
+}
+
+/**
+ *  Copy a data packet from the flash programming stream to the target RAM buffer\n
+ *  The algorithm is started on each buffer as it fills
+ *
+ *  @param data   Data to write
+ *  @param size   Number of bytes
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+static USBDM_ErrorCode writeFlashPacket(uint8_t *data, unsigned size) {
+   while (size > 0) {
+      uint32_t address = flashAlgorithm.buffers[flashState.bufferIndex]+flashState.bufferOffset;
+      uint32_t length  = flashAlgorithm.bufferSize-flashState.bufferOffset;
+      if (length > size) {
+         length = size;
+      }
+      // Don't cross a TAR auto-increment boundary
+      uint32_t wrapLength = 0x400-(address&0x3FF);
+      if (length > wrapLength) {
+         length = wrapLength;
+      }
+      uint32_t elementSize = ((address|length)&3)?MS_Byte:MS_Long;
+      USBDM_ErrorCode rc = writeMemory(elementSize, length, address, data);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      data                    += length;
+      size                    -= length;
+      flashState.bufferOffset += length;
+      if (flashState.bufferOffset == flashAlgorithm.bufferSize) {
+         rc = startFlashAlgorithm();
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**  Set up flash algorithm
+ *
+ *  The algorithm must already have been loaded into target RAM e.g. using CMD_USBDM_WRITE_MEM_STREAM.
+ *
+ *  @note
+ *   commandBuffer\n
+ *    - [4..7]   =>  Algorithm entry point
+ *    - [8..11]  =>  Initial stack pointer
+ *    - [12..15] =>  Return address (must contain a BKPT instruction)
+ *    - [16..19] =>  Data buffer 0 address
+ *    - [20..23] =>  Data buffer 1 address
+ *    - [24..27] =>  Size of each data buffer
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode f_CMD_FLASH_SETUP(void) {
+   flashAlgorithm.valid         = false;
+   flashAlgorithm.entry         = pack32BE(commandBuffer+4);
+   flashAlgorithm.stack         = pack32BE(commandBuffer+8);
+   flashAlgorithm.returnAddress = pack32BE(commandBuffer+12);
+   flashAlgorithm.buffers[0]    = pack32BE(commandBuffer+16);
+   flashAlgorithm.buffers[1]    = pack32BE(commandBuffer+20);
+   flashAlgorithm.bufferSize    = pack32BE(commandBuffer+24);
+   if ((flashAlgorithm.bufferSize == 0) ||
+       ((flashAlgorithm.buffers[0]|flashAlgorithm.buffers[1]|flashAlgorithm.bufferSize)&3)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   flashAlgorithm.valid = true;
+   return BDM_RC_OK;
+}
+
+/**  Program flash from a stream of bulk OUT packets
+ *
+ *  Data is written alternately to the two target RAM buffers.
+ *  The algorithm programs one buffer while the next is filled.
+ *
+ *  @note
+ *   commandBuffer\n
+ *    - [4..7]   =>  Flash address
+ *    - [8..11]  =>  Byte count
+ *   Followed by raw data packets of up to 64 bytes
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ *
+ *  @note The target must be halted
+ */
+USBDM_ErrorCode f_CMD_FLASH_PROGRAM_STREAM(void) {
+   flashState.flashAddress = pack32BE(commandBuffer+4);
+   flashState.bufferIndex  = 0;
+   flashState.bufferOffset = 0;
+   flashState.running      = false;
+   uint32_t count          = pack32BE(commandBuffer+8);
+
+   USBDM_ErrorCode rc = BDM_RC_OK;
+   if (!flashAlgorithm.valid) {
+      rc = BDM_RC_ILLEGAL_PARAMS;
+   }
+   else {
+      uint32_t dhcsrValue;
+      rc = readMemoryWord(DHCSR_ADDR, dhcsrValue);
+      if ((rc == BDM_RC_OK) && ((dhcsrValue&DHCSR_S_HALT) == 0)) {
+         rc = BDM_RC_TARGET_BUSY;
+      }
+   }
+   rc = receiveDataStream(count, writeFlashPacket, rc);
+   if ((rc == BDM_RC_OK) && (flashState.bufferOffset > 0)) {
+      // Program last partial buffer
+      rc = startFlashAlgorithm();
+   }
+   USBDM_ErrorCode finalRc = waitForFlashAlgorithm();
+   if (rc == BDM_RC_OK) {
+      rc = finalRc;
+   }
+   returnSize = 1;
+   return rc;
+}
+
+/**  PC-sampling profiler
+ *
+ *  @note
+ *   commandBuffer\n
+ *    - [2]     =>  Sub-command see ProfileSubCommands
+ *    - [3..N]  =>  Parameters as for sub-command
+ *
+ *  @return BDM_RC_OK => success, error otherwise \n
+ *                                                \n
+ *   commandBuffer                                \n
+ *    - [1..N]  =>  Results as for sub-command
+ */
+USBDM_ErrorCode f_CMD_PROFILE(void) {
+   switch (commandBuffer[2]) {
+   case PROFILE_SETUP:
+      return profileSetup(pack32BE(commandBuffer+4), commandBuffer[3], pack16BE(commandBuffer+8));
+   case PROFILE_SAMPLE: {
+      uint32_t samplesTaken;
+      USBDM_ErrorCode rc = profileSample(pack32BE(commandBuffer+4), pack32BE(commandBuffer+8), samplesTaken);
+      if (rc == BDM_RC_OK) {
+         unpack32BE(samplesTaken, commandBuffer+1);
+         returnSize = 5;
+      }
+      return rc;
+   }
+   case PROFILE_SUMMARY: {
+      ProfileSummary summary;
+      profileGetSummary(summary);
+      unpack32BE(summary.totalSamples,   commandBuffer+1);
+      unpack32BE(summary.outsideSamples, commandBuffer+5);
+      unpack32BE(summary.idleSamples,    commandBuffer+9);
+      unpack32BE(summary.maxCount,       commandBuffer+13);
+      unpack16BE(summary.maxBin,         commandBuffer+17);
+      unpack16BE(summary.numBins,        commandBuffer+19);
+      returnSize = 21;
+      return BDM_RC_OK;
+   }
+   case PROFILE_READ: {
+      unsigned count = commandBuffer[6];
+      if (count > (MAX_COMMAND_SIZE-1)/4) {
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      USBDM_ErrorCode rc = profileReadBins(pack16BE(commandBuffer+4), count, commandBuffer+1);
+      if (rc == BDM_RC_OK) {
+         returnSize = 1+4*count;
+      }
+      return rc;
+   }
+   default:
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+}
+
+/**  Live-watch sampler
+ *
+ *  @note
+ *   commandBuffer\n
+ *    - [2]     =>  Sub-command see WatchSubCommands
+ *    - [3..N]  =>  Parameters as for sub-command
+ *
+ *  @return BDM_RC_OK => success, error otherwise \n
+ *                                                \n
+ *   commandBuffer                                \n
+ *    - [1..N]  =>  Results as for sub-command
+ */
+USBDM_ErrorCode f_CMD_LIVE_WATCH(void) {
+   switch (commandBuffer[2]) {
+   case WATCH_CLEAR:
+      watchClear();
+      return BDM_RC_OK;
+   case WATCH_ADD:
+      return watchAdd(pack32BE(commandBuffer+4), commandBuffer[3]);
+   case WATCH_START:
+      return watchStart(pack32BE(commandBuffer+4));
+   case WATCH_STOP:
+      watchStop();
+      return BDM_RC_OK;
+   case WATCH_STATUS: {
+      WatchStatus status;
+      watchGetStatus(status);
+      unpack32BE(status.records,    commandBuffer+1);
+      unpack32BE(status.dropped,    commandBuffer+5);
+      unpack32BE(status.missed,     commandBuffer+9);
+      unpack16BE(status.recordSize, commandBuffer+13);
+      commandBuffer[15] = status.running;
+      returnSize = 16;
+      return BDM_RC_OK;
+   }
+   default:
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+}
+
 }; // End namespace Swd
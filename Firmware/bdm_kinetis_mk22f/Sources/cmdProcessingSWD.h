@@ -32,6 +32,12 @@ USBDM_ErrorCode f_CMD_READ_DREG(void);
 USBDM_ErrorCode f_CMD_WRITE_CREG(void);
 USBDM_ErrorCode f_CMD_READ_CREG(void);
 
+USBDM_ErrorCode f_CMD_FLASH_SETUP(void);
+USBDM_ErrorCode f_CMD_FLASH_PROGRAM_STREAM(void);
+
+USBDM_ErrorCode f_CMD_PROFILE(void);
+USBDM_ErrorCode f_CMD_LIVE_WATCH(void);
+
 }; // End namespace Swd
 
 #endif /* CMDPROCESSINGSWD_H_ */
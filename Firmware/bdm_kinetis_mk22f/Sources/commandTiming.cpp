@@ -0,0 +1,140 @@
+/** \file
+    \brief Command latency instrumentation
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+#include <string.h>
+#include "hardware.h"
+#include "commandTiming.h"
+
+/** Time-stamps for command being processed */
+static uint32_t timeStamps[TIMING_NUM_POINTS];
+
+/** Time-stamp of previous response (0 => none) */
+static uint32_t lastSend;
+
+/** Statistics for each command code */
+static CommandTiming commandTimings[TIMING_NUM_COMMANDS];
+
+/** Statistics for host turnaround */
+static HostTiming hostTiming;
+
+/**
+ * Initialise timing (enables probe cycle counter) and clear statistics
+ */
+void timingInitialise() {
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+   timingClear();
+}
+
+/**
+ * Clear timing statistics
+ */
+void timingClear() {
+   memset(commandTimings, 0, sizeof(commandTimings));
+   for (unsigned command=0; command<TIMING_NUM_COMMANDS; command++) {
+      commandTimings[command].minCycles = UINT32_MAX;
+   }
+   hostTiming = {0, 0};
+   lastSend   = 0;
+}
+
+/**
+ * Record time-stamp for current command
+ *
+ * @param point Point in processing reached
+ */
+void timingMark(TimingPoint point) {
+   timeStamps[point] = DWT->CYCCNT;
+}
+
+/**
+ * Get histogram bucket for a time
+ *
+ * @param cycles Time in clock cycles
+ *
+ * @return Bucket number
+ */
+static unsigned timingBucket(uint32_t cycles) {
+   cycles >>= TIMING_BUCKET_SHIFT;
+   if (cycles == 0) {
+      return 0;
+   }
+   unsigned bucket = 32-__builtin_clz(cycles);
+   return (bucket<TIMING_NUM_BUCKETS)?bucket:TIMING_NUM_BUCKETS-1;
+}
+
+/**
+ * Accumulate time-stamps for a completed command
+ *
+ * @param command Command code
+ *
+ * @note Must follow timingMark(TIMING_SEND)
+ */
+void timingRecord(uint8_t command) {
+   if (lastSend != 0) {
+      hostTiming.count++;
+      hostTiming.totalCycles += timeStamps[TIMING_RECEIVE]-lastSend;
+   }
+   lastSend = timeStamps[TIMING_SEND];
+
+   CommandTiming &timing = commandTimings[command%TIMING_NUM_COMMANDS];
+
+   // Unsigned arithmetic handles counter wrap-around
+   uint32_t total    = timeStamps[TIMING_SEND]-timeStamps[TIMING_RECEIVE];
+   uint32_t execute  = timeStamps[TIMING_COMPLETE]-timeStamps[TIMING_DISPATCH];
+
+   timing.count++;
+   timing.totalCycles    += total;
+   timing.executeCycles  += execute;
+   timing.overheadCycles += total-execute;
+   if (total < timing.minCycles) {
+      timing.minCycles = total;
+   }
+   if (total > timing.maxCycles) {
+      timing.maxCycles = total;
+   }
+   uint16_t &bin = timing.histogram[timingBucket(total)];
+   if (bin != UINT16_MAX) {
+      bin++;
+   }
+}
+
+/**
+ * Get timing for a command
+ *
+ * @param command Command code
+ *
+ * @return Accumulated timing
+ */
+const CommandTiming &timingGetCommand(uint8_t command) {
+   return commandTimings[command%TIMING_NUM_COMMANDS];
+}
+
+/**
+ * Get host turnaround timing
+ *
+ * @return Accumulated timing
+ */
+const HostTiming &timingGetHost() {
+   return hostTiming;
+}
@@ -0,0 +1,114 @@
+/** \file
+    \brief Command latency instrumentation
+
+   Each command is time-stamped with the probe DWT cycle counter at
+   receive, dispatch, completion and send.  Per-command statistics separate
+   firmware overhead (receive->dispatch + complete->send) from command
+   execution (dispatch->complete, includes target wait states).
+   Host/USB turnaround (send->next receive) is accumulated separately.
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+
+#ifndef INCLUDE_COMMANDTIMING_H_
+#define INCLUDE_COMMANDTIMING_H_
+
+#include <stdint.h>
+#include "commands.h"
+
+/** Number of command codes timed (command byte is 6 bits) */
+static constexpr unsigned TIMING_NUM_COMMANDS = 64;
+
+/** Number of log2 latency histogram buckets */
+static constexpr unsigned TIMING_NUM_BUCKETS  = 16;
+
+/** Bucket 0 counts latencies below 1<<TIMING_BUCKET_SHIFT cycles */
+static constexpr unsigned TIMING_BUCKET_SHIFT = 9;
+
+/** Points in command processing that are time-stamped */
+enum TimingPoint {
+   TIMING_RECEIVE,    //!< Command packet received
+   TIMING_DISPATCH,   //!< Command execution started
+   TIMING_COMPLETE,   //!< Command execution (including target I/O) complete
+   TIMING_SEND,       //!< Response handed to USB
+   TIMING_NUM_POINTS,
+};
+
+/** Accumulated timing for a single command code (times in probe clock cycles) */
+struct CommandTiming {
+   uint32_t count;                         //!< Number of times executed
+   uint32_t minCycles;                     //!< Minimum receive->send time
+   uint32_t maxCycles;                     //!< Maximum receive->send time
+   uint64_t totalCycles;                   //!< Total receive->send time
+   uint64_t overheadCycles;                //!< Total firmware overhead (receive->dispatch + complete->send)
+   uint64_t executeCycles;                 //!< Total execution time (dispatch->complete)
+   uint16_t histogram[TIMING_NUM_BUCKETS]; //!< log2 histogram of receive->send time (saturating)
+};
+
+/** Timing not associated with a particular command */
+struct HostTiming {
+   uint32_t count;                         //!< Number of send->receive intervals
+   uint64_t totalCycles;                   //!< Total send->receive time (host + USB turnaround)
+};
+
+/**
+ * Initialise timing (enables probe cycle counter) and clear statistics
+ */
+void timingInitialise();
+
+/**
+ * Clear timing statistics
+ */
+void timingClear();
+
+/**
+ * Record time-stamp for current command
+ *
+ * @param point Point in processing reached
+ */
+void timingMark(TimingPoint point);
+
+/**
+ * Accumulate time-stamps for a completed command
+ *
+ * @param command Command code
+ *
+ * @note Must follow timingMark(TIMING_SEND)
+ */
+void timingRecord(uint8_t command);
+
+/**
+ * Get timing for a command
+ *
+ * @param command Command code
+ *
+ * @return Accumulated timing
+ */
+const CommandTiming &timingGetCommand(uint8_t command);
+
+/**
+ * Get host turnaround timing
+ *
+ * @return Accumulated timing
+ */
+const HostTiming &timingGetHost();
+
+#endif /* INCLUDE_COMMANDTIMING_H_ */
@@ -47,13 +47,40 @@ enum BDMCommands {
    CMD_USBDM_GET_BDM_STATUS        = 4,   //!< Get BDM status\n @return [1] 16-bit status value reflecting BDM status
    CMD_USBDM_GET_CAPABILITIES      = 5,   //!< Get capabilities of BDM, see HardwareCapabilities_t
    CMD_USBDM_SET_OPTIONS           = 6,   //!< Set BDM options, see BDM_Options_t
-//   CMD_USBDM_GET_SETTINGS        = 7,   //!< Get BDM setting
+   CMD_USBDM_CALCULATE_CRC32       = 7,   //!< Calculate CRC32 of target memory\n
+                                          //!< @param [2] Memory space/element size as for CMD_USBDM_READ_MEM\n
+                                          //!< @param [4..7] 32-bit address\n
+                                          //!< @param [8..11] 32-bit byte count\n
+                                          //!< @return [1..4] 32-bit CRC (IEEE 802.3 polynomial, as zlib crc32())
    CMD_USBDM_CONTROL_PINS          = 8,   //!< Directly control BDM interface levels
-   // Reserved 7..11
+   CMD_USBDM_READ_MEM_STREAM       = 9,   //!< Read target memory using multiple bulk IN packets\n
+                                          //!< @param [2] Memory space/element size as for CMD_USBDM_READ_MEM\n
+                                          //!< @param [4..7] 32-bit address\n
+                                          //!< @param [8..11] 32-bit byte count\n
+                                          //!< @return Sequence of packets each [0] status+sequence, [1..60] data\n
+                                          //!< The stream is terminated early by a single byte packet on error
+   CMD_USBDM_WRITE_MEM_STREAM      = 10,  //!< Write target memory using multiple bulk OUT packets\n
+                                          //!< @param [2] Memory space/element size as for CMD_USBDM_WRITE_MEM\n
+                                          //!< @param [4..7] 32-bit address\n
+                                          //!< @param [8..11] 32-bit byte count\n
+                                          //!< Followed by raw data packets (64 bytes except the last)\n
+                                          //!< @return Single status byte after all data packets have been received
+   CMD_USBDM_EXECUTE_BATCH         = 11,  //!< Execute a list of commands\n
+                                          //!< @param [2] Options, see BatchOptions_t\n
+                                          //!< @param [3] Number of sub-commands\n
+                                          //!< @param [4..N] Sub-commands, each [size][command][parameters] where size counts command+parameters\n
+                                          //!< @return [1] Number of sub-commands executed\n
+                                          //!< [2..N] Results, each [size][status][results] where size counts status+results\n
+                                          //!< A sub-command that executed but whose results did not fit returns [1][BDM_RC_OVERRUN] and ends the batch
    CMD_USBDM_GET_VER               = 12,  //!< Sent to ep0 \n Get firmware version in BCD \n
                                           //!< @return [1] 8-bit HW (major+minor) revision \n [2] 8-bit SW (major+minor) version number
    CMD_GET_VER                     = 12,  //!< Deprecated name - Previous version
-   // Reserved 13
+   CMD_USBDM_GET_USB_TRACE         = 13,  //!< Sent to ep0 \n
+                                          //!< Get USB event trace (firmware built with USB_TRACE)\n
+                                          //!< @param wValue Low 16 bits of index of first event wanted\n
+                                          //!< @return [0] Status, [4..7] Total events recorded, [8..11] Index of first event returned\n
+                                          //!< [12..N] Up to 30 events, see UsbTraceEntry (8 bytes each)\n
+                                          //!< All multi-byte values are little-endian
    CMD_USBDM_ICP_BOOT              = 14,  //!< Sent to ep0 \n
                                           //!< Requests reboot to ICP mode. @param [2..5] must be "BOOT"
    CMD_SET_BOOT                    = 14,  //!< Deprecated - Previous version
@@ -107,6 +134,39 @@ enum BDMCommands {
    CMD_USBDM_SET_VPP               = 42,  //!< Set VPP level
    CMD_USBDM_JTAG_READ_WRITE       = 43,  //!< Read & Write to JTAG chain (in-out buffer)
    CMD_USBDM_JTAG_EXECUTE_SEQUENCE = 44,  //!< Execute sequence of JTAG commands
+
+   CMD_USBDM_FLASH_SETUP           = 45,  //!< Set up flash algorithm previously loaded into target RAM (ARM-SWD)\n
+                                          //!< @param [4..7]   Algorithm entry point\n
+                                          //!< @param [8..11]  Initial stack pointer\n
+                                          //!< @param [12..15] Return address (must contain a BKPT instruction)\n
+                                          //!< @param [16..19] Data buffer 0 address\n
+                                          //!< @param [20..23] Data buffer 1 address\n
+                                          //!< @param [24..27] Size of each data buffer
+   CMD_USBDM_FLASH_PROGRAM_STREAM  = 46,  //!< Program flash from a stream of bulk OUT packets (ARM-SWD)\n
+                                          //!< @param [4..7]   Flash address\n
+                                          //!< @param [8..11]  32-bit byte count\n
+                                          //!< Followed by raw data packets (64 bytes except the last)\n
+                                          //!< @return Single status byte after programming has completed
+   CMD_USBDM_PROFILE               = 47,  //!< PC-sampling profiler (ARM-SWD)\n
+                                          //!< @param [2] Sub-command see ProfileSubCommands
+   CMD_USBDM_LIVE_WATCH            = 48,  //!< Live-watch sampler (ARM-SWD)\n
+                                          //!< @param [2] Sub-command see WatchSubCommands
+};
+
+//! Options for CMD_USBDM_EXECUTE_BATCH
+//!
+enum BatchOptions_t {
+   BATCH_STOP_ON_ERROR     = 0,      //!< Stop at first sub-command that fails
+   BATCH_CONTINUE_ON_ERROR = (1<<0), //!< Execute all sub-commands irrespective of failures
+};
+
+//! Flags in target event notification (event IN end-point)\n
+//! Notification is [0] flags, [1] target type, [2..5] target status (DHCSR or BDM status), [6..7] sequence number
+//!
+enum TargetEventFlags_t {
+   TARGET_EVENT_HALTED  = (1<<0), //!< Target has halted (breakpoint etc.)
+   TARGET_EVENT_RUNNING = (1<<1), //!< Target has resumed execution
+   TARGET_EVENT_RESET   = (1<<2), //!< Target has been reset
 };
 
 //! Error codes returned from BDM routines and BDM commands.
@@ -916,6 +976,53 @@ enum DebugSubCommands {
   BDM_DBG_SWD              = 18, //!< - Test SWD
   BDM_DBG_ARM              = 19, //!< - Test ARM
   BDM_DBG_SWD_ERASE_LOOP   = 20, //!< - Power on polling to capture difficult chips
+  BDM_DBG_SWD_READ_STATS   = 21, //!< - Get (and clear) SWD pipelined memory read statistics
+  BDM_DBG_SWD_XFER_STATS   = 22, //!< - Get (and clear) SWD register transaction statistics
+  BDM_DBG_COMMAND_TIMING   = 23, //!< - Get (and clear) command latency statistics\n
+                                 //!<   @param [3] Command code or 0xFF for host turnaround, SWD & USB counters\n
+                                 //!<   @param [4] Non-zero to clear all statistics after reading
+  BDM_DBG_SWD_READ_CHECK   = 24, //!< - Compare SWD pipelined memory read with individual word reads\n
+                                 //!<   @param [3] Number of bytes (multiple of 4)\n
+                                 //!<   @param [4..7] Address (word aligned)\n
+                                 //!<   @return [1..4] Number of words that differ, [5..8] Offset of first difference
+};
+
+//! Profiler sub commands (used with CMD_USBDM_PROFILE)
+//! All values are BIG-ENDIAN
+enum ProfileSubCommands {
+  PROFILE_SETUP    = 0, //!< - Set up & clear histogram\n
+                        //!<   @param [3] log2(bytes per bin)\n
+                        //!<   @param [4..7] Start address of profiled range\n
+                        //!<   @param [8..9] Number of bins
+  PROFILE_SAMPLE   = 1, //!< - Sample DWT_PCSR while target runs\n
+                        //!<   @param [4..7] Number of samples\n
+                        //!<   @param [8..11] Interval between samples in us\n
+                        //!<   Requests longer than 1 s (allowing 20 us per sample) fail with BDM_RC_ILLEGAL_PARAMS\n
+                        //!<   @return [1..4] Number of samples taken
+  PROFILE_SUMMARY  = 2, //!< - Get histogram totals\n
+                        //!<   @return [1..4] Total samples, [5..8] Samples outside range, [9..12] Samples while halted/sleeping\n
+                        //!<   [13..16] Largest bin count, [17..18] Index of largest bin, [19..20] Number of bins
+  PROFILE_READ     = 3, //!< - Read histogram bins\n
+                        //!<   @param [4..5] First bin\n
+                        //!<   @param [6] Number of bins\n
+                        //!<   @return [1..N] 32-bit bin counts
+};
+
+//! Live-watch sub commands (used with CMD_USBDM_LIVE_WATCH)
+//! Records are returned on the live-watch bulk IN end-point\n
+//! Each record is [0..3] time-stamp in probe clock cycles, [4..N] variable data in the order added\n
+//! All values are BIG-ENDIAN except variable data which is in target order
+enum WatchSubCommands {
+  WATCH_CLEAR      = 0, //!< - Stop sampling and remove all variables
+  WATCH_ADD        = 1, //!< - Add variable\n
+                        //!<   @param [3] Size in bytes\n
+                        //!<   @param [4..7] Address
+  WATCH_START      = 2, //!< - Start sampling\n
+                        //!<   @param [4..7] Sample period in us
+  WATCH_STOP       = 3, //!< - Stop sampling
+  WATCH_STATUS     = 4, //!< - Get sampler status\n
+                        //!<   @return [1..4] Records sampled, [5..8] Records dropped (buffer full),\n
+                        //!<   [9..12] Periods missed (probe busy), [13..14] Record size, [15] Running
 };
 
 //! Commands for BDM when in ICP mode
@@ -0,0 +1,265 @@
+/** \file
+    \brief Small non-volatile records kept in the probe's own flash
+
+   Record layout (32-bit words):
+      [0]      tag = RECORD_MAGIC<<24 | id<<16 | version<<8 | size
+      [1]      checksum (programmed last so an interrupted write is discarded)
+      [2..]    data padded to a whole number of words
+
+   Flash commands use the same FCCOB sequence as executeCommand()/eraseFlashBlock()
+   in cmdProcessing.cpp but on the MK22F FTFA module.
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+#include <string.h>
+#include "derivative.h"
+#include "flashRecord.h"
+
+/** Reserved sector - must agree with 'nvstore' in MemoryMap-frdm_k22f.ld */
+static constexpr uint32_t SECTOR_ADDRESS = 0x0007F800;
+
+/** Size of flash sector (bytes) */
+static constexpr unsigned SECTOR_SIZE    = 0x800;
+
+/** Size of flash sector (words) */
+static constexpr unsigned SECTOR_WORDS   = SECTOR_SIZE/sizeof(uint32_t);
+
+/** Top byte of a valid tag */
+static constexpr uint32_t RECORD_MAGIC   = 0x5A;
+
+/** Words used by tag and checksum */
+static constexpr unsigned HEADER_WORDS   = 2;
+
+/** Program longword */
+static constexpr uint8_t F_PGM4          = 0x06;
+
+/** Erase flash sector */
+static constexpr uint8_t F_ERSSCR        = 0x09;
+
+/** Command and address in FCCOB0..3 */
+#define FTFA_FCCOB3_0 (*(volatile uint32_t*)&FTFA->FCCOB3)
+
+/** Data in FCCOB4..7 */
+#define FTFA_FCCOB7_4 (*(volatile uint32_t*)&FTFA->FCCOB7)
+
+/** Reserved sector */
+static const uint32_t *const sector = (const uint32_t *)SECTOR_ADDRESS;
+
+/** Result of scanning the sector */
+struct SectorScan {
+   unsigned current[FLASH_RECORD_NUM_IDS];  //!< Word offset of current record for each id, SECTOR_WORDS => none
+   unsigned freeOffset;                     //!< Word offset of first free word, SECTOR_WORDS => full or damaged
+};
+
+/**
+ * Number of words used for record data
+ *
+ * @param size Size of data in bytes
+ */
+static constexpr unsigned dataWords(unsigned size) {
+   return (size+sizeof(uint32_t)-1)/sizeof(uint32_t);
+}
+
+/**
+ * Calculate record checksum
+ *
+ * @param tag       Record tag
+ * @param data      Record data
+ * @param numWords  Number of data words
+ */
+static uint32_t checksum(uint32_t tag, const uint32_t *data, unsigned numWords) {
+   uint32_t sum = tag;
+   while (numWords-->0) {
+      sum += *data++;
+   }
+   return ~sum;
+}
+
+/**
+ * Locate current records and free space
+ *
+ * @param scan Updated with the result
+ */
+static void scanSector(SectorScan &scan) {
+   for (unsigned &offset : scan.current) {
+      offset = SECTOR_WORDS;
+   }
+   unsigned offset = 0;
+   while (offset < SECTOR_WORDS) {
+      uint32_t tag = sector[offset];
+      if (tag == 0xFFFFFFFF) {
+         // Erased - start of free space
+         break;
+      }
+      unsigned id       = (tag>>16)&0xFF;
+      unsigned size     = tag&0xFF;
+      unsigned numWords = dataWords(size);
+      if (((tag>>24) != RECORD_MAGIC) || (size > FLASH_RECORD_MAX_SIZE) ||
+          ((offset+HEADER_WORDS+numWords) > SECTOR_WORDS)) {
+         // Damaged - nothing more can be appended until erased
+         offset = SECTOR_WORDS;
+         break;
+      }
+      if ((id < FLASH_RECORD_NUM_IDS) &&
+          (sector[offset+1] == checksum(tag, sector+offset+HEADER_WORDS, numWords))) {
+         scan.current[id] = offset;
+      }
+      offset += HEADER_WORDS+numWords;
+   }
+   scan.freeOffset = offset;
+}
+
+/**
+ * Launch flash command and wait for completion
+ *
+ * @note Runs from RAM as the flash can't be read while a command executes
+ */
+__attribute__((section(".data.flashRecordLaunch"), noinline, long_call))
+static void launchCommand() {
+   FTFA->FSTAT = FTFA_FSTAT_CCIF_MASK;
+   while ((FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK) == 0) {
+   }
+}
+
+/**
+ * Execute flash command already loaded in FCCOB
+ *
+ * @return BDM_RC_OK => Success, BDM_RC_FAIL otherwise
+ */
+static USBDM_ErrorCode executeFlashCommand() {
+   // Clear any existing errors
+   FTFA->FSTAT = FTFA_FSTAT_ACCERR_MASK|FTFA_FSTAT_FPVIOL_MASK;
+
+   // Interrupt handlers are in flash
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   launchCommand();
+   __set_PRIMASK(primask);
+
+   // Discard stale cache and prefetch contents
+   FMC->PFB0CR |= FMC_PFB0CR_CINV_WAY_MASK|FMC_PFB0CR_S_B_INV_MASK;
+
+   if ((FTFA->FSTAT & (FTFA_FSTAT_ACCERR_MASK|FTFA_FSTAT_FPVIOL_MASK|FTFA_FSTAT_MGSTAT0_MASK)) != 0) {
+      return BDM_RC_FAIL;
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Program word in sector
+ *
+ * @param offset Word offset in sector
+ * @param value  Value to program
+ */
+static USBDM_ErrorCode programWord(unsigned offset, uint32_t value) {
+   FTFA_FCCOB3_0 = (F_PGM4<<24)|(SECTOR_ADDRESS+offset*sizeof(uint32_t));
+   FTFA_FCCOB7_4 = value;
+   return executeFlashCommand();
+}
+
+/**
+ * Erase sector
+ */
+static USBDM_ErrorCode eraseSector() {
+   FTFA_FCCOB3_0 = (F_ERSSCR<<24)|SECTOR_ADDRESS;
+   return executeFlashCommand();
+}
+
+/**
+ * Erase sector keeping the current record of each id except one
+ *
+ * @param scan     Result of scanning sector - freeOffset is updated
+ * @param exclude  Id of record not kept
+ */
+static USBDM_ErrorCode eraseAndKeep(SectorScan &scan, unsigned exclude) {
+   static uint32_t kept[FLASH_RECORD_NUM_IDS*(HEADER_WORDS+dataWords(FLASH_RECORD_MAX_SIZE))];
+
+   unsigned keptWords = 0;
+   for (unsigned id=0; id<FLASH_RECORD_NUM_IDS; id++) {
+      unsigned offset = scan.current[id];
+      if ((id == exclude) || (offset >= SECTOR_WORDS)) {
+         continue;
+      }
+      unsigned numWords = HEADER_WORDS+dataWords(sector[offset]&0xFF);
+      memcpy(kept+keptWords, sector+offset, numWords*sizeof(uint32_t));
+      keptWords += numWords;
+   }
+   USBDM_ErrorCode rc = eraseSector();
+   for (unsigned offset=0; (rc == BDM_RC_OK) && (offset<keptWords); offset++) {
+      rc = programWord(offset, kept[offset]);
+   }
+   scan.freeOffset = keptWords;
+   return rc;
+}
+
+bool flashRecordRead(FlashRecordId id, uint8_t version, void *data, unsigned size) {
+   if (id >= FLASH_RECORD_NUM_IDS) {
+      return false;
+   }
+   SectorScan scan;
+   scanSector(scan);
+   unsigned offset = scan.current[id];
+   if (offset >= SECTOR_WORDS) {
+      return false;
+   }
+   uint32_t tag = sector[offset];
+   if ((((tag>>8)&0xFF) != version) || ((tag&0xFF) != size)) {
+      return false;
+   }
+   memcpy(data, sector+offset+HEADER_WORDS, size);
+   return true;
+}
+
+USBDM_ErrorCode flashRecordWrite(FlashRecordId id, uint8_t version, const void *data, unsigned size) {
+   if ((id >= FLASH_RECORD_NUM_IDS) || (size > FLASH_RECORD_MAX_SIZE)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   uint32_t words[dataWords(FLASH_RECORD_MAX_SIZE)] = {0};
+   memcpy(words, data, size);
+   unsigned numWords = dataWords(size);
+   uint32_t tag      = (RECORD_MAGIC<<24)|(id<<16)|(version<<8)|size;
+
+   SectorScan scan;
+   scanSector(scan);
+
+   // Avoid flash wear if unchanged
+   unsigned current = scan.current[id];
+   if ((current < SECTOR_WORDS) && (sector[current] == tag) &&
+       (memcmp(sector+current+HEADER_WORDS, words, numWords*sizeof(uint32_t)) == 0)) {
+      return BDM_RC_OK;
+   }
+   USBDM_ErrorCode rc = BDM_RC_OK;
+   if ((scan.freeOffset+HEADER_WORDS+numWords) > SECTOR_WORDS) {
+      rc = eraseAndKeep(scan, id);
+   }
+   // Tag, data then checksum
+   unsigned offset = scan.freeOffset;
+   if (rc == BDM_RC_OK) {
+      rc = programWord(offset, tag);
+   }
+   for (unsigned index=0; (rc == BDM_RC_OK) && (index<numWords); index++) {
+      rc = programWord(offset+HEADER_WORDS+index, words[index]);
+   }
+   if (rc == BDM_RC_OK) {
+      rc = programWord(offset+1, checksum(tag, words, numWords));
+   }
+   return rc;
+}
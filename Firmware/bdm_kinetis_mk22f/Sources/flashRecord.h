@@ -0,0 +1,75 @@
+/** \file
+    \brief Small non-volatile records kept in the probe's own flash
+
+   Records are appended to a flash sector reserved in the linker memory map.
+   The most recent record for an id is the current one.  When the sector
+   fills it is erased and the current record for each id is re-written.
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+
+#ifndef INCLUDE_FLASHRECORD_H_
+#define INCLUDE_FLASHRECORD_H_
+
+#include <stdint.h>
+#include "commands.h"
+
+/** Owner of a record */
+enum FlashRecordId {
+   FLASH_RECORD_BDM_SPEEDS = 1,  //!< BDM speed cache (Bdm::speedCache[])
+   FLASH_RECORD_SWD_SPEEDS = 2,  //!< SWD auto-tuned speed cache (Swd::speedCache[])
+   FLASH_RECORD_NUM_IDS,
+};
+
+/** Maximum size of record data (bytes) */
+static constexpr unsigned FLASH_RECORD_MAX_SIZE = 64;
+
+/**
+ *  Read current record
+ *
+ *  @param id       Owner of record
+ *  @param version  Layout version of record.  A record written with a different version is ignored.
+ *  @param data     Buffer for record data
+ *  @param size     Size of record data (must match size written)
+ *
+ *  @return true  => Record found and copied to data
+ *  @return false => No valid record (data is unchanged)
+ */
+bool flashRecordRead(FlashRecordId id, uint8_t version, void *data, unsigned size);
+
+/**
+ *  Write new record\n
+ *  Nothing is written if the data is unchanged from the current record
+ *
+ *  @param id       Owner of record
+ *  @param version  Layout version of record
+ *  @param data     Record data
+ *  @param size     Size of record data (<= FLASH_RECORD_MAX_SIZE)
+ *
+ *  @return
+ *   == \ref BDM_RC_OK => success         \n
+ *   != \ref BDM_RC_OK => various errors
+ *
+ *  @note Interrupts are masked while each flash command executes (a sector erase may take ~100 ms)
+ */
+USBDM_ErrorCode flashRecordWrite(FlashRecordId id, uint8_t version, const void *data, unsigned size);
+
+#endif /* INCLUDE_FLASHRECORD_H_ */
@@ -0,0 +1,274 @@
+/** \file
+    \brief ARM-SWD live-watch sampler
+
+   A list of target variables is sampled at a fixed period while the target runs.
+   The period is timed by PIT channel 0. The interrupt only marks a sample as due -
+   the SWD reads are done by watchPoll() while the command loop is idle so they
+   never interleave with command processing.
+   Records are queued in a ring buffer that is drained over a dedicated bulk IN end-point.
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+#include "hardware.h"
+#include "usb.h"
+#include "commands.h"
+#include "swd.h"
+#include "liveWatch.h"
+
+namespace Swd {
+
+/** PIT channel used to time samples */
+static constexpr unsigned WATCH_PIT_CHANNEL = 0;
+
+/** Size of record ring buffer (power of 2) */
+static constexpr unsigned WATCH_BUFFER_SIZE = 4096;
+
+/** Watched variable */
+struct WatchVariable {
+   uint32_t address;  //!< Target address
+   uint8_t  size;     //!< Size in bytes
+};
+
+/** Watched variables */
+static WatchVariable watchVariables[WATCH_MAX_VARIABLES];
+
+/** Number of watched variables */
+static unsigned watchCount;
+
+/** Total size of watched variables */
+static unsigned watchDataSize;
+
+/** Sampler is running */
+static bool watchRunning;
+
+/** Sample periods elapsed - incremented by PIT interrupt */
+static volatile uint32_t samplesDue;
+
+/** Sample periods that have been processed */
+static uint32_t samplesDone;
+
+/** Statistics */
+static uint32_t watchRecords;
+static uint32_t watchDropped;
+static uint32_t watchMissed;
+
+/** Record ring buffer - written by watchPoll(), read by USB interrupt */
+static uint8_t           ringBuffer[WATCH_BUFFER_SIZE];
+static volatile unsigned ringHead;  //!< Index of next byte to write
+static volatile unsigned ringTail;  //!< Index of next byte to read
+
+/**
+ * Handler for PIT channel 0 interrupt
+ */
+extern "C"
+void PIT0_IRQHandler() {
+   PIT->CHANNEL[WATCH_PIT_CHANNEL].TFLG = PIT_TFLG_TIF_MASK;
+   samplesDue = samplesDue + 1;
+}
+
+/**
+ *  Copy data from ring buffer to USB end-point buffer
+ *
+ *  @param buffer   End-point buffer
+ *  @param maxSize  Size of buffer
+ *
+ *  @return Number of bytes copied
+ *
+ *  @note Called from USB interrupt
+ */
+static unsigned drainRingBuffer(uint8_t *buffer, unsigned maxSize) {
+   unsigned head  = ringHead;
+   unsigned tail  = ringTail;
+   unsigned count = 0;
+   while ((tail != head) && (count < maxSize)) {
+      *buffer++ = ringBuffer[tail];
+      tail = (tail+1)&(WATCH_BUFFER_SIZE-1);
+      count++;
+   }
+   // Data must be copied out before the space is released to the sampler
+   __DMB();
+   ringTail = tail;
+   return count;
+}
+
+/**
+ *  Remove all watched variables\n
+ *  The sampler is stopped
+ */
+void watchClear() {
+   watchStop();
+   watchCount    = 0;
+   watchDataSize = 0;
+}
+
+/**
+ *  Add variable to watch list
+ *
+ *  @param address  Target address of variable
+ *  @param size     Size of variable in bytes
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode watchAdd(uint32_t address, unsigned size) {
+   if (watchRunning || (size == 0) ||
+       (watchCount >= WATCH_MAX_VARIABLES) ||
+       ((watchDataSize+size) > WATCH_MAX_RECORD_DATA)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   watchVariables[watchCount].address = address;
+   watchVariables[watchCount].size    = size;
+   watchCount++;
+   watchDataSize += size;
+   return BDM_RC_OK;
+}
+
+/**
+ *  Start periodic sampling of watched variables
+ *
+ *  @param periodUs Sample period in microseconds
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode watchStart(uint32_t periodUs) {
+   if ((watchCount == 0) || (periodUs < WATCH_MIN_PERIOD_US)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   watchStop();
+
+   ringHead     = 0;
+   ringTail     = 0;
+   watchRecords = 0;
+   watchDropped = 0;
+   watchMissed  = 0;
+   samplesDue   = 0;
+   samplesDone  = 0;
+
+   // Probe cycle counter is used for time-stamps
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+   USBDM::UsbImplementation::setWatchDataCallback(drainRingBuffer);
+
+   SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+   PIT->MCR    = PIT_MCR_FRZ_MASK;
+   PIT->CHANNEL[WATCH_PIT_CHANNEL].LDVAL = ((uint64_t)periodUs*SystemBusClock)/1000000-1;
+   PIT->CHANNEL[WATCH_PIT_CHANNEL].TFLG  = PIT_TFLG_TIF_MASK;
+   PIT->CHANNEL[WATCH_PIT_CHANNEL].TCTRL = PIT_TCTRL_TIE_MASK|PIT_TCTRL_TEN_MASK;
+   NVIC_EnableIRQ(PIT0_IRQn);
+
+   watchRunning = true;
+   return BDM_RC_OK;
+}
+
+/**
+ *  Stop periodic sampling
+ */
+void watchStop() {
+   if (!watchRunning) {
+      return;
+   }
+   PIT->CHANNEL[WATCH_PIT_CHANNEL].TCTRL = 0;
+   NVIC_DisableIRQ(PIT0_IRQn);
+   watchRunning = false;
+}
+
+/**
+ *  Get status of sampler
+ *
+ *  @param status Status information
+ */
+void watchGetStatus(WatchStatus &status) {
+   status.records    = watchRecords;
+   status.dropped    = watchDropped;
+   status.missed     = watchMissed;
+   status.recordSize = 4+watchDataSize;
+   status.running    = watchRunning;
+}
+
+/**
+ *  Sample all watched variables into a record in the ring buffer
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+static USBDM_ErrorCode takeSample() {
+   static uint8_t record[4+WATCH_MAX_RECORD_DATA];
+
+   unpack32BE(DWT->CYCCNT, record);
+   uint8_t *data = record+4;
+   for (unsigned index=0; index<watchCount; index++) {
+      unsigned size = watchVariables[index].size;
+      uint32_t elementSize;
+      switch (size) {
+         case 2:  elementSize = MS_Word; break;
+         case 4:  elementSize = MS_Long; break;
+         default: elementSize = MS_Byte; break;
+      }
+      if ((watchVariables[index].address&(elementSize-1)) != 0) {
+         elementSize = MS_Byte;
+      }
+      USBDM_ErrorCode rc = readMemory(elementSize, size, watchVariables[index].address, data);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      data += size;
+   }
+   unsigned recordSize = data-record;
+   unsigned head       = ringHead;
+   unsigned space      = (ringTail-head-1)&(WATCH_BUFFER_SIZE-1);
+   if (recordSize > space) {
+      // Discard whole record so the host stays synchronised
+      watchDropped++;
+      return BDM_RC_OK;
+   }
+   for (unsigned index=0; index<recordSize; index++) {
+      ringBuffer[head] = record[index];
+      head = (head+1)&(WATCH_BUFFER_SIZE-1);
+   }
+   // Record must be visible before the new head is published to the USB interrupt
+   __DMB();
+   ringHead = head;
+   watchRecords++;
+   return BDM_RC_OK;
+}
+
+/**
+ *  Take any samples that are due\n
+ *  Called while the probe is waiting for commands
+ */
+void watchPoll() {
+   if (!watchRunning) {
+      return;
+   }
+   uint32_t due = samplesDue;
+   if (due == samplesDone) {
+      return;
+   }
+   // Only one sample is taken however many periods have elapsed
+   watchMissed += due-samplesDone-1;
+   samplesDone  = due;
+   if (takeSample() != BDM_RC_OK) {
+      // Target has gone away
+      watchStop();
+   }
+   USBDM::UsbImplementation::startWatchIn();
+}
+
+}; // End namespace Swd
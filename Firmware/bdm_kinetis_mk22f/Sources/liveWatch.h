@@ -0,0 +1,102 @@
+/** \file
+    \brief ARM-SWD live-watch sampler
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+
+#ifndef INCLUDE_LIVEWATCH_H_
+#define INCLUDE_LIVEWATCH_H_
+
+#include <stdint.h>
+#include "commands.h"
+
+namespace Swd {
+
+/** Maximum number of watched variables */
+static constexpr unsigned WATCH_MAX_VARIABLES = 32;
+
+/** Maximum total size of watched variables in bytes */
+static constexpr unsigned WATCH_MAX_RECORD_DATA = 128;
+
+/** Minimum sample period in microseconds */
+static constexpr unsigned WATCH_MIN_PERIOD_US = 100;
+
+/** Status of live-watch sampler */
+struct WatchStatus {
+   uint32_t records;     //!< Number of records sampled
+   uint32_t dropped;     //!< Number of records discarded as buffer was full
+   uint32_t missed;      //!< Number of sample periods missed as probe was busy
+   uint16_t recordSize;  //!< Size of each record in bytes (including time-stamp)
+   bool     running;     //!< Sampler is running
+};
+
+/**
+ *  Remove all watched variables\n
+ *  The sampler is stopped
+ */
+void watchClear();
+
+/**
+ *  Add variable to watch list
+ *
+ *  @param address  Target address of variable
+ *  @param size     Size of variable in bytes (1, 2 or 4 are read as a single access)
+ *
+ *  @return
+ *   == \ref BDM_RC_OK             => success         \n
+ *   == \ref BDM_RC_ILLEGAL_PARAMS => Too many variables or sampler running
+ */
+USBDM_ErrorCode watchAdd(uint32_t address, unsigned size);
+
+/**
+ *  Start periodic sampling of watched variables
+ *
+ *  @param periodUs Sample period in microseconds
+ *
+ *  @return
+ *   == \ref BDM_RC_OK             => success         \n
+ *   == \ref BDM_RC_ILLEGAL_PARAMS => No variables or period too short
+ *
+ *  @note Each record is [0..3] 32-bit time-stamp (probe clock cycles, BIG-ENDIAN), [4..N] variable data in target byte order
+ */
+USBDM_ErrorCode watchStart(uint32_t periodUs);
+
+/**
+ *  Stop periodic sampling
+ */
+void watchStop();
+
+/**
+ *  Get status of sampler
+ *
+ *  @param status Status information
+ */
+void watchGetStatus(WatchStatus &status);
+
+/**
+ *  Take any samples that are due\n
+ *  Called while the probe is waiting for commands
+ */
+void watchPoll();
+
+}; // End namespace Swd
+
+#endif /* INCLUDE_LIVEWATCH_H_ */
@@ -99,7 +99,7 @@ USBDM_ErrorCode testmem(uint32_t addressStart, uint32_t addrRange) {
 //   CHECK(Swd::powerUp());
    PRINTF("Connected\n");
 
-   uint8_t randomData[sizeof(commandBuffer)];
+   uint8_t randomData[COMMAND_BUFFER_SIZE];
    for (unsigned i=0; i<sizeof(randomData);i++) {
       randomData[i] = rand();
    }
@@ -107,7 +107,7 @@ USBDM_ErrorCode testmem(uint32_t addressStart, uint32_t addrRange) {
       static const uint8_t sizes[] = {1,2,4};
       int sizeIndex    = rand()%3;
       uint8_t  opSize  = sizes[sizeIndex];
-      uint8_t  size    = rand()%(sizeof(commandBuffer)-20)+1;
+      uint8_t  size    = rand()%(COMMAND_BUFFER_SIZE-20)+1;
       uint32_t address = addressStart+rand()%(addrRange-size);
 
       uint32_t mask = ~((1<<sizeIndex)-1);
@@ -123,7 +123,7 @@ USBDM_ErrorCode testmem(uint32_t addressStart, uint32_t addrRange) {
       memcpy(commandBuffer+sizeof(operation), randomData, size);
       CHECK(f_CMD_WRITE_MEM());
 
-      memset(commandBuffer, 0, sizeof(commandBuffer));
+      memset(commandBuffer, 0, COMMAND_BUFFER_SIZE);
       memcpy(commandBuffer, operation, sizeof(operation));
       CHECK(f_CMD_READ_MEM());
 
@@ -197,7 +197,7 @@ USBDM_ErrorCode testmem() {
    CHECK(Swd::powerUp());
    PRINTF("Connected\n");
 
-   uint8_t randomData[sizeof(commandBuffer)];
+   uint8_t randomData[COMMAND_BUFFER_SIZE];
    for (unsigned i=0; i<sizeof(randomData);i++) {
       randomData[i] = rand();
    }
@@ -206,7 +206,7 @@ USBDM_ErrorCode testmem() {
       int sizeIndex    = rand()%3;
       uint8_t  opSize  = sizes[sizeIndex];
       uint32_t address = 0x20000000+rand()%10000;
-      uint8_t  size    = rand()%(sizeof(commandBuffer)-20)+1;
+      uint8_t  size    = rand()%(COMMAND_BUFFER_SIZE-20)+1;
 
       uint32_t mask = ~((1<<sizeIndex)-1);
       address = address & mask;
@@ -221,7 +221,7 @@ USBDM_ErrorCode testmem() {
       memcpy(commandBuffer+sizeof(operation), randomData, size);
       CHECK(Swd::f_CMD_WRITE_MEM());
 
-      memset(commandBuffer, 0, sizeof(commandBuffer));
+      memset(commandBuffer, 0, COMMAND_BUFFER_SIZE);
       memcpy(commandBuffer, operation, sizeof(operation));
       CHECK(Swd::f_CMD_READ_MEM());
 
@@ -36,6 +36,7 @@
 #include "commands.h"
 #include "targetDefines.h"
 #include "configure.h"
+#include "flashRecord.h"
 
 namespace Swd {
 
@@ -74,6 +75,7 @@ static constexpr uint32_t  SWD_DP_ABORT_ABORT_AP            = 0x00000001;
 // Masks for SWD_WR_DP_CONTROL
 static constexpr uint32_t  SWD_WR_DP_CONTROL_POWER_REQ = (1<<30)|(1<<28);
 static constexpr uint32_t  SWD_WR_DP_CONTROL_POWER_ACK = (1<<31)|(1<<29);
+static constexpr uint32_t  SWD_WR_DP_CONTROL_ORUNDETECT = (1<<0);
 
 // AP number for AHB-AP (MEM-AP implementation)
 static constexpr uint32_t  AHB_AP_NUM        = (0x0);
@@ -81,26 +83,34 @@ static constexpr uint32_t  AHB_AP_NUM        = (0x0);
 // DP_SELECT register value to access AHB_AP Bank #0 for memory read/write
 static constexpr uint32_t ARM_AHB_AP_BANK0 = AHB_AP_NUM;
 
+// DP_SELECT register value to access AHB_AP Bank #1 (BD0-BD3 banked data registers)
+static constexpr uint32_t ARM_AHB_AP_BANK1 = AHB_AP_NUM|(0x1<<4);
+
 //   static constexpr uint32_t  AHB_CSW_REGNUM    = (0x0);  // CSW register bank+register number
 //   static constexpr uint32_t  AHB_TAR_REGNUM    = (0x4);  // TAR register bank+register number
 //   static constexpr uint32_t  AHB_DRW_REGNUM    = (0xC);  // DRW register bank+register number
 
 static constexpr uint32_t  SWD_RD_AHB_CSW = SWD_RD_AP_REG0; // SWD command for reading AHB-CSW
-//static constexpr uint32_t  SWD_RD_AHB_TAR = SWD_RD_AP_REG1; // SWD command for reading AHB-TAR
+static constexpr uint32_t  SWD_RD_AHB_TAR = SWD_RD_AP_REG1; // SWD command for reading AHB-TAR
 static constexpr uint32_t  SWD_RD_AHB_DRW = SWD_RD_AP_REG3; // SWD command for reading AHB-DRW
 
 static constexpr uint32_t  SWD_WR_AHB_CSW = SWD_WR_AP_REG0; // SWD command for writing AHB-CSW
 static constexpr uint32_t  SWD_WR_AHB_TAR = SWD_WR_AP_REG1; // SWD command for writing AHB-TAR
 static constexpr uint32_t  SWD_WR_AHB_DRW = SWD_WR_AP_REG3; // SWD command for writing AHB-DRW
 
+// With TAR=DHCSR_ADDR and Bank #1 selected the banked data registers map to the debug registers
+static constexpr uint32_t  SWD_RD_AHB_BD_DHCSR = SWD_RD_AP_REG0; // SWD command for reading DHCSR via AHB-BD0
+static constexpr uint32_t  SWD_WR_AHB_BD_DCRSR = SWD_WR_AP_REG1; // SWD command for writing DCRSR via AHB-BD1
+static constexpr uint32_t  SWD_RD_AHB_BD_DCRDR = SWD_RD_AP_REG2; // SWD command for reading DCRDR via AHB-BD2
+
 // AHB-AP (MEM-AP) CSW Register masks
 static constexpr uint32_t  AHB_AP_CSW_INC_SINGLE    = (1<<4);
 //static constexpr uint32_t  AHB_AP_CSW_INC_PACKED    = (2<<4);
-//static constexpr uint32_t  AHB_AP_CSW_INC_MASK      = (3<<4);
+static constexpr uint32_t  AHB_AP_CSW_INC_MASK      = (3<<4);
 static constexpr uint32_t  AHB_AP_CSW_SIZE_BYTE     = (0<<0);
 static constexpr uint32_t  AHB_AP_CSW_SIZE_HALFWORD = (1<<0);
 static constexpr uint32_t  AHB_AP_CSW_SIZE_WORD     = (2<<0);
-//static constexpr uint32_t  AHB_AP_CSW_SIZE_MASK     = (7<<0);
+static constexpr uint32_t  AHB_AP_CSW_SIZE_MASK     = (7<<0);
 
 static constexpr uint32_t cswValues[5] = {
       0,
@@ -171,6 +181,100 @@ static uint32_t spiBaudValue;
 /** Initial value of AHB_SP_CSW register read from target */
 static uint32_t ahb_ap_csw_defaultValue;
 
+/** Number of entries in SPI transmit and receive FIFOs */
+static constexpr unsigned SPI_FIFO_DEPTH = 4;
+
+/** SWD clocks used by each pipelined read [TRN, command] + [TRN, ACK, 32-bit data, parity] */
+static constexpr unsigned BLOCK_READ_CLOCKS = 9+37;
+
+/** Accumulated statistics for pipelined block reads */
+static BlockReadStatistics blockReadStatistics;
+
+/** SWD clocks for [command, TRN, ACK] of a read (TRN before data is included in data phase) */
+static constexpr unsigned READ_REQUEST_CLOCKS  = 8+1+3;
+/** SWD clocks for [command, TRN, ACK, TRN] of a write */
+static constexpr unsigned WRITE_REQUEST_CLOCKS = 8+1+3+1;
+/** SWD clocks for [32-bit data, parity] */
+static constexpr unsigned DATA_CLOCKS          = 32+1;
+/** SWD clocks for the idle bits following each transaction */
+static constexpr unsigned IDLE_CLOCKS          = 8;
+
+// SPI.PUSHR writes made by each low-level routine (tallied from the code, not measured)
+/** txCommand_rxAck(), txCommand_rxAck_Trn(), txMark_8_rxAck() and txMark_8_rxAck_Trn() */
+static constexpr unsigned REQUEST_PUSHRS = 2;
+/** rx32_parity() and tx32_parity() */
+static constexpr unsigned DATA_PUSHRS    = 4;
+/** txIdle8() */
+static constexpr unsigned IDLE_PUSHRS    = 1;
+
+/** Accumulated statistics for register transactions */
+static TransactionStatistics transactionStatistics;
+
+/** Candidate SWD clock frequencies for auto-tuning (fastest first) */
+static constexpr uint32_t autoSpeeds[] = {
+      30000000, 24000000, 20000000, 15000000, 12000000, 10000000, 7500000,
+       6000000,  4000000,  3000000,  2000000,  1000000,   500000,  250000,
+};
+
+/** Index of speed in autoSpeeds[] used to obtain IDCODE before auto-tuning */
+static constexpr int SAFE_SPEED_INDEX = 11;
+
+/** Number of times verification is repeated at each candidate speed */
+static constexpr unsigned AUTOTUNE_PASSES = 4;
+
+/** Number of consecutive parity errors before an auto-tuned speed is reduced */
+static constexpr unsigned PARITY_ERROR_LIMIT = 3;
+
+/** Number of targets remembered in speed cache */
+static constexpr unsigned SPEED_CACHE_SIZE = 4;
+
+/** Auto-tuned speed for a target */
+struct SpeedCacheEntry {
+   uint32_t idcode;     //!< DP IDCODE identifying target
+   int      speedIndex; //!< Index into autoSpeeds[], -1 => unused entry
+};
+
+/** Layout version of speed cache record in flash */
+static constexpr uint8_t SPEED_CACHE_VERSION = 1;
+
+/** Auto-tuned speeds for recently used targets (saved to flash) */
+static SpeedCacheEntry speedCache[SPEED_CACHE_SIZE] = {
+      {0, -1}, {0, -1}, {0, -1}, {0, -1},
+};
+
+/** Next entry in speedCache[] to replace */
+static unsigned speedCacheNext = 0;
+
+/** Index into autoSpeeds[] of current speed, -1 => speed set manually */
+static int autoSpeedIndex = -1;
+
+/** Number of consecutive parity errors */
+static unsigned consecutiveParityErrors = 0;
+
+/** DP IDCODE obtained on last connect */
+static uint32_t targetIdcode = 0;
+
+/** AHB-AP.TAR auto-increment is only guaranteed within a block of this size */
+static constexpr uint32_t TAR_WRAP_SIZE = 0x400;
+
+/** Last value written to DP.SELECT */
+static uint32_t cachedSelect;
+
+/** Last value written to AHB-AP.CSW */
+static uint32_t cachedCsw;
+
+/** Current value of AHB-AP.TAR including auto-increment */
+static uint32_t cachedTar;
+
+/** Indicates cachedSelect reflects the target */
+static bool cachedSelectValid = false;
+
+/** Indicates cachedCsw reflects the target */
+static bool cachedCswValid = false;
+
+/** Indicates cachedTar reflects the target */
+static bool cachedTarValid = false;
+
 /**
  * Set SPI.CTAR0 value\n
  * Value will be combined with the current frequency divider
@@ -193,6 +297,88 @@ static void setCTAR1Value(uint32_t ctar) {
    spi->CTAR[1] = spiBaudValue|(ctar&CTAR_MASK);
 }
 
+/**
+ * Invalidate cached DP.SELECT, AHB-AP.CSW and AHB-AP.TAR values\n
+ * These registers will be re-written on next use
+ */
+void invalidateCachedState() {
+   cachedSelectValid = false;
+   cachedCswValid    = false;
+   cachedTarValid    = false;
+}
+
+/**
+ * Update cached AHB-AP.TAR to reflect accesses to AHB-AP.DRW
+ *
+ * @param accesses Number of DRW accesses
+ */
+static void advanceCachedTar(unsigned accesses) {
+   if (!cachedCswValid) {
+      cachedTarValid = false;
+      return;
+   }
+   if ((cachedCsw&AHB_AP_CSW_INC_MASK) == 0) {
+      // No auto-increment
+      return;
+   }
+   uint32_t newTar = cachedTar + (accesses<<(cachedCsw&AHB_AP_CSW_SIZE_MASK));
+   if (((newTar^cachedTar)&~(TAR_WRAP_SIZE-1)) != 0) {
+      // Increment crosses wrap boundary - resulting TAR value is implementation defined
+      cachedTarValid = false;
+   }
+   cachedTar = newTar;
+}
+
+/**
+ * Update cached DP/AP state to reflect a successful register access
+ *
+ * @param command SWD command byte
+ * @param data    Value written (ignored for reads)
+ */
+static void updateCachedState(uint8_t command, uint32_t data) {
+   if (command == SWD_WR_DP_SELECT) {
+      cachedSelect      = data;
+      cachedSelectValid = true;
+      return;
+   }
+   if ((command == SWD_WR_DP_ABORT) && (data & SWD_DP_ABORT_ABORT_AP)) {
+      // Aborted transfer may leave TAR in any state
+      cachedTarValid = false;
+      return;
+   }
+   if ((command & 0x02) == 0) {
+      // Other DP accesses don't affect cached values
+      return;
+   }
+   if (!cachedSelectValid) {
+      // Unknown AP/bank - may be AHB-AP
+      cachedCswValid = false;
+      cachedTarValid = false;
+      return;
+   }
+   if (cachedSelect != ARM_AHB_AP_BANK0) {
+      return;
+   }
+   switch(command) {
+      case SWD_WR_AHB_CSW:
+         cachedCsw      = data;
+         cachedCswValid = true;
+         break;
+      case SWD_WR_AHB_TAR:
+         cachedTar      = data;
+         cachedTarValid = true;
+         break;
+      case SWD_WR_AHB_DRW:
+      case SWD_RD_AHB_DRW:
+         if (cachedTarValid) {
+            advanceCachedTar(1);
+         }
+         break;
+      default:
+         break;
+   }
+}
+
 /**
  * Calculate parity of a 32-bit value
  *
@@ -430,10 +616,83 @@ static USBDM_ErrorCode rx32_parity(uint32_t &receive) {
  * Note: Chooses the highest speed that is not greater than frequency.
  */
 USBDM_ErrorCode setSpeed(uint32_t frequency) {
+   autoSpeedIndex = -1;
    spiBaudValue = USBDM::Spi::calculateDividers(SpiInfo::getClockFrequency(), frequency);
    return BDM_RC_OK;
 }
 
+/**
+ * Set communication speed from auto-tune table
+ *
+ * @param index Index into autoSpeeds[]
+ */
+static void setAutoSpeed(int index) {
+   autoSpeedIndex = index;
+   spiBaudValue   = USBDM::Spi::calculateDividers(SpiInfo::getClockFrequency(), autoSpeeds[index]);
+}
+
+/**
+ * Find entry in speed cache
+ *
+ * @param idcode DP IDCODE of target
+ *
+ * @return Pointer to entry or nullptr if not found
+ */
+static SpeedCacheEntry *findSpeedCacheEntry(uint32_t idcode) {
+   for (SpeedCacheEntry &entry : speedCache) {
+      if ((entry.idcode == idcode) && (entry.speedIndex >= 0)) {
+         return &entry;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ * Record auto-tuned speed for target in speed cache\n
+ * The least recently updated entry is replaced if the target is not already present
+ *
+ * @param idcode DP IDCODE of target
+ * @param index  Index into autoSpeeds[]
+ */
+static void updateSpeedCache(uint32_t idcode, int index) {
+   SpeedCacheEntry *entry = findSpeedCacheEntry(idcode);
+   if (entry == nullptr) {
+      entry = &speedCache[speedCacheNext];
+      speedCacheNext = (speedCacheNext+1)%SPEED_CACHE_SIZE;
+   }
+   entry->idcode     = idcode;
+   entry->speedIndex = index;
+   // Only written if changed
+   (void)flashRecordWrite(FLASH_RECORD_SWD_SPEEDS, SPEED_CACHE_VERSION, speedCache, sizeof(speedCache));
+}
+
+/**
+ * Use cached speed for the connected target if auto-tuning is in effect
+ */
+static void applySpeedCache() {
+   if (autoSpeedIndex < 0) {
+      // Speed set manually
+      return;
+   }
+   SpeedCacheEntry *entry = findSpeedCacheEntry(targetIdcode);
+   if ((entry != nullptr) && (entry->speedIndex != autoSpeedIndex)) {
+      setAutoSpeed(entry->speedIndex);
+   }
+}
+
+/**
+ * Step down auto-tuned speed after repeated parity errors
+ */
+static void reduceAutoSpeed() {
+   consecutiveParityErrors = 0;
+   if ((autoSpeedIndex < 0) || (autoSpeedIndex >= (int)(sizeof(autoSpeeds)/sizeof(autoSpeeds[0]))-1)) {
+      // Manual speed or already at slowest speed
+      return;
+   }
+   setAutoSpeed(autoSpeedIndex+1);
+   updateSpeedCache(targetIdcode, autoSpeedIndex);
+}
+
 /**
  * Gets Communication speed of SWD
  *
@@ -460,6 +719,9 @@ void initialise() {
 
    setSpeed(15000000);
 
+   // Restore auto-tuned speeds from previous sessions
+   (void)flashRecordRead(FLASH_RECORD_SWD_SPEEDS, SPEED_CACHE_VERSION, speedCache, sizeof(speedCache));
+
    ResetInterface::initialise();
    ResetInterface::highZ();
 
@@ -577,19 +839,36 @@ static USBDM_ErrorCode update_ahb_ap_csw_defaultValue() {
  *   - 8-bit idle
  *   - Read IDCODE
  *
+ *  If the speed is auto-tuned, a speed remembered for the target's IDCODE is then adopted.
+ *  A connection that fails above the safe speed is retried at the safe speed first.
+ *
  *  @return BDM_RC_OK => Success
  */
 USBDM_ErrorCode connect(void) {
+   transactionStatistics.reconnects++;
    ahb_ap_csw_defaultValue = 0;
+   invalidateCachedState();
 
-   tx32(0xFFFFFFFF);  // 32 1's
-   tx32(0x79EFFFFF);  // 20 1's + 0x79E
-   tx32(0xFFFFFFFE);  // 0xE + 28 1's
-   tx32(0x00FFFFFF);  // 24 1's + 8 0's
+   USBDM_ErrorCode rc;
+   do {
+      tx32(0xFFFFFFFF);  // 32 1's
+      tx32(0x79EFFFFF);  // 20 1's + 0x79E
+      tx32(0xFFFFFFFE);  // 0xE + 28 1's
+      tx32(0x00FFFFFF);  // 24 1's + 8 0's
+
+      // Target must respond to read IDCODE immediately
+      rc = readReg(SWD_RD_DP_IDCODE, targetIdcode);
+      if ((rc == BDM_RC_OK) || (autoSpeedIndex < 0) || (autoSpeedIndex >= SAFE_SPEED_INDEX)) {
+         break;
+      }
+      // May be a different (slower) target
+      setAutoSpeed(SAFE_SPEED_INDEX);
+   } while (true);
 
-   // Target must respond to read IDCODE immediately
-   uint32_t buff;
-   return readReg(SWD_RD_DP_IDCODE, buff);
+   if (rc == BDM_RC_OK) {
+      applySpeedCache();
+   }
+   return rc;
 }
 
 /**
@@ -625,6 +904,8 @@ USBDM_ErrorCode powerUp() {
  *  @return BDM_RC_OK => Success, error otherwise
  */
 USBDM_ErrorCode lineReset(void) {
+   invalidateCachedState();
+
    tx32(0xFFFFFFFF);  // 32 1's
    tx32(0x007FFFFF);  // 23 1's, 9 0's
 
@@ -656,30 +937,58 @@ USBDM_ErrorCode readReg(uint8_t command, uint32_t &data) {
    int retry  = 2000;      // Set up retry count
    USBDM_ErrorCode rc;
 
+   transactionStatistics.reads++;
+   transactionStatistics.swdClocks   += READ_REQUEST_CLOCKS;
+   transactionStatistics.pushrWrites += REQUEST_PUSHRS;
+
    // Transmit command + Receive ACK (1st attempt)
    SwdAck ack = txCommand_rxAck(command);
    do {
       if (ack == SWD_ACK_OK) {
          rc = rx32_parity(data);
+         transactionStatistics.swdClocks   += DATA_CLOCKS;
+         transactionStatistics.pushrWrites += DATA_PUSHRS;
+         if (rc == BDM_RC_ARM_PARITY_ERROR) {
+            transactionStatistics.parityErrors++;
+            if (++consecutiveParityErrors >= PARITY_ERROR_LIMIT) {
+               reduceAutoSpeed();
+            }
+         }
+         else {
+            consecutiveParityErrors = 0;
+         }
       }
       else if (ack == SWD_ACK_WAIT) {
+         transactionStatistics.waits++;
          if (retry-- > 0) {
             // 1 clock turn-around on WAIT + retry
             // Turn-around + Transmit command (retry) + Receive ACK
             ack = txMark_8_rxAck(command);
+            transactionStatistics.swdClocks   += 1+READ_REQUEST_CLOCKS;
+            transactionStatistics.pushrWrites += REQUEST_PUSHRS;
             continue;
          }
          rc = BDM_RC_ACK_TIMEOUT;
       }
       else if (ack == SWD_ACK_FAULT) {
+         transactionStatistics.faults++;
          rc = BDM_RC_ARM_FAULT_ERROR;
       }
       else {
+         transactionStatistics.noResponses++;
          rc = BDM_RC_NO_CONNECTION;
       }
       break;
    } while (true);
    txIdle8();
+   transactionStatistics.swdClocks   += IDLE_CLOCKS;
+   transactionStatistics.pushrWrites += IDLE_PUSHRS;
+   if (rc == BDM_RC_OK) {
+      updateCachedState(command, 0);
+   }
+   else {
+      invalidateCachedState();
+   }
    return rc;
 }
 
@@ -702,34 +1011,111 @@ USBDM_ErrorCode readReg(uint8_t command, uint32_t &data) {
  */
 USBDM_ErrorCode writeReg(uint8_t command, const uint32_t data) {
    int retry = 2000;            // Set up retry count
+
+   transactionStatistics.writes++;
+   transactionStatistics.swdClocks   += WRITE_REQUEST_CLOCKS;
+   transactionStatistics.pushrWrites += REQUEST_PUSHRS;
+
    SwdAck ack = txCommand_rxAck_Trn(command); // Transmit command & get ACK (1st attempt)
    USBDM_ErrorCode rc;
    do {
       if (ack == SWD_ACK_OK) {
          tx32_parity(data);
+         transactionStatistics.swdClocks   += DATA_CLOCKS;
+         transactionStatistics.pushrWrites += DATA_PUSHRS;
          rc = BDM_RC_OK;
       }
       else if (ack == SWD_ACK_WAIT) {
+         transactionStatistics.waits++;
          if (retry-- > 0) {
             // 1 clock turn-around on WAIT + retry
             // Turn-around + Transmit command (retry) + rx ACK
             ack = txMark_8_rxAck_Trn(command);
+            transactionStatistics.swdClocks   += 1+WRITE_REQUEST_CLOCKS;
+            transactionStatistics.pushrWrites += REQUEST_PUSHRS;
             continue;
          }
          rc = BDM_RC_ACK_TIMEOUT;
       }
       else if (ack == SWD_ACK_FAULT) {
+         transactionStatistics.faults++;
          rc = BDM_RC_ARM_FAULT_ERROR;
       }
       else {
+         transactionStatistics.noResponses++;
          rc = BDM_RC_NO_CONNECTION;
       }
       break;
    } while (true);
    txIdle8();
+   transactionStatistics.swdClocks   += IDLE_CLOCKS;
+   transactionStatistics.pushrWrites += IDLE_PUSHRS;
+   if (rc == BDM_RC_OK) {
+      updateCachedState(command, data);
+   }
+   else {
+      invalidateCachedState();
+   }
    return rc;
 }
 
+/**
+ * Get statistics for individual register transactions
+ *
+ * @param statistics Accumulated statistics
+ * @param clear      Clear statistics after obtaining them
+ */
+void getTransactionStatistics(TransactionStatistics &statistics, bool clear) {
+   statistics = transactionStatistics;
+   if (clear) {
+      transactionStatistics = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+   }
+}
+
+/**
+ *  Write DP.SELECT unless it already has the given value
+ *
+ *  @param select Value for DP.SELECT
+ *
+ *  @return BDM_RC_OK => Success, error otherwise
+ */
+static USBDM_ErrorCode writeSelect(uint32_t select) {
+   if (cachedSelectValid && (cachedSelect == select)) {
+      return BDM_RC_OK;
+   }
+   return writeReg(SWD_WR_DP_SELECT, select);
+}
+
+/**
+ *  Write AHB-AP.CSW unless it already has the given value
+ *  Assumes DP.SELECT has been set for AHB-AP bank 0
+ *
+ *  @param csw Value for AHB-AP.CSW
+ *
+ *  @return BDM_RC_OK => Success, error otherwise
+ */
+static USBDM_ErrorCode writeCsw(uint32_t csw) {
+   if (cachedCswValid && (cachedCsw == csw)) {
+      return BDM_RC_OK;
+   }
+   return writeReg(SWD_WR_AHB_CSW, csw);
+}
+
+/**
+ *  Write AHB-AP.TAR unless it already has the given value (including auto-increment)
+ *  Assumes DP.SELECT has been set for AHB-AP bank 0
+ *
+ *  @param address Value for AHB-AP.TAR
+ *
+ *  @return BDM_RC_OK => Success, error otherwise
+ */
+static USBDM_ErrorCode writeTar(uint32_t address) {
+   if (cachedTarValid && (cachedTar == address)) {
+      return BDM_RC_OK;
+   }
+   return writeReg(SWD_WR_AHB_TAR, address);
+}
+
 /**
  *  Read register of Access Port
  *
@@ -750,7 +1136,7 @@ USBDM_ErrorCode readAPReg(const uint32_t address, uint32_t &buff) {
    uint32_t selectData = address&0xFF0000F0;
 
    // Set up SELECT register for AP access
-   rc = writeReg(SWD_WR_DP_SELECT, selectData);
+   rc = writeSelect(selectData);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -783,7 +1169,7 @@ USBDM_ErrorCode writeAPReg(const uint32_t address, const uint32_t data) {
    uint32_t selectData = address&0xFF0000F0;
 
    // Set up SELECT register for AP access
-   rc = writeReg(SWD_WR_DP_SELECT, selectData);
+   rc = writeSelect(selectData);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -811,109 +1197,536 @@ USBDM_ErrorCode clearStickyBits(void) {
  *  @return error code
  */
 USBDM_ErrorCode abortAP(void) {
+   invalidateCachedState();
    return writeReg(SWD_WR_DP_ABORT, SWD_DP_ABORT_CLEAR_STICKY_ERRORS|SWD_DP_ABORT_ABORT_AP);
 }
 
-static constexpr uint32_t  MDM_AP_STATUS                     = 0x01000000;
-static constexpr uint32_t  MDM_AP_CONTROL                    = 0x01000004;
-//static constexpr uint32_t  MDM_AP_IDR                        = 0x010000FC;
-
-static constexpr uint32_t  MDM_AP_CONTROL_MASS_ERASE_REQUEST = (1<<0);
-//static constexpr uint32_t  MDM_AP_CONTROL_DEBUG_REQUEST      = (1<<2);
-static constexpr uint32_t  MDM_AP_CONTROL_RESET_REQUEST      = (1<<3);
-//static constexpr uint32_t  MDM_AP_CONTROL_VLLDBGREQ          = (1<<5);
-//static constexpr uint32_t  MDM_AP_CONTROL_VLLDBGACK          = (1<<6);
-//static constexpr uint32_t  MDM_AP_CONTROL_LLS_VLLSx_ACK      = (1<<7);
-
-//static constexpr uint32_t  MDM_AP_STATUS_FLASH_READY         = (1<<1);
-static constexpr uint32_t  MDM_AP_STATUS_SECURE              = (1<<2);
-static constexpr uint32_t  MDM_AP_STATUS_MASS_ERASE_ENABLE   = (1<<5);
-
-static constexpr uint32_t  ATTEMPT_MULTIPLE                  = 100;  // How many times to attemp mass erase
-static constexpr uint32_t  ERASE_MULTIPLE                    = 2;    // How many times to mass erase
-
 /**
- * Mass erase target
+ * Verify communication with target at current speed
  *
- * @return BDM_RC_OK if successful
+ *  - Line reset and check IDCODE matches target
+ *  - Write and read back patterns using AHB-AP.TAR (does not affect target memory)
+ *
+ * @return BDM_RC_OK => Success, error otherwise
  */
-USBDM_ErrorCode kinetisMassErase(void) {
-   unsigned successCount = 0;
-   unsigned attemptCount = 0;
-   uint8_t rc;
-   uint32_t valueRead;
+static USBDM_ErrorCode verifySpeed() {
+   static constexpr uint32_t patterns[] = {
+         0xAAAAAAA8, 0x55555554, 0xFFFFFFFC, 0x00000000, 0xCCCCCCCC, 0x33333330,
+   };
+   USBDM_ErrorCode rc;
+   uint32_t value;
 
-   ResetInterface::low();
-   for (;;) {
-      UsbLed::on();
-      if (attemptCount++>ATTEMPT_MULTIPLE) {
-         break;
-      }
-      // Do connect sequence
-      rc = connect();
+   rc = lineReset();
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = readReg(SWD_RD_DP_IDCODE, value);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   if (value != targetIdcode) {
+      return BDM_RC_FAIL;
+   }
+   rc = clearStickyBits();
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = writeSelect(ARM_AHB_AP_BANK0);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   for (uint32_t pattern : patterns) {
+      rc = writeReg(SWD_WR_AHB_TAR, pattern);
       if (rc != BDM_RC_OK) {
-         continue;
+         return rc;
       }
-      rc = clearStickyBits();
+      // Posted read - dummy data returned
+      rc = readReg(SWD_RD_AHB_TAR, value);
       if (rc != BDM_RC_OK) {
-         continue;
+         return rc;
       }
-      // Power up Debug interface
-      rc = powerUp();
+      rc = readReg(SWD_RD_DP_RDBUFF, value);
       if (rc != BDM_RC_OK) {
-         continue;
+         return rc;
       }
-      // Do mass erase
-      rc = writeAPReg(MDM_AP_CONTROL, MDM_AP_CONTROL_RESET_REQUEST|MDM_AP_CONTROL_MASS_ERASE_REQUEST);
-      if (rc != BDM_RC_OK) {
-         continue;
+      if (value != pattern) {
+         return BDM_RC_FAIL;
       }
-      // Check if mass erase commenced
-      rc = readAPReg(MDM_AP_CONTROL, valueRead);
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Automatically determine SWD speed
+ *
+ *  - Connect at a safe speed to obtain target IDCODE
+ *  - If the target is in the speed cache, verify and use the cached speed
+ *  - Otherwise try each candidate speed (fastest first) until verification succeeds
+ *    and then use the next lower speed for margin
+ *
+ * @return BDM_RC_OK => Success, error otherwise
+ *
+ * @note The speed is automatically reduced on repeated parity errors
+ */
+USBDM_ErrorCode autoTuneSpeed() {
+   constexpr int numSpeeds = sizeof(autoSpeeds)/sizeof(autoSpeeds[0]);
+   USBDM_ErrorCode rc;
+
+   setAutoSpeed(SAFE_SPEED_INDEX);
+   rc = connect();
+   if (rc != BDM_RC_OK) {
+      // Try slowest speed
+      setAutoSpeed(numSpeeds-1);
+      rc = connect();
       if (rc != BDM_RC_OK) {
-         continue;
+         return rc;
       }
-      if ((valueRead&MDM_AP_CONTROL_MASS_ERASE_REQUEST) == 0) {
-         continue;
+   }
+   SpeedCacheEntry *entry = findSpeedCacheEntry(targetIdcode);
+   if (entry != nullptr) {
+      setAutoSpeed(entry->speedIndex);
+      if (verifySpeed() == BDM_RC_OK) {
+         return clearStickyBits();
       }
-      UsbLed::off();
-      // Wait until complete
-      for (int eraseWait=0; eraseWait<20; eraseWait++) {
-         USBDM::waitMS(100);
-         rc = readAPReg(MDM_AP_CONTROL, valueRead);
-         if (rc != BDM_RC_OK) {
-            continue;
-         }
-         if ((valueRead&MDM_AP_CONTROL_MASS_ERASE_REQUEST) == 0) {
+      // Cached speed no longer works
+      entry->speedIndex = -1;
+   }
+   int index;
+   for (index=0; index<numSpeeds; index++) {
+      setAutoSpeed(index);
+      unsigned pass;
+      for (pass=0; pass<AUTOTUNE_PASSES; pass++) {
+         if (verifySpeed() != BDM_RC_OK) {
             break;
          }
       }
-      rc = readAPReg(MDM_AP_STATUS, valueRead);
-      if (rc != BDM_RC_OK) {
-         continue;
-      }
-      // Check if mass erase is disabled
-      if ((valueRead&MDM_AP_STATUS_MASS_ERASE_ENABLE) == 0) {
-         return BDM_RC_MASS_ERASE_DISABLED;
-      }
-      rc = ((valueRead&MDM_AP_STATUS_SECURE) == 0)?BDM_RC_OK:BDM_RC_FAIL;
-      if (rc == BDM_RC_OK) {
-         successCount++;
-      }
-      // Only consider successful if done ERASE_MULTIPLE times in a row
-      // This prevents mass-erase attempts during power-on bounces etc.
-      if (successCount>=ERASE_MULTIPLE) {
+      if (pass == AUTOTUNE_PASSES) {
          break;
       }
    }
-   return (successCount>=ERASE_MULTIPLE)?BDM_RC_OK:BDM_RC_FAIL;
+   if (index >= numSpeeds) {
+      setAutoSpeed(numSpeeds-1);
+      return BDM_RC_NO_CONNECTION;
+   }
+   // Use next lower speed for margin
+   if (index < (numSpeeds-1)) {
+      index++;
+   }
+   setAutoSpeed(index);
+   rc = verifySpeed();
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   updateSpeedCache(targetIdcode, index);
+   consecutiveParityErrors = 0;
+   return clearStickyBits();
 }
 
-/** Write 32-bit value to ARM-SWD Memory
- *
- *  @param address 32-bit memory address
- *  @param data    32-bit data value
- *
+//===========================================================================
+// SWD transaction queue
+//
+// A batch of DP/AP transactions is converted to a list of SPI.PUSHR values.
+// One DMA channel feeds these to the SPI transmit FIFO while a second DMA channel
+// drains SPI.POPR into a result buffer.  ACKs and parity are checked after the
+// batch completes.
+//
+// Consecutive writes are sent as a single DMA run.  Fixed frame formats are used so
+// the CTARs are only programmed once per run:
+//  CTAR0 = 8-bit transmit, CTAR1 = 5-bit receive
+//
+//  Write = [command], [TRN, ACK, TRN], [data+parity+idle] as 5 x 8-bit transmit frames
+//
+// The turn-arounds are received so the probe and target never drive SWDIO at the same time.
+// The 37-bit [TRN, ACK, data, parity] of a read can't be made from 5-bit frames so queued
+// reads are done individually between write runs.
+//
+// DP overrun detection is enabled while the batch executes so that a WAIT/FAULT
+// response keeps the transactions aligned and causes the following transactions to be rejected.
+
+/** DMA channel used to write SPI.PUSHR */
+static constexpr unsigned SWD_DMA_TX_CHANNEL = 0;
+
+/** DMA channel used to read SPI.POPR (higher priority than Tx channel) */
+static constexpr unsigned SWD_DMA_RX_CHANNEL = 1;
+
+/** DMAMUX slot for SPI0 Transmit */
+static constexpr uint8_t  DMA0_SLOT_SPI0_Transmit = 15;
+
+/** DMAMUX slot for SPI0 Receive */
+static constexpr uint8_t  DMA0_SLOT_SPI0_Receive  = 14;
+
+/** Number of SPI frames used by a write transaction */
+static constexpr unsigned QUEUE_WRITE_FRAMES = 1+1+5;
+
+/** Size of frame buffers (worst case is all writes) */
+static constexpr unsigned QUEUE_MAX_FRAMES = SWD_QUEUE_SIZE*QUEUE_WRITE_FRAMES;
+
+static_assert(QUEUE_MAX_FRAMES <= 256, "QueueEntry.frame is too small");
+
+/** Queued transaction */
+struct QueueEntry {
+   uint8_t   command;   //!< SWD command
+   uint8_t   frame;     //!< Index of first SPI frame (writes only)
+   uint32_t *data;      //!< Where to place read data (reads only)
+};
+
+/** Transactions in queue */
+static QueueEntry queueEntries[SWD_QUEUE_SIZE];
+
+/** Number of transactions in queue */
+static unsigned queueCount;
+
+/** Number of SPI frames needed for queue */
+static unsigned queueFrames;
+
+/** PUSHR values for queued transactions - written to SPI by DMA */
+static uint32_t queueTxFrames[QUEUE_MAX_FRAMES];
+
+/** POPR values for queued transactions - read from SPI by DMA */
+static uint32_t queueRxFrames[QUEUE_MAX_FRAMES];
+
+/** Set by DMA interrupt when batch completes */
+static volatile bool queueComplete;
+
+/**
+ * Handler for DMA complete interrupt from SPI receive channel
+ */
+extern "C"
+void DMA1_IRQHandler() {
+   DMA0->CINT    = DMA_CINT_CINT(SWD_DMA_RX_CHANNEL);
+   queueComplete = true;
+}
+
+/**
+ * Clear SWD transaction queue
+ */
+void queueClear() {
+   queueCount  = 0;
+   queueFrames = 0;
+}
+
+/**
+ * Add DP/AP read to SWD transaction queue
+ *
+ * @param command SWD command byte to select register etc.
+ * @param data    Where to place the 32-bit value read when the queue is executed
+ *
+ * @return BDM_RC_OK             => Success
+ * @return BDM_RC_ILLEGAL_PARAMS => Queue is full
+ */
+USBDM_ErrorCode queueRead(uint8_t command, uint32_t *data) {
+   if (queueCount >= SWD_QUEUE_SIZE) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   // Reads are done individually when the queue is executed
+   queueEntries[queueCount++] = {command, 0, data};
+   updateCachedState(command, 0);
+   return BDM_RC_OK;
+}
+
+/**
+ * Add DP/AP write to SWD transaction queue
+ *
+ * @param command SWD command byte to select register etc.
+ * @param data    32-bit value to write
+ *
+ * @return BDM_RC_OK             => Success
+ * @return BDM_RC_ILLEGAL_PARAMS => Queue is full
+ */
+USBDM_ErrorCode queueWrite(uint8_t command, uint32_t data) {
+   if (queueCount >= SWD_QUEUE_SIZE) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   queueEntries[queueCount++] = {command, (uint8_t)queueFrames, nullptr};
+   updateCachedState(command, data);
+   // [command]
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA(command);
+   // [TRN, ACK, TRN]
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(1)|RX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA(0);
+   // [32-bit data, parity, 7 idle]
+   uint32_t parity = calcParity(data);
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA(data&0xFF);
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA((data>>8)&0xFF);
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA((data>>16)&0xFF);
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA((data>>24)&0xFF);
+   queueTxFrames[queueFrames++] = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_CONT(1)|SPI_PUSHR_TXDATA(parity);
+   return BDM_RC_OK;
+}
+
+/**
+ * Transfer a run of queued frames using DMA
+ * The processor sleeps until the transfer is complete
+ *
+ * @param firstFrame Index of first frame to transfer
+ * @param numFrames  Number of frames to transfer
+ */
+static void queueTransfer(unsigned firstFrame, unsigned numFrames) {
+   // Last frame terminates run
+   queueTxFrames[firstFrame+numFrames-1] =
+         (queueTxFrames[firstFrame+numFrames-1]&~SPI_PUSHR_CONT_MASK)|SPI_PUSHR_EOQ_MASK;
+
+   SIM->SCGC6 |= SIM_SCGC6_DMAMUX0_MASK;
+   SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+   // Memory -> SPI.PUSHR
+   DMAMUX0->CHCFG[SWD_DMA_TX_CHANNEL] = 0;
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].SADDR          = (uint32_t)(queueTxFrames+firstFrame);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].SOFF           = sizeof(queueTxFrames[0]);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].NBYTES_MLNO    = sizeof(queueTxFrames[0]);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].SLAST          = 0;
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].DADDR          = (uint32_t)&spi->PUSHR;
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].DOFF           = 0;
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].CITER_ELINKNO  = DMA_CITER_ELINKNO_CITER(numFrames);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].BITER_ELINKNO  = DMA_BITER_ELINKNO_BITER(numFrames);
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].DLASTSGA       = 0;
+   DMA0->TCD[SWD_DMA_TX_CHANNEL].CSR            = DMA_CSR_DREQ_MASK;
+   DMAMUX0->CHCFG[SWD_DMA_TX_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(DMA0_SLOT_SPI0_Transmit);
+
+   // SPI.POPR -> Memory
+   DMAMUX0->CHCFG[SWD_DMA_RX_CHANNEL] = 0;
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].SADDR          = (uint32_t)&spi->POPR;
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].SOFF           = 0;
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].ATTR           = DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].NBYTES_MLNO    = sizeof(queueRxFrames[0]);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].SLAST          = 0;
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].DADDR          = (uint32_t)(queueRxFrames+firstFrame);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].DOFF           = sizeof(queueRxFrames[0]);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].CITER_ELINKNO  = DMA_CITER_ELINKNO_CITER(numFrames);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].BITER_ELINKNO  = DMA_BITER_ELINKNO_BITER(numFrames);
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].DLASTSGA       = 0;
+   DMA0->TCD[SWD_DMA_RX_CHANNEL].CSR            = DMA_CSR_DREQ_MASK|DMA_CSR_INTMAJOR_MASK;
+   DMAMUX0->CHCFG[SWD_DMA_RX_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(DMA0_SLOT_SPI0_Receive);
+
+   queueComplete = false;
+   NVIC_EnableIRQ(DMA1_IRQn);
+
+   setCTAR0Value(CTAR_TX|SPI_CTAR_FMSZ(8-1)); // 8-bit Transmit
+   setCTAR1Value(CTAR_RX|SPI_CTAR_FMSZ(5-1)); // 5-bit Receive
+
+   // SPI FIFO requests use DMA
+   spi->RSER =
+         SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK|
+         SPI_RSER_RFDF_RE_MASK|SPI_RSER_RFDF_DIRS_MASK;
+
+   DMA0->SERQ = DMA_SERQ_SERQ(SWD_DMA_RX_CHANNEL);
+   DMA0->SERQ = DMA_SERQ_SERQ(SWD_DMA_TX_CHANNEL);
+
+   // Sleep until complete - USB etc. are serviced by interrupts
+   // Interrupts are masked around the test so the completion interrupt can't be
+   // taken between the test and __WFI() (a pending interrupt still wakes the core)
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   while (!queueComplete) {
+      __WFI();
+      __enable_irq();
+      __disable_irq();
+   }
+   __set_PRIMASK(primask);
+   spi->RSER = 0;
+   // Clear flags
+   spi->SR = SPI_SR_RFDF_MASK|SPI_SR_TFFF_MASK|SPI_SR_EOQF_MASK;
+}
+
+/**
+ * Execute SWD transaction queue
+ * Read values are written to the locations given when queued.
+ * The queue is cleared.
+ *
+ * @param completed Number of transactions that completed successfully.
+ *                  Transactions after this were not accepted by the target.
+ *                  On a FAULT the preceding transaction is not counted as AP writes
+ *                  are posted i.e. a failed write is reported by the following transaction.
+ *
+ * @return BDM_RC_OK               => Success
+ * @return BDM_RC_ARM_FAULT_ERROR  => FAULT response from target
+ * @return BDM_RC_ACK_TIMEOUT      => WAIT response from target
+ * @return BDM_RC_NO_CONNECTION    => Unexpected/no response from target
+ * @return BDM_RC_ARM_PARITY_ERROR => Parity error on data read
+ *
+ * @note Sticky errors are cleared if a transaction fails.
+ */
+USBDM_ErrorCode queueExecute(unsigned &completed) {
+   USBDM_ErrorCode rc = BDM_RC_OK;
+
+   completed = 0;
+   if (queueCount == 0) {
+      return BDM_RC_OK;
+   }
+   // Overrun detection is needed so a WAIT/FAULT doesn't de-synchronise the queue
+   rc = writeReg(SWD_WR_DP_CONTROL, SWD_WR_DP_CONTROL_POWER_REQ|SWD_WR_DP_CONTROL_ORUNDETECT);
+   if (rc != BDM_RC_OK) {
+      queueClear();
+      invalidateCachedState();
+      return rc;
+   }
+   for (unsigned index=0; index<queueCount;) {
+      QueueEntry &entry = queueEntries[index];
+      uint32_t ack;
+      if (entry.data != nullptr) {
+         // Individual read - [command], [TRN, ACK], [32-bit data, parity]
+         // A data phase follows WAIT/FAULT as overrun detection is enabled
+         ack = txCommand_rxAck(entry.command);
+         uint32_t value;
+         USBDM_ErrorCode rxRc = rx32_parity(value);
+         if (ack == SWD_ACK_OK) {
+            if (rxRc != BDM_RC_OK) {
+               rc = rxRc;
+               break;
+            }
+            *entry.data = value;
+            completed++;
+            index++;
+            continue;
+         }
+      }
+      else {
+         // Run of consecutive writes
+         unsigned last = index+1;
+         while ((last < queueCount) && (queueEntries[last].data == nullptr)) {
+            last++;
+         }
+         unsigned endFrame = (last < queueCount)?queueEntries[last].frame:queueFrames;
+         queueTransfer(entry.frame, endFrame-entry.frame);
+
+         // Check [TRN, ACK, TRN] of each write
+         for (; index<last; index++) {
+            ack = (queueRxFrames[queueEntries[index].frame+1]>>1)&0x7;
+            if (ack != SWD_ACK_OK) {
+               break;
+            }
+            completed++;
+         }
+         if (index == last) {
+            continue;
+         }
+      }
+      if (ack == SWD_ACK_WAIT) {
+         rc = BDM_RC_ACK_TIMEOUT;
+      }
+      else if (ack == SWD_ACK_FAULT) {
+         // Fault may be due to the previous (posted) write
+         if (completed > 0) {
+            completed--;
+         }
+         rc = BDM_RC_ARM_FAULT_ERROR;
+      }
+      else {
+         rc = BDM_RC_NO_CONNECTION;
+      }
+      break;
+   }
+   queueClear();
+   if (rc != BDM_RC_OK) {
+      // Cached values assumed all queued transactions would complete
+      invalidateCachedState();
+      // Clear overrun and other sticky errors from failed transaction
+      clearStickyBits();
+   }
+   USBDM_ErrorCode rc2 = writeReg(SWD_WR_DP_CONTROL, SWD_WR_DP_CONTROL_POWER_REQ);
+   return (rc != BDM_RC_OK)?rc:rc2;
+}
+
+static constexpr uint32_t  MDM_AP_STATUS                     = 0x01000000;
+static constexpr uint32_t  MDM_AP_CONTROL                    = 0x01000004;
+//static constexpr uint32_t  MDM_AP_IDR                        = 0x010000FC;
+
+static constexpr uint32_t  MDM_AP_CONTROL_MASS_ERASE_REQUEST = (1<<0);
+//static constexpr uint32_t  MDM_AP_CONTROL_DEBUG_REQUEST      = (1<<2);
+static constexpr uint32_t  MDM_AP_CONTROL_RESET_REQUEST      = (1<<3);
+//static constexpr uint32_t  MDM_AP_CONTROL_VLLDBGREQ          = (1<<5);
+//static constexpr uint32_t  MDM_AP_CONTROL_VLLDBGACK          = (1<<6);
+//static constexpr uint32_t  MDM_AP_CONTROL_LLS_VLLSx_ACK      = (1<<7);
+
+//static constexpr uint32_t  MDM_AP_STATUS_FLASH_READY         = (1<<1);
+static constexpr uint32_t  MDM_AP_STATUS_SECURE              = (1<<2);
+static constexpr uint32_t  MDM_AP_STATUS_MASS_ERASE_ENABLE   = (1<<5);
+
+static constexpr uint32_t  ATTEMPT_MULTIPLE                  = 100;  // How many times to attemp mass erase
+static constexpr uint32_t  ERASE_MULTIPLE                    = 2;    // How many times to mass erase
+
+/**
+ * Mass erase target
+ *
+ * @return BDM_RC_OK if successful
+ */
+USBDM_ErrorCode kinetisMassErase(void) {
+   unsigned successCount = 0;
+   unsigned attemptCount = 0;
+   uint8_t rc;
+   uint32_t valueRead;
+
+   ResetInterface::low();
+   for (;;) {
+      UsbLed::on();
+      if (attemptCount++>ATTEMPT_MULTIPLE) {
+         break;
+      }
+      // Do connect sequence
+      rc = connect();
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      rc = clearStickyBits();
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      // Power up Debug interface
+      rc = powerUp();
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      // Do mass erase
+      rc = writeAPReg(MDM_AP_CONTROL, MDM_AP_CONTROL_RESET_REQUEST|MDM_AP_CONTROL_MASS_ERASE_REQUEST);
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      // Check if mass erase commenced
+      rc = readAPReg(MDM_AP_CONTROL, valueRead);
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      if ((valueRead&MDM_AP_CONTROL_MASS_ERASE_REQUEST) == 0) {
+         continue;
+      }
+      UsbLed::off();
+      // Wait until complete
+      for (int eraseWait=0; eraseWait<20; eraseWait++) {
+         USBDM::waitMS(100);
+         rc = readAPReg(MDM_AP_CONTROL, valueRead);
+         if (rc != BDM_RC_OK) {
+            continue;
+         }
+         if ((valueRead&MDM_AP_CONTROL_MASS_ERASE_REQUEST) == 0) {
+            break;
+         }
+      }
+      rc = readAPReg(MDM_AP_STATUS, valueRead);
+      if (rc != BDM_RC_OK) {
+         continue;
+      }
+      // Check if mass erase is disabled
+      if ((valueRead&MDM_AP_STATUS_MASS_ERASE_ENABLE) == 0) {
+         return BDM_RC_MASS_ERASE_DISABLED;
+      }
+      rc = ((valueRead&MDM_AP_STATUS_SECURE) == 0)?BDM_RC_OK:BDM_RC_FAIL;
+      if (rc == BDM_RC_OK) {
+         successCount++;
+      }
+      // Only consider successful if done ERASE_MULTIPLE times in a row
+      // This prevents mass-erase attempts during power-on bounces etc.
+      if (successCount>=ERASE_MULTIPLE) {
+         break;
+      }
+   }
+   return (successCount>=ERASE_MULTIPLE)?BDM_RC_OK:BDM_RC_FAIL;
+}
+
+/** Write 32-bit value to ARM-SWD Memory
+ *
+ *  @param address 32-bit memory address
+ *  @param data    32-bit data value
+ *
  *  @return BDM_RC_OK => success, error otherwise
  */
 USBDM_ErrorCode writeMemoryWord(const uint32_t address, const uint32_t data) {
@@ -925,7 +1738,7 @@ USBDM_ErrorCode writeMemoryWord(const uint32_t address, const uint32_t data) {
     *  - Write value to DRW (data value to target memory)
     */
    // Select AHB-AP memory bank - subsequent AHB-AP register accesses are all in the same bank
-   rc = writeReg(SWD_WR_DP_SELECT, ARM_AHB_AP_BANK0);
+   rc = writeSelect(ARM_AHB_AP_BANK0);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -934,12 +1747,12 @@ USBDM_ErrorCode writeMemoryWord(const uint32_t address, const uint32_t data) {
       return rc;
    }
    // Write CSW (word access etc)
-   rc = writeReg(SWD_WR_AHB_CSW, ahb_ap_csw_defaultValue|AHB_AP_CSW_SIZE_WORD);
+   rc = writeCsw(ahb_ap_csw_defaultValue|AHB_AP_CSW_SIZE_WORD);
    if (rc != BDM_RC_OK) {
       return rc;
    }
    // Write TAR (target address)
-   rc = writeReg(SWD_WR_AHB_TAR, address);
+   rc = writeTar(address);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -953,6 +1766,25 @@ USBDM_ErrorCode writeMemoryWord(const uint32_t address, const uint32_t data) {
    return readReg(SWD_RD_DP_RDBUFF, tt);
 }
 
+/**
+ * Load value to write to AHB-AP.DRW from buffer
+ * The byte lane used depends on the element size and address
+ *
+ *  @param elementSize  Size of the data element (1, 2 or 4 bytes)
+ *  @param addr         Target memory address of element
+ *  @param data_ptr     Where to obtain the data (LITTLE-ENDIAN order), updated
+ *
+ *  @return 32-bit value to write to DRW
+ */
+static inline uint32_t loadElement(uint32_t elementSize, uint32_t addr, uint8_t *&data_ptr) {
+   uint32_t value = 0;
+   for (unsigned shift=0; shift<8*elementSize; shift+=8) {
+      value |= (*data_ptr++)<<shift;
+   }
+   // Select byte lane
+   return value<<(8*(addr&(4-elementSize)));
+}
+
 /**  Write ARM-SWD Memory
  *
  *  @note
@@ -971,18 +1803,24 @@ USBDM_ErrorCode writeMemory(
       uint8_t   *data_ptr     // Where the data is
 ) {
    USBDM_ErrorCode  rc;
-   uint8_t  temp[4] = {0xAA,0xAA,0xAA,0xAA,};
+   uint32_t temp;
 
    /* Steps
     *  - Set up to access AHB-AP register bank 0 (CSW,TAR,DRW)
     *  - Write AP-CSW value (auto-increment etc)
     *  - Write AP-TAR value (target memory address)
     *  - Loop
-    *    - Pack data
-    *    - Write value to DRW (data value to target memory)
+    *    - Queue batch of packed values to write to DRW (data value to target memory)
+    *    - Execute queue using DMA
+    *  - If a batch failed
+    *    - Re-write AP-TAR
+    *    - Write remaining values to DRW individually (retries write that caused a FAULT)
     */
+   if ((elementSize != MS_Byte) && (elementSize != MS_Word) && (elementSize != MS_Long)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
    // Select AHB-AP memory bank - subsequent AHB-AP register accesses are all in the same bank
-   rc = writeReg(SWD_WR_DP_SELECT, ARM_AHB_AP_BANK0);
+   rc = writeSelect(ARM_AHB_AP_BANK0);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -991,62 +1829,53 @@ USBDM_ErrorCode writeMemory(
       return rc;
    }
    // Write CSW (auto-increment etc)
-   rc = writeReg(SWD_WR_AHB_CSW, ahb_ap_csw_defaultValue|getcswValue(elementSize));
+   rc = writeCsw(ahb_ap_csw_defaultValue|getcswValue(elementSize));
    if (rc != BDM_RC_OK) {
       return rc;
    }
    // Write TAR (target address)
-   rc = writeReg(SWD_WR_AHB_TAR, addr);
+   rc = writeTar(addr);
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   switch (elementSize) {
-   case MS_Byte:
-      while (count > 0) {
-         switch (addr&0x3) {
-         case 0: temp[3] = *data_ptr++; break;
-         case 1: temp[2] = *data_ptr++; break;
-         case 2: temp[1] = *data_ptr++; break;
-         case 3: temp[0] = *data_ptr++; break;
-         }
-         rc = writeReg(SWD_WR_AHB_DRW, temp);
-         if (rc != BDM_RC_OK) {
-            return rc;
-         }
-         addr++;
-         count--;
+   count /= elementSize;
+   const uint32_t startAddr = addr;
+   while (count > 0) {
+      unsigned batchSize = (count>SWD_QUEUE_SIZE)?SWD_QUEUE_SIZE:count;
+      uint8_t *batch_ptr = data_ptr;
+      uint32_t batchAddr = addr;
+      for (unsigned index=0; index<batchSize; index++) {
+         queueWrite(SWD_WR_AHB_DRW, loadElement(elementSize, batchAddr, batch_ptr));
+         batchAddr += elementSize;
       }
-      break;
-   case MS_Word:
-      count >>= 1;
-      while (count > 0) {
-         switch (addr&0x2) {
-         case 0:  temp[3] = *data_ptr++;
-         temp[2] = *data_ptr++; break;
-         case 2:  temp[1] = *data_ptr++;
-         temp[0] = *data_ptr++; break;
-         }
-         rc = writeReg(SWD_WR_AHB_DRW, temp);
-         if (rc != BDM_RC_OK) {
-            return rc;
-         }
-         addr  += 2;
-         count--;
+      unsigned completed;
+      rc = queueExecute(completed);
+      if ((rc == BDM_RC_ARM_FAULT_ERROR) && (completed == 0) && (addr != startAddr)) {
+         // Fault may be due to the last (posted) write of the previous batch
+         addr     -= elementSize;
+         data_ptr -= elementSize;
+         count++;
+      }
+      addr     += completed*elementSize;
+      data_ptr += completed*elementSize;
+      count    -= completed;
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+   }
+   if (count > 0) {
+      // Continue with remaining elements using individual transactions
+      rc = writeTar(addr);
+      if (rc != BDM_RC_OK) {
+         return rc;
       }
-      break;
-   case MS_Long:
-      count >>= 2;
       while (count-- > 0) {
-         temp[3] = *data_ptr++;
-         temp[2] = *data_ptr++;
-         temp[1] = *data_ptr++;
-         temp[0] = *data_ptr++;
-         rc = writeReg(SWD_WR_AHB_DRW, temp);
+         rc = writeReg(SWD_WR_AHB_DRW, loadElement(elementSize, addr, data_ptr));
          if (rc != BDM_RC_OK) {
             return rc;
          }
+         addr += elementSize;
       }
-      break;
    }
    // Dummy read to obtain status from last write
    return readReg(SWD_RD_DP_RDBUFF, temp);
@@ -1070,7 +1899,7 @@ USBDM_ErrorCode readMemoryWord(const uint32_t address, uint32_t &data) {
     *  - Read data value from DP-READBUFF
     */
    // Select AHB-AP memory bank - subsequent AHB-AP register accesses are all in the same bank
-   rc = writeReg(SWD_WR_DP_SELECT, ARM_AHB_AP_BANK0);
+   rc = writeSelect(ARM_AHB_AP_BANK0);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -1079,12 +1908,12 @@ USBDM_ErrorCode readMemoryWord(const uint32_t address, uint32_t &data) {
       return rc;
    }
    // Write memory access control to CSW
-   rc = writeReg(SWD_WR_AHB_CSW, ahb_ap_csw_defaultValue|AHB_AP_CSW_SIZE_WORD);
+   rc = writeCsw(ahb_ap_csw_defaultValue|AHB_AP_CSW_SIZE_WORD);
    if (rc != BDM_RC_OK) {
       return rc;
    }
    // Write TAR (target address)
-   rc = writeReg(SWD_WR_AHB_TAR, address);
+   rc = writeTar(address);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -1098,6 +1927,215 @@ USBDM_ErrorCode readMemoryWord(const uint32_t address, uint32_t &data) {
    return readReg(SWD_RD_DP_RDBUFF, data);
 }
 
+/**
+ * Save value read from AHB-AP.DRW to buffer
+ * The byte lane used depends on the element size and address
+ *
+ *  @param elementSize  Size of the data element (1, 2 or 4 bytes)
+ *  @param addr         Target memory address of element
+ *  @param value        32-bit value read from DRW
+ *  @param data_ptr     Where to write the data (LITTLE-ENDIAN order), updated
+ */
+static inline void saveElement(uint32_t elementSize, uint32_t addr, uint32_t value, uint8_t *&data_ptr) {
+   // Select byte lane
+   value >>= 8*(addr&(4-elementSize));
+   do {
+      *data_ptr++ = (uint8_t)value;
+      value >>= 8;
+   } while (--elementSize > 0);
+}
+
+/**
+ *  Pipelined read of consecutive elements through AHB-AP.DRW
+ *
+ *  The transactions for all reads are queued back-to-back through the SPI FIFOs.
+ *  Each transaction is [TRN, 8-bit command] transmitted followed by [TRN, 3-bit ACK, 32-bit data, parity]
+ *  received.  The turn-around after the command is received (as for txCommand_rxAck()) so the
+ *  probe and target never drive SWDIO at the same time.
+ *
+ *  The 37 received bits can't be split into equal SPI frames so the transfer is done in runs
+ *  that alternate between 9-bit and 14-bit receive frames (9+2*14 = 37).  Each run contains the
+ *  tail of the previous transaction, the command and the head of the next:
+ *   - CTAR0 = 9-bit transmit [TRN, 8-bit command]
+ *   - CTAR1 = 9-bit receive (even runs)\n
+ *             tail [data 24-31, parity], head [TRN, ACK, data 0-4]
+ *   - CTAR1 = 14-bit receive (odd runs)\n
+ *             tail [data 5-18], [data 19-31, parity], head [TRN, ACK, data 0-9], [data 10-23]
+ *  CTAR1 is only changed between runs while the SPI is stopped (SWDCLK is held).
+ *
+ *  The first DRW read only initiates the access.  The final value is obtained from DP-RDBUFF.
+ *  DP overrun detection must be enabled so that a WAIT/FAULT response still has a data phase
+ *  and causes the remaining transactions in the burst to be rejected.
+ *
+ *  The frame layout has only been checked by hand against txCommand_rxAck() and rxData().
+ *  It has not been run against a simulator or observed with a logic analyser.
+ *  BDM_DBG_SWD_READ_CHECK compares it with individual reads on a real target.
+ *
+ *  @param elementSize  Size of the data elements
+ *  @param count        Number of elements
+ *  @param addr         Address in target memory (AHB-AP.TAR must already be set to this)
+ *  @param data_ptr     Where to write the data
+ *
+ *  @return Number of elements successfully read.\n
+ *          Any remaining elements must be read after clearing sticky errors.
+ */
+static int readBlockPipelined(uint32_t elementSize, int count, uint32_t addr, uint8_t *data_ptr) {
+
+   const unsigned transactions = count+1;
+   unsigned started      = 0;
+   unsigned decoded      = 0;
+   int      elementsRead = 0;
+   bool     failed       = false;
+   uint64_t bits         = 0;
+   unsigned bitCount     = 0;
+
+   USBDM::enableTimer();
+   uint32_t startTicks = USBDM::getTicks();
+
+   setCTAR0Value(CTAR_TX|SPI_CTAR_FMSZ(9-1)); // 9-bit Transmit
+
+   for (unsigned run=0;;run++) {
+      // Receive frames alternate between 1x9-bit and 2x14-bit for each part of a transaction
+      const unsigned rxSize     = (run&1)?14:9;
+      const unsigned partFrames = (run&1)?2:1;
+
+      // Frames for run - true => transmit command frame
+      bool     isTx[2*2+1];
+      unsigned numFrames = 0;
+      if (run > 0) {
+         // Tail of previous transaction
+         for (unsigned index=0; index<partFrames; index++) {
+            isTx[numFrames++] = false;
+         }
+      }
+      const bool startNext = (started < transactions) && !failed;
+      if (startNext) {
+         // Command and head of next transaction
+         isTx[numFrames++] = true;
+         for (unsigned index=0; index<partFrames; index++) {
+            isTx[numFrames++] = false;
+         }
+      }
+      setCTAR1Value(CTAR_RX|SPI_CTAR_FMSZ(rxSize-1));
+
+      unsigned framesSent     = 0;
+      unsigned framesReceived = 0;
+      while (framesReceived < numFrames) {
+         // Keep FIFO full - limit frames in flight so the Rx FIFO can't overflow
+         if ((framesSent < numFrames) && ((framesSent-framesReceived) < SPI_FIFO_DEPTH)) {
+            uint32_t pushr;
+            if (isTx[framesSent]) {
+               // [TRN, command] - Last transaction obtains data from RDBUFF
+               uint8_t command = (started < (unsigned)count)?SWD_RD_AHB_DRW:SWD_RD_DP_RDBUFF;
+               pushr = SPI_PUSHR_CTAS(0)|TX_MASK|SPI_PUSHR_TXDATA(command<<1);
+               started++;
+            }
+            else {
+               // Part of [TRN, ACK, data, parity]
+               pushr = SPI_PUSHR_CTAS(1)|RX_MASK|SPI_PUSHR_TXDATA(0);
+            }
+            if (++framesSent < numFrames) {
+               pushr |= SPI_PUSHR_CONT(1);
+            }
+            else {
+               pushr |= SPI_PUSHR_CONT(0)|SPI_PUSHR_EOQ_MASK;
+            }
+            spi->PUSHR = pushr;
+         }
+         if ((spi->SR & SPI_SR_RFDF_MASK) != 0) {
+            uint32_t frame = spi->POPR;
+            spi->SR = SPI_SR_RFDF_MASK;
+            if (isTx[framesReceived++]) {
+               // Discard transmit frame
+               continue;
+            }
+            bits     |= (uint64_t)frame<<bitCount;
+            bitCount += rxSize;
+            if (bitCount < 37) {
+               continue;
+            }
+            // Complete [TRN, ACK, data, parity]
+            uint32_t ack    = (uint32_t)(bits>>1)&0x7;
+            uint32_t value  = (uint32_t)(bits>>4);
+            uint32_t parity = (uint32_t)(bits>>36)&0x1;
+            bits     = 0;
+            bitCount = 0;
+            if (!failed) {
+               if ((ack != SWD_ACK_OK) || (parity != calcParity(value))) {
+                  // Stop on first failure - later values are discarded
+                  failed = true;
+               }
+               else if (decoded > 0) {
+                  // Data from previous read (1st read is dummy)
+                  saveElement(elementSize, addr, value, data_ptr);
+                  addr += elementSize;
+                  elementsRead++;
+               }
+            }
+            decoded++;
+         }
+      }
+      while ((spi->SR & SPI_SR_EOQF_MASK) == 0) {
+      }
+      // Clear flags
+      spi->SR = SPI_SR_RFDF_MASK|SPI_SR_EOQF_MASK;
+
+      if (!startNext) {
+         break;
+      }
+   }
+   blockReadStatistics.bytes     += elementsRead*elementSize;
+   blockReadStatistics.swdClocks += started*BLOCK_READ_CLOCKS;
+   blockReadStatistics.ticks     += USBDM::TIMER_MASK&(startTicks-USBDM::getTicks());
+   return elementsRead;
+}
+
+/**
+ * Get statistics for pipelined memory reads
+ *
+ * @param statistics Accumulated statistics
+ * @param clear      Clear statistics after obtaining them
+ */
+void getBlockReadStatistics(BlockReadStatistics &statistics, bool clear) {
+   statistics = blockReadStatistics;
+   if (clear) {
+      blockReadStatistics = {0, 0, 0};
+   }
+}
+
+/**
+ * Check pipelined memory read against individual word reads
+ *
+ * The block is read by readMemory() (pipelined) and then again one word at a time
+ * by readMemoryWord().  The target memory must not change between the two reads.
+ *
+ * @param addr           Address of block (word aligned)
+ * @param count          Number of bytes (multiple of 4)
+ * @param buffer         Buffer of count bytes for the pipelined read
+ * @param mismatches     Number of words that differ
+ * @param firstMismatch  Byte offset of first word that differs (count if none)
+ *
+ * @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode checkBlockRead(uint32_t addr, unsigned count, uint8_t *buffer, unsigned &mismatches, unsigned &firstMismatch) {
+   mismatches    = 0;
+   firstMismatch = count;
+   if (((addr|count)&3) != 0) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   USBDM_ErrorCode rc = readMemory(MS_Long, count, addr, buffer);
+   for (unsigned offset=0; (rc == BDM_RC_OK) && (offset<count); offset+=4) {
+      uint32_t value;
+      rc = readMemoryWord(addr+offset, value);
+      if ((rc == BDM_RC_OK) && (value != pack32LE(buffer+offset))) {
+         if (mismatches++ == 0) {
+            firstMismatch = offset;
+         }
+      }
+   }
+   return rc;
+}
+
 /**  Read ARM-SWD Memory
  *
  *  @param elementSize  Size of the data elements
@@ -1109,21 +2147,27 @@ USBDM_ErrorCode readMemoryWord(const uint32_t address, uint32_t &data) {
  */
 USBDM_ErrorCode readMemory(uint32_t elementSize, int count, uint32_t addr, uint8_t *data_ptr) {
    USBDM_ErrorCode  rc;
-   uint8_t  temp[4];
+   uint32_t temp;
 
    /* Steps
     *  - Set up to DP_SELECT to access AHB-AP register bank 0 (CSW,TAR,DRW)
     *  - Write AP-CSW value (auto-increment etc)
     *  - Write AP-TAR value (starting target memory address)
-    *  - Loop
-    *    - Read value from DRW (data value from target memory)
-    *      Note: 1st value read from DRW is discarded
-    *      Note: Last value is read from DP-READBUFF
-    *    - Copy to buffer adjusting byte order
+    *  - Enable overrun detection and do pipelined read of all values
+    *  - If the pipelined read failed
+    *    - Clear sticky errors and re-write AP-TAR
+    *    - Loop
+    *      - Read value from DRW (data value from target memory)
+    *        Note: 1st value read from DRW is discarded
+    *        Note: Last value is read from DP-READBUFF
+    *  - Copy to buffer adjusting byte order
     */
    if (count>MAX_COMMAND_SIZE-1) {
       return BDM_RC_ILLEGAL_PARAMS;  // requested block+status is too long to fit into the buffer
    }
+   if ((elementSize != MS_Byte) && (elementSize != MS_Word) && (elementSize != MS_Long)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
 #ifdef HACK
    {
       uint32_t address = (commandBuffer[4]<<24)+(commandBuffer[5]<<16)+(commandBuffer[6]<<8)+commandBuffer[7];
@@ -1133,7 +2177,7 @@ USBDM_ErrorCode readMemory(uint32_t elementSize, int count, uint32_t addr, uint8
    }
 #else
    // Select AHB-AP memory bank - subsequent AHB-AP register accesses are all in the same bank
-   rc = writeReg(SWD_WR_DP_SELECT, ARM_AHB_AP_BANK0);
+   rc = writeSelect(ARM_AHB_AP_BANK0);
    if (rc != BDM_RC_OK) {
       return rc;
    }
@@ -1142,97 +2186,79 @@ USBDM_ErrorCode readMemory(uint32_t elementSize, int count, uint32_t addr, uint8
       return rc;
    }
    // Write CSW (auto-increment etc)
-   rc = writeReg(SWD_WR_AHB_CSW, ahb_ap_csw_defaultValue|getcswValue(elementSize));
+   rc = writeCsw(ahb_ap_csw_defaultValue|getcswValue(elementSize));
    if (rc != BDM_RC_OK) {
       return rc;
    }
    // Write TAR (target address)
-   rc = writeReg(SWD_WR_AHB_TAR, addr);
+   rc = writeTar(addr);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   count /= elementSize;
+   if (count == 0) {
+      return BDM_RC_OK;
+   }
+   // Overrun detection is needed so a WAIT/FAULT doesn't de-synchronise the pipeline
+   rc = writeReg(SWD_WR_DP_CONTROL, SWD_WR_DP_CONTROL_POWER_REQ|SWD_WR_DP_CONTROL_ORUNDETECT);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   int elementsRead = readBlockPipelined(elementSize, count, addr, data_ptr);
+
+   // Turn-around + idle after pipelined transfers
+   txIdle8();
+
+   if (elementsRead == count) {
+      advanceCachedTar(count);
+   }
+   else {
+      invalidateCachedState();
+      // Clear overrun and other sticky errors from failed transaction
+      rc = clearStickyBits();
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   rc = writeReg(SWD_WR_DP_CONTROL, SWD_WR_DP_CONTROL_POWER_REQ);
    if (rc != BDM_RC_OK) {
       return rc;
    }
+   if (elementsRead == count) {
+      return BDM_RC_OK;
+   }
+   // Continue with remaining elements using individual transactions
+   addr     += elementsRead*elementSize;
+   data_ptr += elementsRead*elementSize;
+   count    -= elementsRead;
 
+   // Re-write TAR (target address)
+   rc = writeTar(addr);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
    // Initial read of DRW (dummy data)
    rc = readReg(SWD_RD_AHB_DRW, temp);
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   switch (elementSize) {
-   case MS_Byte:
-      do {
-         count--;
-         if (count == 0) {
-            // Read data from RDBUFF for final read
-            rc = readReg(SWD_RD_DP_RDBUFF, temp);
-         }
-         else {
-            // Start next read and collect data from last read
-            rc = readReg(SWD_RD_AHB_DRW, temp);
-         }
-         if (rc != BDM_RC_OK) {
-            return rc;
-         }
-         // Save data
-         switch (addr&0x3) {
-         case 0: *data_ptr++ = temp[3];  break;
-         case 1: *data_ptr++ = temp[2];  break;
-         case 2: *data_ptr++ = temp[1];  break;
-         case 3: *data_ptr++ = temp[0];  break;
-         }
-         addr++;
-      } while (count > 0);
-      break;
-   case MS_Word:
-      count >>= 1;
-      do {
-         count--;
-         if (count == 0) {
-            // Read data from RDBUFF for final read
-            rc = readReg(SWD_RD_DP_RDBUFF, temp);
-         }
-         else {
-            // Start next read and collect data from last read
-            rc = readReg(SWD_RD_AHB_DRW, temp);
-         }
-         if (rc != BDM_RC_OK) {
-            return rc;
-         }
-         // Save data
-         switch (addr&0x2) {
-         case 0:
-            *data_ptr++ = temp[3];
-            *data_ptr++ = temp[2];  break;
-         case 2:
-            *data_ptr++ = temp[1];
-            *data_ptr++ = temp[0];  break;
-         }
-         addr+=2;
-      } while (count > 0);
-      break;
-   case MS_Long:
-      count >>= 2;
-      do {
-         count--;
-         if (count == 0) {
-            // Read data from RDBUFF for final read
-            rc = readReg(SWD_RD_DP_RDBUFF, temp);
-         }
-         else {
-            // Start next read and collect data from last read
-            rc = readReg(SWD_RD_AHB_DRW, temp);
-         }
-         if (rc != BDM_RC_OK) {
-            return rc;
-         }
-         // Save data
-         *data_ptr++ = temp[3];
-         *data_ptr++ = temp[2];
-         *data_ptr++ = temp[1];
-         *data_ptr++ = temp[0];
-         //      addrLSB+=4;
-      } while (count > 0);
-      break;
-   }
+   do {
+      count--;
+      if (count == 0) {
+         // Read data from RDBUFF for final read
+         rc = readReg(SWD_RD_DP_RDBUFF, temp);
+      }
+      else {
+         // Start next read and collect data from last read
+         rc = readReg(SWD_RD_AHB_DRW, temp);
+      }
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      // Save data
+      saveElement(elementSize, addr, temp, data_ptr);
+      addr += elementSize;
+   } while (count > 0);
    return rc;
 #endif
 }
@@ -1400,6 +2426,107 @@ USBDM_ErrorCode readCoreRegister(uint8_t regNo, uint8_t data[4]) {
    return readMemoryWord(DCRDR_ADDR, data);
 }
 
+/**
+ *  Read multiple core registers
+ *
+ *  The AHB-AP is set up once so that the banked data registers BD0-BD2 map to DHCSR, DCRSR and DCRDR.\n
+ *  Each register then needs only [write DCRSR, read DHCSR, read DCRDR, read RDBUFF].\n
+ *  DHCSR is only polled further if the register transfer had not completed when DCRDR was read.
+ *
+ *  @param regNos   Register numbers to read
+ *  @param count    Number of registers
+ *  @param data     Register values as 32-bit values in LITTLE-ENDIAN order
+ *
+ *  @return BDM_RC_OK               Success
+ *  @return BDM_RC_TARGET_BUSY      Register is inaccessible as processor is not in debug mode
+ *  @return BDM_RC_ARM_ACCESS_ERROR Failed access
+ */
+USBDM_ErrorCode readCoreRegisters(const uint8_t regNos[], unsigned count, uint8_t *data) {
+   USBDM_ErrorCode rc;
+
+   rc = writeSelect(ARM_AHB_AP_BANK0);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = update_ahb_ap_csw_defaultValue();
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = writeCsw(ahb_ap_csw_defaultValue|AHB_AP_CSW_SIZE_WORD);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   // BD0-BD3 => DHCSR, DCRSR, DCRDR, DEMCR
+   rc = writeTar(DHCSR_ADDR);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   rc = writeSelect(ARM_AHB_AP_BANK1);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   while (count-- > 0) {
+      uint32_t dhcsrValue;
+      uint32_t regValue;
+
+      // Start register transfer
+      rc = writeReg(SWD_WR_AHB_BD_DCRSR, DCRSR_READ|*regNos++);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      // Initiate DHCSR read (dummy data)
+      rc = readReg(SWD_RD_AHB_BD_DHCSR, dhcsrValue);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      // Initiate DCRDR read and collect DHCSR
+      rc = readReg(SWD_RD_AHB_BD_DCRDR, dhcsrValue);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      // Collect DCRDR
+      rc = readReg(SWD_RD_DP_RDBUFF, regValue);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      if ((dhcsrValue & DHCSR_C_HALT) == 0) {
+         // Target must be in DEBUG mode
+         return BDM_RC_TARGET_BUSY;
+      }
+      if ((dhcsrValue & DHCSR_S_REGRDY) == 0) {
+         // Slow target - transfer had not completed before DCRDR was read
+         int retryCount = 40;
+         do {
+            if (retryCount-- == 0) {
+               // Assume target busy
+               return BDM_RC_ARM_ACCESS_ERROR;
+            }
+            rc = readReg(SWD_RD_AHB_BD_DHCSR, dhcsrValue);
+            if (rc != BDM_RC_OK) {
+               return rc;
+            }
+            rc = readReg(SWD_RD_DP_RDBUFF, dhcsrValue);
+            if (rc != BDM_RC_OK) {
+               return rc;
+            }
+         } while ((dhcsrValue & DHCSR_S_REGRDY) == 0);
+         // Re-read DCRDR
+         rc = readReg(SWD_RD_AHB_BD_DCRDR, regValue);
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+         rc = readReg(SWD_RD_DP_RDBUFF, regValue);
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+      }
+      // Save value (target format - LITTLE-ENDIAN ARM)
+      unpack32LE(regValue, data);
+      data += 4;
+   }
+   return BDM_RC_OK;
+}
+
 /**
  *  Write ARM-SWD core register
  *
@@ -1441,4 +2568,42 @@ USBDM_ErrorCode modifyDHCSR(uint8_t preserveBits, uint8_t setBits) {
    return writeMemoryWord(DHCSR_ADDR, debugStepValue);
 }
 
+/** DHCSR sticky bits cleared by pollDHCSR() and not yet returned to the host */
+static uint32_t latchedDhcsr = 0;
+
+/**
+ *  Read DHCSR for background polling\n
+ *  The sticky S_RESET_ST and S_RETIRE_ST bits are cleared by the read so they are
+ *  latched until returned to the host by mergeLatchedDHCSR()
+ *
+ *  @param dhcsr  Value read
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode pollDHCSR(uint32_t &dhcsr) {
+   USBDM_ErrorCode rc = readMemoryWord(DHCSR_ADDR, dhcsr);
+   if (rc == BDM_RC_OK) {
+      latchedDhcsr |= dhcsr&(DHCSR_S_RESET_ST|DHCSR_S_RETIRE_ST);
+   }
+   return rc;
+}
+
+/**
+ *  Merge DHCSR sticky bits latched by pollDHCSR() into memory read by the host\n
+ *  The latched bits are cleared once returned
+ *
+ *  @param address  Start address of memory read
+ *  @param count    Number of bytes read
+ *  @param data     Data read (LITTLE-ENDIAN order)
+ */
+void mergeLatchedDHCSR(uint32_t address, uint32_t count, uint8_t *data) {
+   // Sticky bits are all in the most significant byte
+   constexpr uint32_t stickyAddress = DHCSR_ADDR+3;
+   if ((latchedDhcsr == 0) || (address > stickyAddress) || ((stickyAddress-address) >= count)) {
+      return;
+   }
+   data[stickyAddress-address] |= (uint8_t)(latchedDhcsr>>24);
+   latchedDhcsr = 0;
+}
+
 }; // End namespace Swd
@@ -86,6 +86,33 @@ static constexpr uint32_t  DHCSR_C_STEP            = (1<<2);
 static constexpr uint32_t  DHCSR_C_HALT            = (1<<1);
 static constexpr uint32_t  DHCSR_C_DEBUGEN         = (1<<0);
 
+/**
+ * Statistics for pipelined memory block reads
+ */
+struct BlockReadStatistics {
+   uint32_t bytes;      //!< Number of data bytes transferred
+   uint32_t swdClocks;  //!< Number of SWD clocks used
+   uint32_t ticks;      //!< Elapsed time in processor clock ticks
+};
+
+/**
+ * Counters for individual SWD register transactions (readReg()/writeReg())
+ *
+ * @note swdClocks and pushrWrites are accumulated from the fixed cost of each
+ *       low-level routine called.  They are not measured from the SPI hardware.
+ */
+struct TransactionStatistics {
+   uint32_t reads;         //!< Number of read transactions
+   uint32_t writes;        //!< Number of write transactions
+   uint32_t waits;         //!< Number of WAIT responses (each causes a retry)
+   uint32_t faults;        //!< Number of FAULT responses
+   uint32_t noResponses;   //!< Number of missing or invalid ACK responses
+   uint32_t parityErrors;  //!< Number of parity errors on read data
+   uint32_t swdClocks;     //!< Number of SWD clocks used including idle bits
+   uint32_t pushrWrites;   //!< Number of SPI.PUSHR writes (tallied per routine called)
+   uint32_t reconnects;    //!< Number of line resets/re-connects (connect())
+};
+
 /**
  * Set pin state
  *
@@ -122,6 +149,19 @@ constexpr uint32_t pack16AddressBE(const uint8_t data[2]) {
  */
 USBDM_ErrorCode setSpeed(uint32_t frequency);
 
+/**
+ * Automatically determine SWD speed\n
+ * Each candidate speed is verified by reading IDCODE and a pattern test of AHB-AP.TAR.\n
+ * The result is remembered for the target (by DP IDCODE) so later auto-tuning is quick.
+ *
+ * @return
+ *    == \ref BDM_RC_OK => Success \n
+ *    != \ref BDM_RC_OK => No working speed found
+ *
+ * @note An auto-tuned speed is automatically reduced on repeated parity errors
+ */
+USBDM_ErrorCode autoTuneSpeed();
+
 /**
  * Gets Communication speed of SWD
  *
@@ -371,6 +411,70 @@ USBDM_ErrorCode clearStickyBits(void);
  */
 USBDM_ErrorCode abortAP(void);
 
+/**
+ * Invalidate cached DP.SELECT, AHB-AP.CSW and AHB-AP.TAR values\n
+ * These registers will be re-written on next use
+ *
+ * @note This is done automatically on connect, line reset, abort and errors.\n
+ *       It is only needed if the target debug interface may have been reset by other means.
+ */
+void invalidateCachedState();
+
+/** Maximum number of transactions in the SWD transaction queue */
+static constexpr unsigned SWD_QUEUE_SIZE = 32;
+
+/**
+ * Clear SWD transaction queue
+ */
+void queueClear();
+
+/**
+ * Add DP/AP read to SWD transaction queue
+ *
+ * @param command SWD command byte to select register etc.
+ * @param data    Where to place the 32-bit value read when the queue is executed
+ *
+ * @return
+ *    == \ref BDM_RC_OK             => Success \n
+ *    == \ref BDM_RC_ILLEGAL_PARAMS => Queue is full
+ *
+ * @note Data returned depends on register (some responses are pipelined) - see readReg()
+ */
+USBDM_ErrorCode queueRead(uint8_t command, uint32_t *data);
+
+/**
+ * Add DP/AP write to SWD transaction queue
+ *
+ * @param command SWD command byte to select register etc.
+ * @param data    32-bit value to write
+ *
+ * @return
+ *    == \ref BDM_RC_OK             => Success \n
+ *    == \ref BDM_RC_ILLEGAL_PARAMS => Queue is full
+ */
+USBDM_ErrorCode queueWrite(uint8_t command, uint32_t data);
+
+/**
+ * Execute SWD transaction queue\n
+ * Runs of consecutive writes are transferred using DMA.  Reads are done individually.\n
+ * Read values are written to the locations given when queued.\n
+ * The queue is cleared.
+ *
+ * @param completed Number of transactions that completed successfully.\n
+ *                  Transactions after this were not accepted by the target.\n
+ *                  On a FAULT the preceding transaction is not counted (AP writes are posted).
+ *
+ * @return
+ *    == \ref BDM_RC_OK               => Success        \n
+ *    == \ref BDM_RC_ARM_FAULT_ERROR  => FAULT response from target \n
+ *    == \ref BDM_RC_ACK_TIMEOUT      => WAIT response from target \n
+ *    == \ref BDM_RC_NO_CONNECTION    => Unexpected/no response from target \n
+ *    == \ref BDM_RC_ARM_PARITY_ERROR => Parity error on data read
+ *
+ * @note The processor sleeps while the transfer is in progress.  Interrupts (USB etc) are still serviced.
+ */
+USBDM_ErrorCode queueExecute(unsigned &completed);
+
 /**
  * Mass erase target
  *
@@ -493,6 +597,42 @@ USBDM_ErrorCode writeMemory(
       const uint8_t  *data_ptr     // Where the data is
 );
 
+/**
+ * Get statistics for pipelined memory reads
+ *
+ * @param statistics Accumulated statistics
+ * @param clear      Clear statistics after obtaining them
+ *
+ * @note Throughput (bytes/s) = bytes * SystemCoreClock / ticks \n
+ *       Efficiency (bytes/clock) = bytes / swdClocks
+ */
+void getBlockReadStatistics(BlockReadStatistics &statistics, bool clear=false);
+
+/**
+ * Check pipelined memory read against individual word reads
+ *
+ * @param addr           Address of block (word aligned)
+ * @param count          Number of bytes (multiple of 4)
+ * @param buffer         Buffer of count bytes for the pipelined read
+ * @param mismatches     Number of words that differ
+ * @param firstMismatch  Byte offset of first word that differs (count if none)
+ *
+ * @return
+ *   == \ref BDM_RC_OK => success         \n
+ *   != \ref BDM_RC_OK => various errors
+ */
+USBDM_ErrorCode checkBlockRead(uint32_t addr, unsigned count, uint8_t *buffer, unsigned &mismatches, unsigned &firstMismatch);
+
+/**
+ * Get statistics for individual register transactions
+ *
+ * @param statistics Accumulated statistics
+ * @param clear      Clear statistics after obtaining them
+ *
+ * @note Overhead (clocks/transaction) = swdClocks / (reads + writes)
+ */
+void getTransactionStatistics(TransactionStatistics &statistics, bool clear=false);
+
 /**
  *  Read target register
  *
@@ -503,6 +643,21 @@ USBDM_ErrorCode writeMemory(
  */
 USBDM_ErrorCode readCoreRegister(uint8_t regNo, uint8_t *data);
 
+/**
+ *  Read multiple core registers\n
+ *  The AHB-AP is set up once and registers are accessed through the banked data registers
+ *
+ *  @param regNos   Register numbers to read
+ *  @param count    Number of registers
+ *  @param data     Where to place register values (each 32-bits in LITTLE-ENDIAN order)
+ *
+ *  @return
+ *     == \ref BDM_RC_OK               => Success \n
+ *     == \ref BDM_RC_TARGET_BUSY      => Register is inaccessible as processor is not in debug mode \n
+ *     == \ref BDM_RC_ARM_ACCESS_ERROR => Failed access
+ */
+USBDM_ErrorCode readCoreRegisters(const uint8_t regNos[], unsigned count, uint8_t *data);
+
 /**
  *  Write ARM-SWD core register
  *
@@ -529,6 +684,29 @@ USBDM_ErrorCode writeCoreReg(uint32_t regNo, uint8_t *data);
  */
 USBDM_ErrorCode modifyDHCSR(uint8_t preserveBits, uint8_t setBits);
 
+/**
+ *  ARM-SWD -  Read DHCSR for background polling\n
+ *  The sticky S_RESET_ST and S_RETIRE_ST bits are cleared by the read so they are
+ *  latched until returned to the host by mergeLatchedDHCSR()
+ *
+ *  @param dhcsr  Value read
+ *
+ *  @return
+ *     == \ref BDM_RC_OK => success       \n
+ *     != \ref BDM_RC_OK => error         \n
+ */
+USBDM_ErrorCode pollDHCSR(uint32_t &dhcsr);
+
+/**
+ *  ARM-SWD -  Merge DHCSR sticky bits latched by pollDHCSR() into memory read by the host\n
+ *  The latched bits are cleared once returned
+ *
+ *  @param address  Start address of memory read
+ *  @param count    Number of bytes read
+ *  @param data     Data read (LITTLE-ENDIAN order)
+ */
+void mergeLatchedDHCSR(uint32_t address, uint32_t count, uint8_t *data);
+
 }; // End namespace Swd
 
 #endif /* INCLUDE_SWD_H_ */
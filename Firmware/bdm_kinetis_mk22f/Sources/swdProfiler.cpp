@@ -0,0 +1,191 @@
+/** \file
+    \brief ARM-SWD PC-sampling profiler
+
+   The target PC is sampled through the DWT Program Counter Sample Register
+   using non-halting AHB-AP reads. Samples are accumulated into a histogram
+   of fixed size bins covering an address range so only the aggregated
+   result needs to be uploaded.
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+#include "delay.h"
+#include "commands.h"
+#include "swd.h"
+#include "swdProfiler.h"
+
+namespace Swd {
+
+static constexpr uint32_t  DEMCR_ADDR     = 0xE000EDFCU; // RW Debug Exception and Monitor Control Register
+static constexpr uint32_t  DEMCR_TRCENA   = (1<<24);     // Enable DWT & ITM
+static constexpr uint32_t  DWT_PCSR_ADDR  = 0xE000101CU; // RO DWT Program Counter Sample Register
+
+/** PCSR value when core is halted or not executing */
+static constexpr uint32_t  PCSR_IDLE      = 0xFFFFFFFFU;
+
+/** Histogram bins */
+static uint32_t bins[PROFILE_MAX_BINS];
+
+/** Start of profiled range */
+static uint32_t profileStart;
+
+/** log2(bytes per bin) */
+static unsigned profileShift;
+
+/** Number of bins in use */
+static unsigned profileBins;
+
+/** Sample totals */
+static uint32_t totalSamples;
+static uint32_t outsideSamples;
+static uint32_t idleSamples;
+
+/**
+ *  Increment counter without wrapping
+ *
+ *  @param counter Counter to increment
+ */
+static inline void increment(uint32_t &counter) {
+   if (counter != 0xFFFFFFFFU) {
+      counter++;
+   }
+}
+
+/**
+ *  Set up profiler and clear histogram
+ *
+ *  @param startAddress Start of profiled address range
+ *  @param binShift     log2(bytes per bin)
+ *  @param numBins      Number of bins (<= PROFILE_MAX_BINS)
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode profileSetup(uint32_t startAddress, unsigned binShift, unsigned numBins) {
+   if ((numBins == 0) || (numBins > PROFILE_MAX_BINS) || (binShift > 31)) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   profileStart   = startAddress;
+   profileShift   = binShift;
+   profileBins    = numBins;
+   totalSamples   = 0;
+   outsideSamples = 0;
+   idleSamples    = 0;
+   for (unsigned index=0; index<numBins; index++) {
+      bins[index] = 0;
+   }
+   // PCSR reads as zero unless the DWT is enabled
+   uint32_t demcr;
+   USBDM_ErrorCode rc = readMemoryWord(DEMCR_ADDR, demcr);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   if ((demcr&DEMCR_TRCENA) == 0) {
+      rc = writeMemoryWord(DEMCR_ADDR, demcr|DEMCR_TRCENA);
+   }
+   return rc;
+}
+
+/**
+ *  Sample target PC through DWT_PCSR and accumulate in histogram
+ *
+ *  @param numSamples   Number of samples to take
+ *  @param intervalUs   Interval between samples in microseconds
+ *  @param samplesTaken Number of samples actually taken
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode profileSample(uint32_t numSamples, uint32_t intervalUs, uint32_t &samplesTaken) {
+   samplesTaken = 0;
+   if (profileBins == 0) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   // Command loop is blocked while sampling - don't exceed host command timeout
+   if (((uint64_t)numSamples*((uint64_t)intervalUs+PROFILE_SAMPLE_COST_us)) > PROFILE_MAX_SAMPLE_us) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   while (samplesTaken < numSamples) {
+      uint32_t pc;
+      USBDM_ErrorCode rc = readMemoryWord(DWT_PCSR_ADDR, pc);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      samplesTaken++;
+      increment(totalSamples);
+      if (pc == PCSR_IDLE) {
+         increment(idleSamples);
+      }
+      else {
+         // Offsets below start wrap to large values and are rejected by the range check
+         uint32_t bin = (pc-profileStart)>>profileShift;
+         if (bin < profileBins) {
+            increment(bins[bin]);
+         }
+         else {
+            increment(outsideSamples);
+         }
+      }
+      if (intervalUs != 0) {
+         USBDM::waitUS(intervalUs);
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ *  Get summary of histogram
+ *
+ *  @param summary Summary information
+ */
+void profileGetSummary(ProfileSummary &summary) {
+   summary.totalSamples   = totalSamples;
+   summary.outsideSamples = outsideSamples;
+   summary.idleSamples    = idleSamples;
+   summary.maxCount       = 0;
+   summary.maxBin         = 0;
+   summary.numBins        = profileBins;
+   for (unsigned index=0; index<profileBins; index++) {
+      if (bins[index] > summary.maxCount) {
+         summary.maxCount = bins[index];
+         summary.maxBin   = index;
+      }
+   }
+}
+
+/**
+ *  Read histogram bins
+ *
+ *  @param firstBin  Index of first bin to read
+ *  @param count     Number of bins to read
+ *  @param data      Where to place bin counts (each 32-bits in BIG-ENDIAN order)
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+USBDM_ErrorCode profileReadBins(unsigned firstBin, unsigned count, uint8_t *data) {
+   if ((firstBin+count) > profileBins) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   for (unsigned index=firstBin; index<(firstBin+count); index++) {
+      unpack32BE(bins[index], data);
+      data += 4;
+   }
+   return BDM_RC_OK;
+}
+
+}; // End namespace Swd
@@ -0,0 +1,113 @@
+/** \file
+    \brief ARM-SWD PC-sampling profiler
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+
+#ifndef INCLUDE_SWDPROFILER_H_
+#define INCLUDE_SWDPROFILER_H_
+
+#include <stdint.h>
+#include "commands.h"
+
+namespace Swd {
+
+/** Maximum number of histogram bins */
+static constexpr unsigned PROFILE_MAX_BINS = 1024;
+
+/**
+ * Maximum duration of a single PROFILE_SAMPLE request (us)\n
+ * Kept below FLASH_ALGORITHM_TIMEOUT_ms as the host must already wait that long for a command
+ */
+static constexpr uint32_t PROFILE_MAX_SAMPLE_us = 1000000;
+
+/**
+ * Minimum time taken by each sample (us)\n
+ * Estimate from the 4 SWD transactions of readMemoryWord() at the fastest SWD clock (not measured)
+ */
+static constexpr uint32_t PROFILE_SAMPLE_COST_us = 20;
+
+/** Summary of profile histogram */
+struct ProfileSummary {
+   uint32_t totalSamples;    //!< Number of samples taken
+   uint32_t outsideSamples;  //!< Samples with PC outside profiled range
+   uint32_t idleSamples;     //!< Samples while core halted or sleeping (PCSR = 0xFFFFFFFF)
+   uint32_t maxCount;        //!< Largest bin count
+   uint16_t maxBin;          //!< Index of largest bin
+   uint16_t numBins;         //!< Number of bins in use
+};
+
+/**
+ *  Set up profiler and clear histogram
+ *
+ *  Bin N counts samples with (startAddress + N<<binShift) <= PC < (startAddress + (N+1)<<binShift)
+ *
+ *  @param startAddress Start of profiled address range
+ *  @param binShift     log2(bytes per bin)
+ *  @param numBins      Number of bins (<= PROFILE_MAX_BINS)
+ *
+ *  @return
+ *   == \ref BDM_RC_OK => success         \n
+ *   != \ref BDM_RC_OK => various errors
+ *
+ *  @note Enables the DWT in the target (DEMCR.TRCENA)
+ */
+USBDM_ErrorCode profileSetup(uint32_t startAddress, unsigned binShift, unsigned numBins);
+
+/**
+ *  Sample target PC through DWT_PCSR and accumulate in histogram
+ *
+ *  @param numSamples   Number of samples to take
+ *  @param intervalUs   Interval between samples in microseconds
+ *  @param samplesTaken Number of samples actually taken
+ *
+ *  @return
+ *   == \ref BDM_RC_OK => success         \n
+ *   != \ref BDM_RC_OK => various errors
+ *
+ *  @note The target is not halted
+ *  @note Requests that would take longer than PROFILE_MAX_SAMPLE_us are rejected with BDM_RC_ILLEGAL_PARAMS
+ */
+USBDM_ErrorCode profileSample(uint32_t numSamples, uint32_t intervalUs, uint32_t &samplesTaken);
+
+/**
+ *  Get summary of histogram
+ *
+ *  @param summary Summary information
+ */
+void profileGetSummary(ProfileSummary &summary);
+
+/**
+ *  Read histogram bins
+ *
+ *  @param firstBin  Index of first bin to read
+ *  @param count     Number of bins to read
+ *  @param data      Where to place bin counts (each 32-bits in BIG-ENDIAN order)
+ *
+ *  @return
+ *   == \ref BDM_RC_OK             => success         \n
+ *   == \ref BDM_RC_ILLEGAL_PARAMS => Range outside histogram
+ */
+USBDM_ErrorCode profileReadBins(unsigned firstBin, unsigned count, uint8_t *data);
+
+}; // End namespace Swd
+
+#endif /* INCLUDE_SWDPROFILER_H_ */
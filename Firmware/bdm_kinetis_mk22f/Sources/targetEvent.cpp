@@ -0,0 +1,173 @@
+/** \file
+    \brief Asynchronous target event notification
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+#include "hardware.h"
+#include "usb.h"
+#include "commands.h"
+#include "targetDefines.h"
+#include "cmdProcessing.h"
+#include "swd.h"
+#include "bdm.h"
+#include "targetEvent.h"
+
+/** Time of last poll (probe cycle counter) */
+static uint32_t lastPoll;
+
+/** Target type the saved state applies to */
+static TargetType_t lastTargetType = T_OFF;
+
+/** Target was halted at last poll */
+static bool lastHalted;
+
+/** State of last poll is valid */
+static bool lastValid;
+
+/** Reset was flagged at last poll */
+static bool lastReset;
+
+/** Notification waiting for the end-point */
+static uint8_t pendingEvent[TARGET_EVENT_SIZE];
+
+/** A notification is waiting for the end-point */
+static bool eventPending;
+
+/** Sequence number of notifications */
+static uint16_t eventSequence;
+
+/**
+ *  Read target run state
+ *
+ *  @param halted  Set true if target is halted
+ *  @param reset   Set true if target has been reset (ARM - since last read)
+ *  @param status  Raw status value (DHCSR or BDM status register)
+ *
+ *  @return BDM_RC_OK => success, error otherwise
+ */
+static USBDM_ErrorCode readTargetState(bool &halted, bool &reset, uint32_t &status) {
+   reset = false;
+   switch(cable_status.target_type) {
+#if (TARGET_CAPABILITY&CAP_ARM_SWD)
+      case T_ARM:
+      case T_ARM_SWD: {
+         // Sticky bits cleared by this read are kept for the host
+         USBDM_ErrorCode rc = Swd::pollDHCSR(status);
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+         halted = (status&Swd::DHCSR_S_HALT) != 0;
+         reset  = (status&Swd::DHCSR_S_RESET_ST) != 0;
+         return BDM_RC_OK;
+      }
+#endif
+      case T_HC12:
+      case T_HCS08:
+      case T_RS08:
+      case T_S12Z:
+      case T_CFV1: {
+         if (cable_status.speed == SPEED_NO_INFO) {
+            // Not connected
+            return BDM_RC_NO_CONNECTION;
+         }
+         uint8_t bdmStatus;
+         USBDM_ErrorCode rc = Bdm::readBDMStatus(&bdmStatus);
+         if (rc != BDM_RC_OK) {
+            return rc;
+         }
+         status = bdmStatus;
+         if (cable_status.target_type == T_CFV1) {
+            halted = (bdmStatus&CFV1_XCSR_HALT) != 0;
+         }
+         else {
+            // BDMACT (HCS08/RS08/HCS12) and ACTIVE (S12Z) are the same bit
+            halted = (bdmStatus&HC08_BDCSCR_BDMACT) != 0;
+         }
+         return BDM_RC_OK;
+      }
+      default:
+         return BDM_RC_ILLEGAL_COMMAND;
+   }
+}
+
+/**
+ *  Poll target state and queue a notification if it has changed\n
+ *  Called while the probe is waiting for commands
+ *
+ *  @note Only does target I/O between commands so never interleaves with command processing
+ */
+void targetEventPoll() {
+   if (!bdm_option.notifyTargetEvents) {
+      lastValid    = false;
+      eventPending = false;
+      return;
+   }
+   if (eventPending && USBDM::UsbImplementation::sendEventData(pendingEvent, sizeof(pendingEvent))) {
+      eventPending = false;
+   }
+   uint32_t now = DWT->CYCCNT;
+   if ((now-lastPoll) < (SystemCoreClock/1000000)*TARGET_EVENT_POLL_US) {
+      return;
+   }
+   lastPoll = now;
+
+   if (cable_status.target_type != lastTargetType) {
+      // Target changed - establish new baseline without reporting
+      lastTargetType = cable_status.target_type;
+      lastValid      = false;
+   }
+   bool     halted;
+   bool     reset;
+   uint32_t status;
+   if (readTargetState(halted, reset, status) != BDM_RC_OK) {
+      // Target not accessible - report state again when it is
+      lastValid = false;
+      return;
+   }
+   // External reset is also detected by the reset sense input
+   bool resetFlagged = (cable_status.reset == RESET_DETECTED);
+   if (resetFlagged && !lastReset) {
+      reset = true;
+   }
+   lastReset = resetFlagged;
+
+   uint8_t events = 0;
+   if (reset) {
+      events |= TARGET_EVENT_RESET;
+   }
+   if (lastValid && (halted != lastHalted)) {
+      events |= halted?TARGET_EVENT_HALTED:TARGET_EVENT_RUNNING;
+   }
+   lastHalted = halted;
+   lastValid  = true;
+   if (events == 0) {
+      return;
+   }
+   if (eventPending) {
+      // Host hasn't collected previous notification - accumulate
+      events |= pendingEvent[0];
+   }
+   pendingEvent[0] = events;
+   pendingEvent[1] = cable_status.target_type;
+   unpack32BE(status, pendingEvent+2);
+   unpack16BE(++eventSequence, pendingEvent+6);
+   eventPending = !USBDM::UsbImplementation::sendEventData(pendingEvent, sizeof(pendingEvent));
+}
@@ -0,0 +1,52 @@
+/** \file
+    \brief Asynchronous target event notification
+
+   While the probe is idle the target run state is polled (DHCSR for ARM-SWD,
+   BDM status register for HCS/CFV1) and changes are reported to the host on
+   the event interrupt IN end-point. This removes the need for the host to poll
+   CMD_USBDM_GET_BDM_STATUS / CMD_USBDM_READ_STATUS_REG to detect breakpoints.
+
+   Polling is enabled by BDM option notifyTargetEvents (CMD_USBDM_SET_OPTIONS).
+
+   \verbatim
+
+   USBDM
+   Copyright (C) 2016  Peter O'Donoghue
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+   \endverbatim
+ */
+
+#ifndef INCLUDE_TARGETEVENT_H_
+#define INCLUDE_TARGETEVENT_H_
+
+#include <stdint.h>
+#include "commands.h"
+
+/** Interval between target status polls in microseconds */
+static constexpr unsigned TARGET_EVENT_POLL_US = 1000;
+
+/** Size of event notification in bytes */
+static constexpr unsigned TARGET_EVENT_SIZE = 8;
+
+/**
+ *  Poll target state and queue a notification if it has changed\n
+ *  Called while the probe is waiting for commands
+ *
+ *  @note Only does target I/O between commands so never interleaves with command processing
+ */
+void targetEventPoll();
+
+#endif /* INCLUDE_TARGETEVENT_H_ */
@@ -12,18 +12,161 @@
 #include "pin_mapping.h"
 #include "uart.h"
 #include "usb_defs.h"
-#include "queue.h"
 #include "usb.h"
 
 namespace USBDM {
 
-template<class UartInfo>
+/** DMA channel used for UART receive (UART.D -> rxBuffer) */
+static constexpr unsigned CDC_UART_RX_DMA_CHANNEL = 5;
+
+/** DMA channel used for UART transmit (txBuffer -> UART.D) */
+static constexpr unsigned CDC_UART_TX_DMA_CHANNEL = 6;
+
+/**
+ * USB-UART bridge
+ *
+ * Received and transmitted data is moved between the UART and
+ * ring buffers by DMA.  The buffers use DMA modulo addressing so a single
+ * major loop may wrap around the buffer.
+ *
+ *  - Rx DMA is started for the free space in rxBuffer and stops when it is full.
+ *    The UART then asserts RTS (if enabled) once its FIFO fills.
+ *  - Tx DMA is started for the data available in txBuffer.
+ *    The UART waits on CTS (if enabled) before each character.
+ *
+ * @tparam UartInfo        Class describing UART hardware
+ * @tparam rxDmaSlot       DMAMUX slot for UART receive
+ * @tparam txDmaSlot       DMAMUX slot for UART transmit
+ * @tparam useFlowControl  Enable RTS/CTS hardware flow control
+ */
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl=true>
 class CdcUart {
+public:
+   /** Size of receive buffer - must be a power of 2 for DMA modulo addressing */
+   static constexpr unsigned RX_BUFFER_SIZE = 1024;
+
+   /** Size of transmit buffer - must be a power of 2 for DMA modulo addressing */
+   static constexpr unsigned TX_BUFFER_SIZE = 1024;
+
 private:
+   static_assert((RX_BUFFER_SIZE&(RX_BUFFER_SIZE-1)) == 0, "RX_BUFFER_SIZE must be a power of 2");
+   static_assert((TX_BUFFER_SIZE&(TX_BUFFER_SIZE-1)) == 0, "TX_BUFFER_SIZE must be a power of 2");
+
    static uint8_t             cdcStatus;
    static LineCodingStructure lineCoding;
    static uint8_t             breakCount;
-   static bool              (*inCallback)(uint8_t);
+
+   /** Receive ring buffer - written by DMA */
+   static uint8_t  rxBuffer[RX_BUFFER_SIZE];
+   static unsigned rxHead;       //!< Total bytes written by completed Rx DMA
+   static unsigned rxTail;       //!< Total bytes read from rxBuffer
+   static unsigned rxDmaCount;   //!< Size of current Rx DMA transfer (0 => idle)
+
+   /** Transmit ring buffer - read by DMA */
+   static uint8_t  txBuffer[TX_BUFFER_SIZE];
+   static unsigned txHead;       //!< Total bytes written to txBuffer
+   static unsigned txTail;       //!< Total bytes read by completed Tx DMA
+   static unsigned txDmaCount;   //!< Size of current Tx DMA transfer (0 => idle)
+
+   /** Indicates UART and DMA have been configured by setLineCoding() */
+   static bool     configured;
+
+   /**
+    * Get number of address bits for buffer size for DMA modulo addressing
+    *
+    * @param size Buffer size (power of 2)
+    *
+    * @return Number of bits
+    */
+   static constexpr unsigned moduloBits(unsigned size) {
+      return (size<=1)?0:1+moduloBits(size/2);
+   }
+
+   /**
+    * Start Rx DMA for the free space in rxBuffer
+    *
+    * @note Must be called with interrupts disabled
+    */
+   static void startRxDma() {
+      unsigned count = RX_BUFFER_SIZE-(rxHead-rxTail);
+      if (!configured || (rxDmaCount != 0) || (count == 0)) {
+         // Not configured, busy or no space
+         return;
+      }
+      // DADDR continues from last transfer (modulo addressing)
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(count);
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(count);
+      rxDmaCount = count;
+      DMA0->SERQ = DMA_SERQ_SERQ(CDC_UART_RX_DMA_CHANNEL);
+   }
+
+   /**
+    * Start Tx DMA for the data available in txBuffer
+    *
+    * @note Must be called with interrupts disabled
+    */
+   static void startTxDma() {
+      unsigned count = txHead-txTail;
+      if (!configured || (txDmaCount != 0) || (count == 0)) {
+         // Not configured, busy or no data
+         return;
+      }
+      // SADDR continues from last transfer (modulo addressing)
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(count);
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(count);
+      txDmaCount = count;
+      DMA0->SERQ = DMA_SERQ_SERQ(CDC_UART_TX_DMA_CHANNEL);
+   }
+
+   /**
+    * Configure DMA channels for UART
+    *
+    * Rx : UART.D -> rxBuffer, 1 byte per request
+    * Tx : txBuffer -> UART.D, 1 byte per request
+    */
+   static void initialiseDma() {
+      SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+      SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+      DMA0->CERQ = DMA_CERQ_CERQ(CDC_UART_RX_DMA_CHANNEL);
+      DMA0->CERQ = DMA_CERQ_CERQ(CDC_UART_TX_DMA_CHANNEL);
+
+      // UART.D -> rxBuffer
+      DMAMUX0->CHCFG[CDC_UART_RX_DMA_CHANNEL] = 0;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].SADDR          = (uint32_t)&UartInfo::uart->D;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].SOFF           = 0;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].ATTR           = DMA_ATTR_SSIZE(0)|DMA_ATTR_DSIZE(0)|DMA_ATTR_DMOD(moduloBits(RX_BUFFER_SIZE));
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].NBYTES_MLNO    = 1;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].SLAST          = 0;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].DADDR          = (uint32_t)rxBuffer;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].DOFF           = 1;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].DLASTSGA       = 0;
+      DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].CSR            = DMA_CSR_DREQ_MASK|DMA_CSR_INTMAJOR_MASK;
+      DMAMUX0->CHCFG[CDC_UART_RX_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(rxDmaSlot);
+
+      // txBuffer -> UART.D
+      DMAMUX0->CHCFG[CDC_UART_TX_DMA_CHANNEL] = 0;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].SADDR          = (uint32_t)txBuffer;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].SOFF           = 1;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].ATTR           = DMA_ATTR_SSIZE(0)|DMA_ATTR_DSIZE(0)|DMA_ATTR_SMOD(moduloBits(TX_BUFFER_SIZE));
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].NBYTES_MLNO    = 1;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].SLAST          = 0;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].DADDR          = (uint32_t)&UartInfo::uart->D;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].DOFF           = 0;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].DLASTSGA       = 0;
+      DMA0->TCD[CDC_UART_TX_DMA_CHANNEL].CSR            = DMA_CSR_DREQ_MASK|DMA_CSR_INTMAJOR_MASK;
+      DMAMUX0->CHCFG[CDC_UART_TX_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(txDmaSlot);
+
+      rxHead     = 0;
+      rxTail     = 0;
+      rxDmaCount = 0;
+      txHead     = 0;
+      txTail     = 0;
+      txDmaCount = 0;
+
+      NVIC_EnableIRQ((IRQn_Type)(DMA0_IRQn+CDC_UART_RX_DMA_CHANNEL));
+      NVIC_EnableIRQ((IRQn_Type)(DMA0_IRQn+CDC_UART_TX_DMA_CHANNEL));
+   }
 
 public:
    static constexpr uint8_t CDC_STATE_DCD_MASK        = 1<<0;
@@ -39,37 +182,100 @@ public:
    static constexpr uint8_t CDC_LINE_CONTROL_RTS_MASK = 1<<1;
 
    /**
-    * Set callback to handle received characters
+    * Get free space in transmit buffer
     *
-    * @param callback Call-back to execute when a serial character is received
+    * @return Number of bytes that may be written by putData()
     */
-   static void setInCallback(bool (*callback)(uint8_t)) {
-      inCallback = callback;
+   static unsigned getTxFree() {
+      return TX_BUFFER_SIZE-(txHead-txTail);
    }
-   
-   /** Queue of outgoing characters */
-   static Queue<100> outQueue;
 
    /**
-    * Write character to output queue
+    * Write data to transmit buffer and start transmission
     *
-    * @param ch Character to write
+    * @param data Data to write
+    * @param size Number of bytes to write
     *
-    * @return true => success, false => overrun or similar error
+    * @return true => success, false => overrun (no data written)
     *
-    * @note The Overrun flag is set on write to full queue
+    * @note The Overrun flag is set on write to full buffer
     */
-   static bool putChar(uint8_t ch) {
-      if (outQueue.isFull()) {
+   static bool putData(const uint8_t *data, unsigned size) {
+      if (size > getTxFree()) {
          cdcStatus |= UART_S1_OR_MASK;
          return false;
       }
-      outQueue.enQueue(ch);
-      // Restart Transmit IRQ
-      UartInfo::uart->C2 |= UART_C2_TIE_MASK;
+      unsigned head = txHead;
+      while (size-- > 0) {
+         txBuffer[head++ & (TX_BUFFER_SIZE-1)] = *data++;
+      }
+      IrqProtect ip;
+      txHead = head;
+      startTxDma();
       return true;
    }
 
+   /**
+    * Get number of bytes available in receive buffer
+    *
+    * @return Number of bytes available
+    */
+   static unsigned getRxAvailable() {
+      IrqProtect ip;
+      unsigned count = rxHead-rxTail;
+      if (rxDmaCount != 0) {
+         // Add bytes from transfer in progress
+         count += rxDmaCount-DMA0->TCD[CDC_UART_RX_DMA_CHANNEL].CITER_ELINKNO;
+      }
+      return count;
+   }
+
+   /**
+    * Read data from receive buffer
+    *
+    * @param data    Buffer for data
+    * @param maxSize Size of buffer
+    *
+    * @return Number of bytes read
+    */
+   static unsigned getData(uint8_t *data, unsigned maxSize) {
+      unsigned count = getRxAvailable();
+      if (count > maxSize) {
+         count = maxSize;
+      }
+      unsigned tail = rxTail;
+      for (unsigned sub=0; sub<count; sub++) {
+         *data++ = rxBuffer[tail++ & (RX_BUFFER_SIZE-1)];
+      }
+      IrqProtect ip;
+      rxTail = tail;
+      // Restart Rx if stopped on full buffer
+      startRxDma();
+      return count;
+   }
+
+   /**
+    * Handler for Rx DMA complete interrupt\n
+    * Restarts DMA if space is available
+    */
+   static void rxDmaComplete() {
+      DMA0->CINT  = DMA_CINT_CINT(CDC_UART_RX_DMA_CHANNEL);
+      rxHead     += rxDmaCount;
+      rxDmaCount  = 0;
+      startRxDma();
+   }
+
+   /**
+    * Handler for Tx DMA complete interrupt\n
+    * Restarts DMA if data is available
+    */
+   static void txDmaComplete() {
+      DMA0->CINT  = DMA_CINT_CINT(CDC_UART_TX_DMA_CHANNEL);
+      txTail     += txDmaCount;
+      txDmaCount  = 0;
+      startTxDma();
+   }
+
    /**
     * Get state of serial interface
     *
@@ -113,25 +319,25 @@ public:
       uint8_t  UARTC1Value = 0x00;
       uint8_t  UARTC3Value = 0x00;
 
+      (void)memcpy(&lineCoding, lineCodingStructure, sizeof(LineCodingStructure));
+
       // Initialise UART and set baud rate
       Uart_T<UartInfo> uart(leToNative32(lineCoding.dwDTERate));
 
+      // Disable the transmitter and receiver while changing settings.
+      UartInfo::uart->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK );
+
       USBDM::UartIrq_T<UartInfo>::setCallback(uartCallback);
 
       cdcStatus  = CDC_STATE_CHANGE_MASK;
       breakCount = 0; // Clear any current BREAKs
 
-      (void)memcpy(&lineCoding, lineCodingStructure, sizeof(LineCodingStructure));
-
-      //! Note - for a 48MHz bus speed the useful baud range is ~300 to ~115200 for 0.5% error
-      //  230400 & 460800 have a 8.5% error
+      //! Note - UART1 is clocked from the core clock so baud rates to ~3Mbaud are available
+      //  with low error using the fractional divider
 
       // Configure pins
       UartInfo::initPCRs();
 
-      // Disable the transmitter and receiver while changing settings.
-      UartInfo::uart->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK );
-
       // Note: lineCoding.bCharFormat is ignored (always 1 stop bit)
       //   switch (lineCoding.bCharFormat) {
       //      case 0:  // 1 bits
@@ -174,9 +380,27 @@ public:
          default :
             break;
       }
+      // Discard any buffered data and reset DMA
+      initialiseDma();
+
       UartInfo::uart->C1 = UARTC1Value;
+
+      // Enable FIFOs (only changed while Tx/Rx disabled)
+      // DMA request for each received character
+      UartInfo::uart->PFIFO  = UART_PFIFO_TXFE_MASK|UART_PFIFO_RXFE_MASK;
+      UartInfo::uart->CFIFO  = UART_CFIFO_TXFLUSH_MASK|UART_CFIFO_RXFLUSH_MASK;
+      UartInfo::uart->RWFIFO = 1;
+      UartInfo::uart->TWFIFO = 0;
+
+      // RTS is negated when the Rx FIFO is not being emptied (rxBuffer full)
+      // Tx waits for CTS before each character
+      UartInfo::uart->MODEM  = useFlowControl?(UART_MODEM_RXRTSE_MASK|UART_MODEM_TXCTSE_MASK):0;
+
+      // Rx and Tx data use DMA, errors use interrupts
+      UartInfo::uart->C5 = UART_C5_RDMAS_MASK|UART_C5_TDMAS_MASK;
       UartInfo::uart->C2 =
-            UART_C2_RIE_MASK| // Receive interrupts (Transmit interrupts enabled when data written)
+            UART_C2_RIE_MASK| // Receive DMA requests
+            UART_C2_TIE_MASK| // Transmit DMA requests
             UART_C2_RE_MASK|  // Receiver enable
             UART_C2_TE_MASK;  // Transmitter enable
       UartInfo::uart->C3 = UARTC3Value|
@@ -185,7 +409,14 @@ public:
             UART_C3_ORIE_MASK| // Overrun error
             UART_C3_PEIE_MASK; // Parity error
 
-      NVIC_EnableIRQ(UartInfo::irqNums[0]);
+      {
+         IrqProtect ip;
+         configured = true;
+         startRxDma();
+      }
+      for (unsigned sub=0; sub<UartInfo::irqCount; sub++) {
+         NVIC_EnableIRQ(UartInfo::irqNums[sub]);
+      }
    }
 
    /**
@@ -204,18 +435,20 @@ public:
     *  - 0x0000 => End BREAK
     *  - 0xFFFF => Start indefinite BREAK
     *  - else   => Send a break of 10 chars
-
+    *
     * @note - only partially implemented
-    *       - breaks are sent after currently queued characters
+    *       - finite breaks are sent by poll() after currently queued characters
     */
    static void sendBreak(uint16_t length) {
       if (length == 0xFFFF) {
          // Send indefinite BREAKs
          breakCount = 0xFF;
+         UartInfo::uart->C2 |=  UART_C2_SBK_MASK;
       }
       else if (length == 0x0) {
          // Stop sending BREAKs
          breakCount = 0x00;
+         UartInfo::uart->C2 &= ~UART_C2_SBK_MASK;
       }
       else {
          // Queue a series of BREAKs
@@ -223,6 +456,21 @@ public:
       }
    }
 
+   /**
+    * Background processing for UART (called on USB SOF ~1ms)
+    *
+    *  - Queues BREAK characters once transmit data is complete
+    */
+   static void poll() {
+      if ((breakCount == 0) || (breakCount == 0xFF) || (txHead != txTail)) {
+         return;
+      }
+      // Queue another BREAK 'char'
+      UartInfo::uart->C2 |=  UART_C2_SBK_MASK;
+      UartInfo::uart->C2 &= ~UART_C2_SBK_MASK;
+      breakCount--;
+   }
+
    /**
     *  Set CDC Line values
     *
@@ -234,61 +482,51 @@ public:
    }
 
    /**
-    * Interrupt callback for UART
+    * Interrupt callback for UART\n
+    * Only errors cause interrupts - data is transferred by DMA
     */
    static void uartCallback(uint8_t status) {
-      if (status&UART_S1_RDRF_MASK) {
-         // Transfers a char from the UART_D to CDC-IN queue
-         if (!inCallback(UartInfo::uart->D)) {
-            cdcStatus |= UART_S1_OR_MASK;
-         }
-      }
-      else if (status&UART_S1_TDRE_MASK) {
-         //  Transfer a char from the CDC-OUT queue to UART_D
-         if (!outQueue.isEmpty()) {
-            UartInfo::uart->D = outQueue.deQueue(); // Send the char
-         }
-         else if (breakCount > 0) {
-            // Send another BREAK 'char'
-            UartInfo::uart->C2 |=  UART_C2_SBK_MASK;
-            UartInfo::uart->C2 &= ~UART_C2_SBK_MASK;
-            if (breakCount != 0xFF) {
-               breakCount--;
-            }
-         }
-         else {
-            // No characters available
-            // Disable further UART transmit interrupts
-            UartInfo::uart->C2 &= ~UART_C2_TIE_MASK;
-         }
+      // Record and clear error status
+      cdcStatus |= status&(UART_S1_FE_MASK|UART_S1_OR_MASK|UART_S1_PF_MASK|UART_S1_NF_MASK);
+      if (UartInfo::statusNeedsWrite) {
+         // Clear error flags
+         UartInfo::uart->S1 = 0xFF;
       }
       else {
-         // Record and clear error status
-         cdcStatus |= status;
-         if (UartInfo::statusNeedsWrite) {
-            // Clear error flags
-            UartInfo::uart->S1 = 0xFF;
-         }
-         else {
-            // Reading data clears flags
-            (void)UartInfo::uart->D;
-         }
+         // Reading data clears flags
+         (void)UartInfo::uart->D;
       }
    }
 };
 
-template<class UartInfo>
-uint8_t             CdcUart<UartInfo>::breakCount = 0;
-template<class UartInfo>
-uint8_t             CdcUart<UartInfo>::cdcStatus  = CdcUart<UartInfo>::CDC_STATE_CHANGE_MASK;
-template<class UartInfo>
-LineCodingStructure CdcUart<UartInfo>::lineCoding = {leToNative32(9600UL),0,1,8};
-
-template<class UartInfo>
-Queue<100> CdcUart<UartInfo>::outQueue;
-
-template<class UartInfo>
-bool (*CdcUart<UartInfo>::inCallback)(uint8_t ch);
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+uint8_t             CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::breakCount = 0;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+uint8_t             CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::cdcStatus  = CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::CDC_STATE_CHANGE_MASK;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+LineCodingStructure CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::lineCoding = {leToNative32(9600UL),0,1,8};
+
+// Buffers are aligned to their size for DMA modulo addressing
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+uint8_t  CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::rxBuffer[RX_BUFFER_SIZE] __attribute__((aligned(RX_BUFFER_SIZE)));
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::rxHead     = 0;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::rxTail     = 0;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::rxDmaCount = 0;
+
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+uint8_t  CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::txBuffer[TX_BUFFER_SIZE] __attribute__((aligned(TX_BUFFER_SIZE)));
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::txHead     = 0;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::txTail     = 0;
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+unsigned CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::txDmaCount = 0;
+
+template<class UartInfo, uint8_t rxDmaSlot, uint8_t txDmaSlot, bool useFlowControl>
+bool     CdcUart<UartInfo, rxDmaSlot, txDmaSlot, useFlowControl>::configured = false;
 
 }; // end namespace USBDM
 
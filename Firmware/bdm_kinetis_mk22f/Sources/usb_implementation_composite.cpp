@@ -33,6 +33,9 @@ enum InterfaceNumbers {
 /** Force command handler to exit and restart */
 bool Usb0::forceCommandHandlerInitialise = false;
 
+/** Source of live-watch data */
+Usb0::WatchDataCallback Usb0::watchDataCallback = nullptr;
+
 /*
  * String descriptors
  */
@@ -106,14 +109,14 @@ const Usb0::Descriptors Usb0::otherDescriptors = {
             /* bMaxPower               */ USBMilliamps(500)
       },
       /**
-       * Bulk interface, 2 end-points
+       * Bulk interface, 4 end-points
        */
       { // bulk_interface
             /* bLength                 */ sizeof(InterfaceDescriptor),
             /* bDescriptorType         */ DT_INTERFACE,
             /* bInterfaceNumber        */ BULK_INTF_ID,
             /* bAlternateSetting       */ 0,
-            /* bNumEndpoints           */ 2,
+            /* bNumEndpoints           */ 4,
             /* bInterfaceClass         */ 0xFF,                         // (Vendor specific)
             /* bInterfaceSubClass      */ 0xFF,                         // (Vendor specific)
             /* bInterfaceProtocol      */ 0xFF,                         // (Vendor specific)
@@ -135,6 +138,22 @@ const Usb0::Descriptors Usb0::otherDescriptors = {
             /* wMaxPacketSize          */ nativeToLe16(BULK_IN_EP_MAXSIZE),
             /* bInterval               */ USBMilliseconds(1)
       },
+      { // watch_in_endpoint - IN, Bulk
+            /* bLength                 */ sizeof(EndpointDescriptor),
+            /* bDescriptorType         */ DT_ENDPOINT,
+            /* bEndpointAddress        */ EP_IN|WATCH_IN_ENDPOINT,
+            /* bmAttributes            */ ATTR_BULK,
+            /* wMaxPacketSize          */ nativeToLe16(WATCH_IN_EP_MAXSIZE),
+            /* bInterval               */ USBMilliseconds(1)
+      },
+      { // event_in_endpoint - IN, Interrupt
+            /* bLength                 */ sizeof(EndpointDescriptor),
+            /* bDescriptorType         */ DT_ENDPOINT,
+            /* bEndpointAddress        */ EP_IN|EVENT_IN_ENDPOINT,
+            /* bmAttributes            */ ATTR_INTERRUPT,
+            /* wMaxPacketSize          */ nativeToLe16(EVENT_IN_EP_MAXSIZE),
+            /* bInterval               */ USBMilliseconds(1)
+      },
       { // interfaceAssociationDescriptorCDC
             /* bLength                 */ sizeof(InterfaceAssociationDescriptor),
             /* bDescriptorType         */ DT_INTERFACEASSOCIATION,
@@ -232,6 +251,9 @@ InEndpoint  <Usb0Info, Usb0::CDC_NOTIFICATION_ENDPOINT, CDC_NOTIFICATION_EP_MAXS
 OutEndpoint <Usb0Info, Usb0::CDC_DATA_OUT_ENDPOINT,     CDC_DATA_OUT_EP_MAXSIZE>      Usb0::epCdcDataOut;
 InEndpoint  <Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT,      CDC_DATA_IN_EP_MAXSIZE>       Usb0::epCdcDataIn;
 
+InEndpoint  <Usb0Info, Usb0::WATCH_IN_ENDPOINT,         WATCH_IN_EP_MAXSIZE>          Usb0::epWatchIn;
+InEndpoint  <Usb0Info, Usb0::EVENT_IN_ENDPOINT,         EVENT_IN_EP_MAXSIZE>          Usb0::epEventIn;
+
 /**
  * Handler for Start of Frame Token interrupt (~1ms interval)
  */
@@ -268,6 +290,11 @@ void Usb0::sofCallback() {
    }
    // Check CDC status
    epCdcSendNotification();
+
+   // Flush partial CDC packets and restart paused transfers
+   Uart::poll();
+   startCdcIn();
+   resumeCdcOut();
 }
 
 /**
@@ -297,23 +324,57 @@ void Usb0::epCdcSendNotification() {
    epCdcNotification.startTxTransaction(EPDataIn, sizeof(cdcNotification)+2);
 }
 
-static uint8_t cdcOutBuff[10] = "Welcome\n";
-static int cdcOutByteCount    = 8;
+/** Last CDC IN packet was full-size so the transfer must be terminated by a short packet or ZLP */
+static bool cdcInNeedsZLP  = false;
+
+/** CDC OUT reception paused as UART transmit buffer is full */
+static bool cdcOutPaused   = false;
 
 /**
  * Start CDC IN transaction\n
- * A packet is only sent if data is available
+ * A packet is only sent if data is available or a ZLP is needed
  */
 void Usb0::startCdcIn() {
-   if ((epCdcDataIn.getState() == EPIdle) && (cdcOutByteCount>0)) {
-      static_assert(epCdcDataIn.BUFFER_SIZE>sizeof(cdcOutBuff), "Buffer too small");
-      memcpy(epCdcDataIn.getBuffer(), cdcOutBuff, cdcOutByteCount);
-      //TODO Check if need ZLP
-      epCdcDataIn.setNeedZLP();
-      epCdcDataIn.startTxTransaction(EPDataIn, cdcOutByteCount);
-      cdcOutByteCount = 0;
+   if (epCdcDataIn.getState() != EPIdle) {
+      return;
    }
+   unsigned size = Uart::getData(epCdcDataIn.getBuffer(), epCdcDataIn.BUFFER_SIZE);
+   if ((size>0) || cdcInNeedsZLP) {
+      cdcInNeedsZLP = (size == epCdcDataIn.BUFFER_SIZE);
+      epCdcDataIn.startTxTransaction(EPDataIn, size);
+   }
+}
+
+/**
+ * Restart CDC OUT transaction if it was paused for lack of UART buffer space\n
+ * The host is NAKed while paused
+ */
+void Usb0::resumeCdcOut() {
+   if (cdcOutPaused && (epCdcDataOut.getState() == EPIdle) &&
+       (Uart::getTxFree() >= epCdcDataOut.BUFFER_SIZE)) {
+      cdcOutPaused = false;
+      epCdcDataOut.startRxTransaction(EPDataOut, epCdcDataOut.BUFFER_SIZE);
+   }
+}
+static_assert(CDC_UART_RX_DMA_CHANNEL == 5, "DMA5_IRQHandler assumes CDC Rx uses DMA channel 5");
+static_assert(CDC_UART_TX_DMA_CHANNEL == 6, "DMA6_IRQHandler assumes CDC Tx uses DMA channel 6");
+
+/**
+ * Handler for DMA complete interrupt from CDC UART receive channel
+ */
+extern "C"
+void DMA5_IRQHandler() {
+   Usb0::Uart::rxDmaComplete();
+}
+
+/**
+ * Handler for DMA complete interrupt from CDC UART transmit channel
+ */
+extern "C"
+void DMA6_IRQHandler() {
+   Usb0::Uart::txDmaComplete();
 }
+
 /**
  * Handler for Token Complete USB interrupts for
  * end-points other than EP0
@@ -348,6 +409,12 @@ void Usb0::handleTokenComplete() {
 //         PRINTF("CDC_DATA_IN_ENDPOINT\n");
          epCdcDataIn.handleInToken();
          return;
+      case WATCH_IN_ENDPOINT:  // Accept IN token
+         epWatchIn.handleInToken();
+         return;
+      case EVENT_IN_ENDPOINT:  // Accept IN token
+         epEventIn.handleInToken();
+         return;
    }
 }
 
@@ -360,20 +427,16 @@ void Usb0::handleTokenComplete() {
 void Usb0::cdcOutTransactionCallback(EndpointState state) {
 //   PRINTF("cdc_out\n");
    if (state == EPDataOut) {
-      uint8_t *buff = epCdcDataOut.getBuffer();
-      for (int i=epCdcDataOut.getDataTransferredSize(); i>0; i--) {
-         if (!Uart::putChar(*buff++)) {
-            // Discard further data in this transfer
-            break;
-         }
-      }
-      // Set up for next transfer
-      epCdcDataOut.startRxTransaction(EPDataOut, epCdcDataOut.BUFFER_SIZE);
+      // Whole packet is passed to UART (fails only on host protocol error)
+      (void)Uart::putData(epCdcDataOut.getBuffer(), epCdcDataOut.getDataTransferredSize());
+
+      // Set up for next transfer if there is room for a full packet
+      // Otherwise the host is NAKed until resumeCdcOut() is called from SOF
+      cdcOutPaused = true;
+      resumeCdcOut();
    }
 }
 
-static Queue<100> inQueue;
-
 /**
  * Call-back handling CDC-IN transaction complete\n
  * Checks for data from UART and schedules transfer as necessary
@@ -381,46 +444,8 @@ static Queue<100> inQueue;
  * @param state Current end-point state
  */
 void Usb0::cdcInTransactionCallback(EndpointState state) {
-   if (state == EPDataIn) {
-      int     charCount = 0;
-      uint8_t *buff     = epCdcDataIn.getBuffer();
-
-      // Copy characters from UART to end-point buffer
-      while(!inQueue.isEmpty()) {
-         if (charCount>=epCdcDataIn.BUFFER_SIZE) {
-            // Buffer full. Leave rest for next transfer.
-            break;
-         }
-         *buff++ = inQueue.deQueue();
-         charCount++;
-      }
-      if (charCount>0) {
-//         PRINTF("Sending %d\n", charCount);
-         // Schedules transfer if data available
-         epCdcDataIn.startTxTransaction(EPDataIn, charCount);
-      }
-   }
-}
-
-/**
- * Add character to CDC OUT buffer.
- *
- * @param ch Character to send
- *
- * @return true  Character added
- * @return false Overrun, character not added
- */
-bool Usb0::putCdcChar(uint8_t ch) {
-   if (inQueue.isFull()) {
-      return false;
-   }
-   inQueue.enQueue(ch);
-   if (epCdcDataIn.getState() == EPIdle) {
-      IrqProtect ip;
-      // Restart IN transfer
-      cdcInTransactionCallback(EPDataIn);
-   }
-   return true;
+   (void)state;
+   startCdcIn();
 }
 
 /**
@@ -443,6 +468,63 @@ void Usb0::bulkInTransactionCallback(EndpointState state) {
    // No actions - End-point is polled
 }
 
+/**
+ * Call-back handling live-watch IN transaction complete\n
+ * Schedules the next packet if more data is available
+ *
+ * @param state Current end-point state (not used - the end-point reports EPLastIn on completion)
+ */
+void Usb0::watchInTransactionCallback(EndpointState state) {
+   (void)state;
+   if (watchDataCallback != nullptr) {
+      unsigned size = watchDataCallback(epWatchIn.getBuffer(), epWatchIn.BUFFER_SIZE);
+      if (size>0) {
+         epWatchIn.startTxTransaction(EPDataIn, size);
+      }
+   }
+}
+
+/**
+ * Start live-watch IN transaction if idle\n
+ * A packet is only sent if data is available
+ */
+void Usb0::startWatchIn() {
+   if (epWatchIn.getState() == EPIdle) {
+      IrqProtect ip;
+      // Restart IN transfer
+      watchInTransactionCallback(EPDataIn);
+   }
+}
+
+/**
+ *  Send notification on target event end-point
+ *
+ *  @param data Pointer to data to send
+ *  @param size Number of bytes to send (<= EVENT_IN_EP_MAXSIZE)
+ *
+ *  @return true  => Notification queued for transmission\n
+ *          false => End-point busy with previous notification (nothing done)
+ */
+bool Usb0::sendEventData(const uint8_t *data, unsigned size) {
+   IrqProtect ip;
+   if ((connectionState != USBconfigured) || (epEventIn.getState() != EPIdle)) {
+      return false;
+   }
+   epEventIn.startTxTransaction(EPDataIn, size, data);
+   return true;
+}
+
+/**
+ * Handler for deferred USB SOF processing (lowest priority)\n
+ * Keeps LED, CDC notification and CDC flushing out of the token path
+ *
+ * The USB interrupt is handled by UsbBase_T::irqHandler()
+ */
+extern "C"
+void PendSV_Handler() {
+   Usb0::handleDeferredSOF();
+}
+
 /**
  * Initialise the USB0 interface
  *
@@ -457,8 +539,6 @@ void Usb0::initialise() {
    setUnhandledSetupCallback(handleUserEp0SetupRequests);
 
    setSOFCallback(sofCallback);
-
-   Uart::setInCallback(putCdcChar);
 }
 
 /**
@@ -472,11 +552,40 @@ void Usb0::initialise() {
  *   @note Doesn't return until command has been received.
  */
 int Usb0::receiveBulkData(uint8_t maxSize, uint8_t *buffer) {
+   startReceiveBulkData(maxSize, buffer);
+   return waitReceiveBulkData();
+}
+
+/**
+ *  Start reception of data over bulk OUT end-point
+ *
+ *   @param maxSize  = max # of bytes to receive
+ *   @param buffer   = ptr to buffer for bytes received
+ *
+ *   @note Use waitReceiveBulkData() to wait for completion
+ */
+void Usb0::startReceiveBulkData(uint8_t maxSize, uint8_t *buffer) {
    epBulkOut.startRxTransaction(EPDataOut, maxSize, buffer);
+}
+
+/**
+ *  Wait for reception started by startReceiveBulkData() to complete
+ *
+ *   @param idleFunction Function to call each time the processor wakes while waiting (may be nullptr)
+ *
+ *   @return Number of bytes received
+ */
+int Usb0::waitReceiveBulkData(void (*idleFunction)()) {
    while(epBulkOut.getState() != EPIdle) {
       if (!areInterruptsEnabled()) {
          ::enableInterrupts();
       }
+      if (idleFunction != nullptr) {
+         idleFunction();
+         if (epBulkOut.getState() == EPIdle) {
+            break;
+         }
+      }
       __WFI();
    }
    setActive();
@@ -502,6 +611,44 @@ void Usb0::sendBulkData(uint8_t size, const uint8_t *buffer) {
    epBulkIn.startTxTransaction(EPDataIn, size, buffer);
 }
 
+/**
+ *  Wait until transmission started by sendBulkData() is complete\n
+ *  The buffer passed to sendBulkData() may then be re-used
+ */
+void Usb0::waitSendBulkData() {
+   while (epBulkIn.getState() != EPIdle) {
+      __WFI();
+   }
+}
+
+/**
+ *  Obtain bulk IN end-point buffer so a response may be written to it directly
+ *  (avoids copying through an intermediate transmit buffer)
+ *
+ *  @return Pointer to buffer of BULK_IN_EP_MAXSIZE bytes
+ *
+ *  @note Waits until any previous transmission is complete
+ */
+uint8_t *Usb0::lendBulkInBuffer() {
+   while (epBulkIn.getState() != EPIdle) {
+      __WFI();
+   }
+   return epBulkIn.getBuffer();
+}
+
+/**
+ *  Hand back buffer obtained from lendBulkInBuffer() and transmit its contents
+ *
+ *  @param size Number of bytes to send (<= BULK_IN_EP_MAXSIZE)
+ */
+void Usb0::returnBulkInBuffer(uint8_t size) {
+   if (size > BULK_IN_EP_MAXSIZE) {
+      size = BULK_IN_EP_MAXSIZE;
+   }
+   // Data is already in end-point buffer
+   epBulkIn.startTxTransaction(EPDataIn, size);
+}
+
 /**
  * CDC Set line coding handler
  */
@@ -589,6 +736,29 @@ void Usb0::handleUserEp0SetupRequests(const SetupPacket &setup) {
                ep0StartTxTransaction( sizeof(versionResponse),  versionResponse );
                }
                break;
+#ifdef USB_TRACE
+            case CMD_USBDM_GET_USB_TRACE : {
+               // Maximum events returned per request - ep0StartTxTransaction() limits the response to 255 bytes
+               static constexpr unsigned MAX_EVENTS = 30;
+
+               // Copy of trace - must remain valid while the response is sent
+               static uint8_t traceResponse[12+MAX_EVENTS*sizeof(UsbTraceEntry)] __attribute__((aligned(4)));
+               static_assert(sizeof(traceResponse) <= 255, "Trace response too large for ep0 transfer");
+
+               // Extend 16-bit start index to 32-bits using current head
+               uint32_t head  = UsbTrace::getHead();
+               uint32_t from  = head-(uint16_t)(head-(uint16_t)setup.wValue);
+               unsigned count = UsbTrace::read(from, (UsbTraceEntry *)(traceResponse+12), MAX_EVENTS);
+
+               memset(traceResponse, 0, 4);
+               traceResponse[0] = BDM_RC_OK;
+               // Little-endian to match the events
+               unpack32LE(head, traceResponse+4);
+               unpack32LE(from, traceResponse+8);
+               ep0StartTxTransaction(12+count*sizeof(UsbTraceEntry), traceResponse);
+               }
+               break;
+#endif
             default :
                controlEndpoint.stall();
                break;
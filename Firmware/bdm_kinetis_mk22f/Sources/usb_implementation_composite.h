@@ -71,8 +71,17 @@ static constexpr uint  BULK_OUT_EP_MAXSIZE          = 64; //!< Bulk out
 static constexpr uint  BULK_IN_EP_MAXSIZE           = 64; //!< Bulk in           64
 
 static constexpr uint  CDC_NOTIFICATION_EP_MAXSIZE  = 16; //!< CDC notification  16
-static constexpr uint  CDC_DATA_OUT_EP_MAXSIZE      = 16; //!< CDC data out      16
-static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 16; //!< CDC data in       16
+static constexpr uint  CDC_DATA_OUT_EP_MAXSIZE      = 64; //!< CDC data out      64
+static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 64; //!< CDC data in       64
+
+static constexpr uint  WATCH_IN_EP_MAXSIZE          = 64; //!< Live-watch in     64
+static constexpr uint  EVENT_IN_EP_MAXSIZE          =  8; //!< Target event in    8
+
+//======================================================================
+// DMAMUX slots for CDC UART
+//
+static constexpr uint8_t CDC_UART_RX_DMA_SLOT = 4; //!< UART1 Receive
+static constexpr uint8_t CDC_UART_TX_DMA_SLOT = 5; //!< UART1 Transmit
 
 #ifdef USBDM_USB0_IS_DEFINED
 /**
@@ -80,13 +89,13 @@ static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 16; //!< CDC data in
  */
 class Usb0 : public UsbBase_T<Usb0Info, CONTROL_EP_MAXSIZE> {
 
-   // Select UART to use
-   using Uart = CdcUart<Uart1Info>;
-
    // Allow superclass to access handleTokenComplete(void);
    friend UsbBase_T<Usb0Info, CONTROL_EP_MAXSIZE>;
 
 public:
+   // Select UART to use
+   using Uart = CdcUart<Uart1Info, CDC_UART_RX_DMA_SLOT, CDC_UART_TX_DMA_SLOT>;
+
    /**
     * String indexes
     *
@@ -140,6 +149,12 @@ public:
       /** CDC Data in endpoint number */
       CDC_DATA_IN_ENDPOINT,
 
+      /** Live-watch bulk in endpoint number */
+      WATCH_IN_ENDPOINT,
+
+      /** Target event interrupt in endpoint number */
+      EVENT_IN_ENDPOINT,
+
       /** Total number of end-points */
       NUMBER_OF_ENDPOINTS,
    };
@@ -170,9 +185,29 @@ protected:
    static OutEndpoint <Usb0Info, Usb0::CDC_DATA_OUT_ENDPOINT,     CDC_DATA_OUT_EP_MAXSIZE>      epCdcDataOut;
    static InEndpoint  <Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT,      CDC_DATA_IN_EP_MAXSIZE>       epCdcDataIn;
 
+   static InEndpoint  <Usb0Info, Usb0::WATCH_IN_ENDPOINT,         WATCH_IN_EP_MAXSIZE>          epWatchIn;
+   static InEndpoint  <Usb0Info, Usb0::EVENT_IN_ENDPOINT,         EVENT_IN_EP_MAXSIZE>          epEventIn;
+
    /** Force command handler to exit and restart */
    static bool forceCommandHandlerInitialise;
 
+public:
+   /**
+    * Call-back to obtain live-watch data
+    *
+    * @param buffer  Buffer to fill
+    * @param maxSize Size of buffer
+    *
+    * @return Number of bytes placed in buffer
+    *
+    * @note Called from USB interrupt
+    */
+   typedef unsigned (*WatchDataCallback)(uint8_t *buffer, unsigned maxSize);
+
+protected:
+   /** Source of live-watch data */
+   static WatchDataCallback watchDataCallback;
+
 public:
 
    /**
@@ -191,6 +226,58 @@ public:
     */
    static void sendBulkData(const uint8_t size, const uint8_t *buffer);
 
+   /**
+    *  Wait until transmission started by sendBulkData() is complete\n
+    *  The buffer passed to sendBulkData() may then be re-used
+    */
+   static void waitSendBulkData();
+
+   /**
+    *  Obtain bulk IN end-point buffer so a response may be written to it directly
+    *  (avoids copying through an intermediate transmit buffer)
+    *
+    *  @return Pointer to buffer of BULK_IN_EP_MAXSIZE bytes
+    *
+    *  @note Waits until any previous transmission is complete.\n
+    *        The buffer must be handed back with returnBulkInBuffer()
+    */
+   static uint8_t *lendBulkInBuffer();
+
+   /**
+    *  Hand back buffer obtained from lendBulkInBuffer() and transmit its contents
+    *
+    *  @param size Number of bytes to send (<= BULK_IN_EP_MAXSIZE)
+    *
+    *  @note Returns before data has been transmitted
+    */
+   static void returnBulkInBuffer(uint8_t size);
+
+   /**
+    *  Set source of data for live-watch end-point
+    *
+    *  @param callback Call-back used to fill each packet
+    */
+   static void setWatchDataCallback(WatchDataCallback callback) {
+      watchDataCallback = callback;
+   }
+
+   /**
+    *  Start live-watch IN transaction if idle\n
+    *  A packet is only sent if data is available
+    */
+   static void startWatchIn();
+
+   /**
+    *  Send notification on target event end-point
+    *
+    *  @param data Pointer to data to send
+    *  @param size Number of bytes to send (<= EVENT_IN_EP_MAXSIZE)
+    *
+    *  @return true  => Notification queued for transmission\n
+    *          false => End-point busy with previous notification (nothing done)
+    */
+   static bool sendEventData(const uint8_t *data, unsigned size);
+
    /**
     *  Blocking reception of data over bulk OUT end-point
     *
@@ -203,6 +290,26 @@ public:
     */
    static int receiveBulkData(uint8_t maxSize, uint8_t *buffer);
 
+   /**
+    *  Start reception of data over bulk OUT end-point\n
+    *  This allows the next packet to be received while the current one is processed
+    *
+    *   @param maxSize Maximum number of bytes to receive
+    *   @param buffer  Pointer to buffer for bytes received
+    *
+    *   @note Use waitReceiveBulkData() to wait for completion
+    */
+   static void startReceiveBulkData(uint8_t maxSize, uint8_t *buffer);
+
+   /**
+    *  Wait for reception started by startReceiveBulkData() to complete
+    *
+    *   @param idleFunction Function to call each time the processor wakes while waiting (may be nullptr)
+    *
+    *   @return Number of bytes received
+    */
+   static int waitReceiveBulkData(void (*idleFunction)() = nullptr);
+
    /**
     * CDC Transmit
     *
@@ -221,8 +328,6 @@ public:
     */
    static int receiveCdcData(uint8_t *data, unsigned maxSize);
 
-   static bool putCdcChar(uint8_t ch);
-
    /**
     * Device Descriptor
     */
@@ -237,6 +342,8 @@ public:
       InterfaceDescriptor                      bulk_interface;
       EndpointDescriptor                       bulk_out_endpoint;
       EndpointDescriptor                       bulk_in_endpoint;
+      EndpointDescriptor                       watch_in_endpoint;
+      EndpointDescriptor                       event_in_endpoint;
 
       InterfaceAssociationDescriptor           interfaceAssociationDescriptorCDC;
       InterfaceDescriptor                      cdc_CCI_Interface;
@@ -283,11 +390,15 @@ protected:
       addEndpoint(&epCdcDataIn);
       epCdcDataIn.setCallback(cdcInTransactionCallback);
 
+      epWatchIn.initialise();
+      addEndpoint(&epWatchIn);
+      epWatchIn.setCallback(watchInTransactionCallback);
+
+      epEventIn.initialise();
+      addEndpoint(&epEventIn);
+
       // Start CDC status transmission
       epCdcSendNotification();
-
-      static const uint8_t cdcInBuff[] = "Hello there\n";
-      epCdcDataIn.startTxTransaction(EPDataIn, sizeof(cdcInBuff), cdcInBuff);
    }
 
    /**
@@ -305,6 +416,11 @@ protected:
     */
    static void bulkInTransactionCallback(EndpointState state);
 
+   /**
+    * Call-back handling live-watch IN transaction complete
+    */
+   static void watchInTransactionCallback(EndpointState state);
+
    /**
     * Call-back handling CDC-INtransaction complete
     */
@@ -323,10 +439,15 @@ protected:
 
    /**
     * Start CDC IN transaction\n
-    * A packet is only sent if data is available
+    * A packet is only sent if data is available or a ZLP is needed
     */
    static void startCdcIn();
 
+   /**
+    * Restart CDC OUT transaction if it was paused for lack of UART buffer space
+    */
+   static void resumeCdcOut();
+
    /**
     * Configure epCdcNotification for an IN transaction [Tx, device -> host, DATA0/1]
     */